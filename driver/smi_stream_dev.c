@@ -39,6 +39,7 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
@@ -55,6 +56,7 @@
 #include <linux/wait.h>
 #include <linux/poll.h>
 #include <linux/init.h>
+#include <linux/dma-mapping.h>
 
 #include "smi_stream_dev.h"
 
@@ -64,14 +66,52 @@
 static int              fifo_mtu_multiplier = 6;// How many MTUs to allocate for kfifo's
 static int              addr_dir_offset = 2;    // GPIO_SA[4:0] offset of the channel direction
 static int              addr_ch_offset = 3;     // GPIO_SA[4:0] offset of the channel select
+static bool             rx_cyclic = true;       // free running (cyclic) DMA into the mapped rx ring
 
 module_param(fifo_mtu_multiplier, int, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
 module_param(addr_dir_offset, int, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
 module_param(addr_ch_offset, int, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+module_param(rx_cyclic, bool, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
 
 MODULE_PARM_DESC(fifo_mtu_multiplier, "the number of MTUs (N*MTU_SIZE) to allocate for kfifo's (default 6) valid: [3..19]");
 MODULE_PARM_DESC(addr_dir_offset, "GPIO_SA[4:0] offset of the channel direction (default cariboulite 2), valid: [0..4] or (-1) if unused");
 MODULE_PARM_DESC(addr_ch_offset, "GPIO_SA[4:0] offset of the channel select (default cariboulite 3), valid: [0..4] or (-1) if unused");
+MODULE_PARM_DESC(rx_cyclic, "use a free running cyclic DMA over the mmap'd rx ring instead of a transfer per chunk (default Y)");
+
+// RX ring mapped into user-space (see struct smi_stream_rx_ring_ctrl)
+struct smi_stream_rx_ring
+{
+	void *virt;
+	dma_addr_t phys;
+	size_t size;
+	unsigned int num_chunks;
+	struct smi_stream_rx_ring_ctrl *ctrl;
+	struct scatterlist sgl[SMI_STREAM_RX_RING_MAX_CHUNKS];
+	bool mapped;
+
+	// cyclic mode
+	bool cyclic_running;
+	atomic_t cyclic_periods;            // periods completed since the SMI was (re)armed
+	wait_queue_head_t cyclic_wait;
+	u64 cyclic_arm_ns;                  // when the SMI was last (re)armed
+	u64 cyclic_last_period_ns;          // when the last period completed
+};
+
+// The SMI itself is not cyclic - it is programmed with a transfer count that
+// covers as many whole DMA periods as fit in a (positive) int and is re-armed
+// when they are all done. The samples missed during the short re-arm gap
+// (every ~2 minutes at 4 MSPS) are accounted as lost
+#define SMI_CYCLIC_PERIODS_PER_ARM      (INT_MAX / DMA_BOUNCE_BUFFER_SIZE)
+#define SMI_CYCLIC_ARM_BYTES            (SMI_CYCLIC_PERIODS_PER_ARM * DMA_BOUNCE_BUFFER_SIZE)
+
+// the user may lag behind a ring realignment (see reader_ring_cyclic_start) -
+// chunks before 'first_valid' were never written by the current run
+static inline u32 rx_ring_user_tail(struct smi_stream_rx_ring_ctrl *ctrl)
+{
+	u32 tail = READ_ONCE(ctrl->tail);
+	u32 first_valid = READ_ONCE(ctrl->first_valid);
+	return ((s32)(first_valid - tail) > 0) ? first_valid : tail;
+}
 
 struct bcm2835_smi_dev_instance 
 {
@@ -86,6 +126,9 @@ struct bcm2835_smi_dev_instance
 	struct task_struct *writer_thread;
 	struct kfifo rx_fifo;
 	struct kfifo tx_fifo;
+	struct smi_stream_rx_ring rx_ring;
+	struct smi_stream_rx_chunk_info rx_stats;
+	spinlock_t rx_stats_lock;
 	smi_stream_state_en state;
 	struct mutex read_lock;
 	struct mutex write_lock;
@@ -203,6 +246,11 @@ static void set_state(smi_stream_state_en state)
     {
         inst->cur_address = (smi_stream_dir_device_to_smi<<addr_dir_offset) | (smi_stream_channel_1<<addr_ch_offset);
     }
+    else if (state == smi_stream_rx_dual)
+    {
+        // the FPGA interleaves both channels, the channel address line is ignored
+        inst->cur_address = (smi_stream_dir_device_to_smi<<addr_dir_offset) | (smi_stream_channel_0<<addr_ch_offset);
+    }
     else if (state == smi_stream_tx_channel)
     { 
         inst->cur_address = smi_stream_dir_smi_to_device<<addr_dir_offset;
@@ -221,6 +269,7 @@ static void set_state(smi_stream_state_en state)
         {
             up(&inst->smi_inst->bounce.callback_sem);
         }
+        wake_up_interruptible(&inst->rx_ring.cyclic_wait);
     }
     
     inst->state = state;
@@ -429,6 +478,12 @@ static long smi_stream_ioctl(struct file *file, unsigned int cmd, unsigned long
 	//-------------------------------
 	case SMI_STREAM_IOC_SET_STREAM_STATUS:
 	{
+        if (arg > smi_stream_rx_dual)
+        {
+            dev_err(inst->dev, "Parameter error: unknown stream state %lu", arg);
+            ret = -EINVAL;
+            break;
+        }
         set_state((smi_stream_state_en)arg);
 		
 		break;
@@ -503,6 +558,50 @@ static long smi_stream_ioctl(struct file *file, unsigned int cmd, unsigned long
 		}
 		break;
 	}
+    //-------------------------------
+	case SMI_STREAM_IOC_GET_RX_RING_SIZE:
+	{
+		size_t size = (inst->rx_ring.virt != NULL) ? PAGE_ALIGN(inst->rx_ring.size) : 0;
+		dev_dbg(inst->dev, "Reading rx ring size of %zu", size);
+		if (copy_to_user((void *)arg, &size, sizeof(size_t)))
+		{
+			dev_err(inst->dev, "rx ring size copy failed.");
+		}
+		break;
+	}
+    //-------------------------------
+	case SMI_STREAM_IOC_SET_RX_CYCLIC:
+	{
+		dev_info(inst->dev, "Setting cyclic rx mode to %d", (int)arg);
+		rx_cyclic = (arg != 0);
+		break;
+	}
+    //-------------------------------
+	case SMI_STREAM_IOC_GET_RX_STATS:
+	{
+		struct smi_stream_rx_stats stats;
+		unsigned long flags;
+
+		spin_lock_irqsave(&inst->rx_stats_lock, flags);
+		stats.last_chunk = inst->rx_stats;
+		spin_unlock_irqrestore(&inst->rx_stats_lock, flags);
+
+		if (inst->rx_ring.mapped)
+		{
+			struct smi_stream_rx_ring_ctrl *ctrl = inst->rx_ring.ctrl;
+			stats.pending_bytes = (u64)(READ_ONCE(ctrl->head) - rx_ring_user_tail(ctrl)) * DMA_BOUNCE_BUFFER_SIZE;
+		}
+		else
+		{
+			stats.pending_bytes = kfifo_initialized(&inst->rx_fifo) ? kfifo_len(&inst->rx_fifo) : 0;
+		}
+
+		if (copy_to_user((void *)arg, &stats, sizeof(stats)))
+		{
+			dev_err(inst->dev, "rx stats copy failed.");
+		}
+		break;
+	}
     //-------------------------------
 	default:
 		dev_err(inst->dev, "invalid ioctl cmd: %d", cmd);
@@ -562,23 +661,14 @@ static void stream_smi_dma_callback_user_copy(void *param)
 }
 
 /***************************************************************************/
-ssize_t stream_smi_user_dma(	struct bcm2835_smi_instance *inst,
-								enum dma_transfer_direction dma_dir,
-								struct bcm2835_smi_bounce_info **bounce, 
-                                int buff_num)
+static ssize_t stream_smi_dma_start(struct bcm2835_smi_instance *inst,
+									enum dma_transfer_direction dma_dir,
+									struct scatterlist *sgl)
 {
-	struct scatterlist *sgl = NULL;
-
 	spin_lock(&inst->transaction_lock);
 
 	sema_init(&inst->bounce.callback_sem, 0);
 
-	if (bounce)
-	{
-		*bounce = &(inst->bounce);
-	}
-
-	sgl = &(inst->bounce.sgl[buff_num]);
 	if (sgl == NULL)
 	{
 		dev_err(inst->dev, "sgl is NULL");
@@ -622,151 +712,274 @@ ssize_t stream_smi_user_dma(	struct bcm2835_smi_instance *inst,
 }
 
 /***************************************************************************/
-/*int reader_thread_stream_function(void *pv) 
+ssize_t stream_smi_user_dma(	struct bcm2835_smi_instance *inst,
+								enum dma_transfer_direction dma_dir,
+								struct bcm2835_smi_bounce_info **bounce, 
+                                int buff_num)
 {
-	int count = 0;
-    int current_dma_buffer = 0;
-	struct bcm2835_smi_bounce_info *bounce = NULL;
-    struct dma_async_tx_descriptor *desc = NULL;
-    
-	dev_info(inst->dev, "Enterred reader thread");
-    inst->reader_thread_running = true;
-    
-    //=================================================
-    // create cyclic dma read
-    //=================================================
-    struct scatterlist *sgl = NULL;
-    bounce = &(inst->smi_inst->inst->bounce)
-	spin_lock(&inst->smi_inst->inst->transaction_lock);
-	sema_init(&inst->smi_inst->inst->bounce.callback_sem, 0);
-    
-	desc = dmaengine_prep_dma_cyclic(inst->smi_inst->inst->dma_chan,
-                       bounce->phys[0],
+	if (bounce)
+	{
+		*bounce = &(inst->bounce);
+	}
+
+	return stream_smi_dma_start(inst, dma_dir, &(inst->bounce.sgl[buff_num]));
+}
+
+/***************************************************************************/
+static void rx_stats_add_chunk(size_t lost, struct smi_stream_rx_chunk_info *info)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&inst->rx_stats_lock, flags);
+	inst->rx_stats.timestamp_ns = ktime_get_ns();
+	inst->rx_stats.stream_bytes += DMA_BOUNCE_BUFFER_SIZE;
+	inst->rx_stats.lost_bytes += lost;
+	if (info != NULL)
+	{
+		*info = inst->rx_stats;
+	}
+	spin_unlock_irqrestore(&inst->rx_stats_lock, flags);
+}
+
+/***************************************************************************/
+static void rx_stats_add_gap(size_t lost)
+{
+	unsigned long flags;
+
+	// the stream position keeps counting the samples that were never received
+	spin_lock_irqsave(&inst->rx_stats_lock, flags);
+	inst->rx_stats.stream_bytes += lost;
+	inst->rx_stats.lost_bytes += lost;
+	spin_unlock_irqrestore(&inst->rx_stats_lock, flags);
+}
+
+/***************************************************************************/
+static void reader_ring_transfer(void)
+{
+	struct smi_stream_rx_ring *ring = &inst->rx_ring;
+	struct smi_stream_rx_ring_ctrl *ctrl = ring->ctrl;
+	struct bcm2835_smi_bounce_info *bounce = &(inst->smi_inst->bounce);
+	u32 head = ctrl->head;
+	u32 tail = rx_ring_user_tail(ctrl);
+	bool full = (head - tail) >= ring->num_chunks - 1;
+	struct scatterlist *sgl = NULL;
+
+	// DMA directly into the next free chunk of the user mapped ring. If the user
+	// fell behind, the chunk is received into the bounce buffer and dropped instead
+	// of overwriting data it may still be reading
+	sgl = full ? &bounce->sgl[0] : &ring->sgl[head % ring->num_chunks];
+
+	if (stream_smi_dma_start(inst->smi_inst, DMA_DEV_TO_MEM, sgl) != DMA_BOUNCE_BUFFER_SIZE)
+	{
+		dev_err(inst->dev, "stream_smi_dma_start failed (ring chunk %u)", head % ring->num_chunks);
+		spin_lock(&inst->smi_inst->transaction_lock);
+		dmaengine_terminate_all(inst->smi_inst->dma_chan);
+		spin_unlock(&inst->smi_inst->transaction_lock);
+		return;
+	}
+
+	inst->reader_waiting_sema = true;
+	if (down_timeout(&bounce->callback_sem, msecs_to_jiffies(200))) 
+	{
+		dev_info(inst->dev, "Reader DMA ring timed out");
+		spin_lock(&inst->smi_inst->transaction_lock);
+		dmaengine_terminate_all(inst->smi_inst->dma_chan);
+		spin_unlock(&inst->smi_inst->transaction_lock);
+	}
+	else if (inst->state == smi_stream_idle)
+	{
+		// the wait was aborted - the chunk is incomplete
+		dev_info(inst->dev, "Reader state became idle, terminating dma");
+		spin_lock(&inst->smi_inst->transaction_lock);
+		dmaengine_terminate_all(inst->smi_inst->dma_chan);
+		spin_unlock(&inst->smi_inst->transaction_lock);
+	}
+	else if (full)
+	{
+		rx_stats_add_chunk(DMA_BOUNCE_BUFFER_SIZE, NULL);
+		WRITE_ONCE(ctrl->overflows, ctrl->overflows + 1);
+	}
+	else
+	{
+		// publish the chunk
+		rx_stats_add_chunk(0, &ctrl->chunk_info[head % ring->num_chunks]);
+		smp_wmb();
+		WRITE_ONCE(ctrl->head, head + 1);
+
+		inst->readable = true;
+		wake_up_interruptible(&inst->poll_event);
+	}
+	inst->reader_waiting_sema = false;
+}
+
+/***************************************************************************/
+static void stream_smi_dma_callback_cyclic(void *param)
+{
+	struct smi_stream_rx_ring *ring = (struct smi_stream_rx_ring *)param;
+	struct smi_stream_rx_ring_ctrl *ctrl = ring->ctrl;
+	u32 head = ctrl->head + 1;
+	size_t lost = 0;
+
+	// the DMA has moved on to chunk 'head' - if the user still holds it, the
+	// oldest data is being overwritten
+	if (head - rx_ring_user_tail(ctrl) >= ring->num_chunks)
+	{
+		WRITE_ONCE(ctrl->overflows, ctrl->overflows + 1);
+		lost = DMA_BOUNCE_BUFFER_SIZE;
+	}
+	rx_stats_add_chunk(lost, &ctrl->chunk_info[ctrl->head % ring->num_chunks]);
+
+	smp_wmb();
+	WRITE_ONCE(ctrl->head, head);
+
+	inst->readable = true;
+	wake_up_interruptible(&inst->poll_event);
+
+	if (atomic_inc_return(&ring->cyclic_periods) >= SMI_CYCLIC_PERIODS_PER_ARM)
+	{
+		ring->cyclic_last_period_ns = ktime_get_ns();
+		wake_up_interruptible(&ring->cyclic_wait);
+	}
+}
+
+/***************************************************************************/
+static int reader_ring_cyclic_start(void)
+{
+	struct smi_stream_rx_ring *ring = &inst->rx_ring;
+	struct smi_stream_rx_ring_ctrl *ctrl = ring->ctrl;
+	struct bcm2835_smi_instance *smi_inst = inst->smi_inst;
+	struct dma_async_tx_descriptor *desc = NULL;
+	u32 head = ctrl->head;
+	int ret = 0;
+
+	// a cyclic dma always starts at the first chunk of the ring, so the count
+	// is moved forward to the next multiple of 'num_chunks'. The chunks skipped
+	// over hold nothing of this run - 'first_valid' tells the user to drop them
+	if (head % ring->num_chunks)
+	{
+		head += ring->num_chunks - (head % ring->num_chunks);
+	}
+	WRITE_ONCE(ctrl->first_valid, head);
+	smp_wmb();
+	WRITE_ONCE(ctrl->head, head);
+
+	spin_lock(&smi_inst->transaction_lock);
+
+	desc = dmaengine_prep_dma_cyclic(smi_inst->dma_chan,
+				       ring->phys + PAGE_SIZE,
+				       ring->num_chunks * DMA_BOUNCE_BUFFER_SIZE,
 				       DMA_BOUNCE_BUFFER_SIZE,
-                       DMA_BOUNCE_BUFFER_SIZE,
 				       DMA_DEV_TO_MEM,
-				       DMA_PREP_INTERRUPT | DMA_CTRL_ACK | DMA_PREP_FENCE);
+				       DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
 	if (!desc) 
 	{
-		unsigned int timeout = 10000U;
-		write_smi_reg(inst->smi_inst->inst, read_smi_reg(inst->smi_inst->inst, SMICS) & ~SMICS_ACTIVE, 	SMICS);
-		while ((read_smi_reg(inst->smi_inst->inst, SMICS) & SMICS_ACTIVE) && (timeout--)>0)
-		{
-			cpu_relax();
-		}
-		write_smi_reg(inst->smi_inst->inst, read_smi_reg(inst, SMICS) | SMICS_ACTIVE, SMICS);
-		return 0;
+		spin_unlock(&smi_inst->transaction_lock);
+		dev_err(inst->dev, "cyclic dma preparation failed");
+		return -1;
 	}
 
-	desc->callback = callback;
-	desc->callback_param = inst;
+	desc->callback = stream_smi_dma_callback_cyclic;
+	desc->callback_param = ring;
 
 	if (dmaengine_submit(desc) < 0)
 	{
-		return 0;
+		spin_unlock(&smi_inst->transaction_lock);
+		dev_err(inst->dev, "cyclic dma submit failed");
+		return -1;
 	}
-    
-    dma_async_issue_pending(inst->smi_inst->inst->dma_chan);
-    
-    int ret = smi_init_programmed_read(inst->smi_inst->inst, DMA_BOUNCE_BUFFER_SIZE);
-    if (ret != 0)
-    {
-        spin_unlock(&inst->smi_inst->inst->transaction_lock);
-        dev_err(inst->smi_inst->inst->dev, "smi_init_programmed_read returned %d", ret);
-        return 0;
-    }
-    
-    spin_unlock(&inst->smi_inst->inst->transaction_lock);
+	dma_async_issue_pending(smi_inst->dma_chan);
 
-    //=================================================
-    // reader loop
-    //=================================================
-	while(!kthread_should_stop())
-	{       
-		// check if the streaming state is on, if not, sleep and check again
-		if (inst->state != smi_stream_rx_channel_0 && inst->state != smi_stream_rx_channel_1)
-		{
-			msleep(1);
-			continue;
-		}
-        
-        start = ktime_get();
-        // sync smi address
-        if (inst->address_changed) 
-        {
-            bcm2835_smi_set_address(inst->smi_inst, inst->cur_address);
-            inst->address_changed = 0;
-        }
-		
-        //--------------------------------------------------------
-		// try setup a new DMA transfer into dma bounce buffer
-		// bounce will hold the current transfers state
-		count = stream_smi_user_dma(inst->smi_inst, DMA_DEV_TO_MEM, &bounce, current_dma_buffer);
-		if (count != DMA_BOUNCE_BUFFER_SIZE || bounce == NULL)
-		{
-			dev_err(inst->dev, "stream_smi_user_dma returned illegal count = %d, buff_num = %d", count, current_dma_buffer);
-            spin_lock(&inst->smi_inst->transaction_lock);
-            dmaengine_terminate_all(inst->smi_inst->dma_chan);
-            spin_unlock(&inst->smi_inst->transaction_lock);
-			continue;
-		}
-        
-        t1 = ktime_to_ns(ktime_sub(ktime_get(), start));
-        
-        //--------------------------------------------------------
-        // Don't wait for the buffer to fill in, copy the "other" 
-        // previously filled up buffer into the kfifo
-		//if (mutex_lock_interruptible(&inst->read_lock))
-		//{
-		//	return -EINTR;
-		//}
-        
-        start = ktime_get();
-        
-		kfifo_in(&inst->rx_fifo, bounce->buffer[1-current_dma_buffer], DMA_BOUNCE_BUFFER_SIZE);
-		//mutex_unlock(&inst->read_lock);
-		
-		// for the polling mechanism
-		inst->readable = true;
-		wake_up_interruptible(&inst->poll_event);
-        
-        t2 = ktime_to_ns(ktime_sub(ktime_get(), start));
+	// the dma starts filling the chunk at 'head' (ring chunk 0)
+	atomic_set(&ring->cyclic_periods, 0);
+	ring->cyclic_arm_ns = ktime_get_ns();
+	ret = smi_init_programmed_read(smi_inst, SMI_CYCLIC_ARM_BYTES);
+	if (ret != 0)
+	{
+		dmaengine_terminate_all(smi_inst->dma_chan);
+		spin_unlock(&smi_inst->transaction_lock);
+		dev_err(inst->dev, "smi_init_programmed_read returned %d", ret);
+		return -1;
+	}
 
-        //--------------------------------------------------------
-		// Wait for current chunk to complete
-		// the semaphore will go up when "stream_smi_dma_callback_user_copy" interrupt is trigerred
-		// indicating that the dma transfer finished. If doesn't happen in 1000 jiffies, we have a
-		// timeout. This means that we didn't get enough data into the buffer during this period. we shall
-		// "continue" and try again
-        start = ktime_get();
-        // wait for completion
-        inst->reader_waiting_sema = true;
-        if (down_timeout(&bounce->callback_sem, msecs_to_jiffies(1000))) 
-        {
-            dev_info(inst->dev, "Reader DMA bounce timed out");
-            spin_lock(&inst->smi_inst->transaction_lock);
-            dmaengine_terminate_all(inst->smi_inst->dma_chan);
-            spin_unlock(&inst->smi_inst->transaction_lock);
-        }
-        else
-        {
-            //--------------------------------------------------------
-            // Switch the buffers
-            current_dma_buffer = 1-current_dma_buffer;
-        }
-        inst->reader_waiting_sema = false;
+	spin_unlock(&smi_inst->transaction_lock);
+	ring->cyclic_running = true;
+	dev_info(inst->dev, "cyclic rx started (%u periods of %d bytes)", ring->num_chunks, DMA_BOUNCE_BUFFER_SIZE);
+	return 0;
+}
 
-        t3 = ktime_to_ns(ktime_sub(ktime_get(), start));
-        
-        //dev_info(inst->dev, "TIMING (1,2,3): %lld %lld %lld %d", (long long)t1, (long long)t2, (long long)t3, current_dma_buffer);
+/***************************************************************************/
+static void reader_ring_cyclic_stop(void)
+{
+	struct smi_stream_rx_ring *ring = &inst->rx_ring;
+	struct bcm2835_smi_instance *smi_inst = inst->smi_inst;
+
+	if (!ring->cyclic_running) return;
+
+	spin_lock(&smi_inst->transaction_lock);
+	dmaengine_terminate_all(smi_inst->dma_chan);
+	write_smi_reg(smi_inst, read_smi_reg(smi_inst, SMICS) & ~SMICS_ENABLE, SMICS);
+	spin_unlock(&smi_inst->transaction_lock);
+
+	// the chunk at 'head' was partially written and is never published - the
+	// next run realigns 'head' to the start of the ring
+	ring->cyclic_running = false;
+	dev_info(inst->dev, "cyclic rx stopped");
+}
+
+/***************************************************************************/
+static void reader_ring_cyclic(void)
+{
+	struct smi_stream_rx_ring *ring = &inst->rx_ring;
+	long ret = 0;
+
+	if (!ring->cyclic_running && reader_ring_cyclic_start() != 0)
+	{
+		msleep(10);
+		return;
 	}
 
-	dev_info(inst->dev, "Left reader thread");
-    inst->reader_thread_running = false;
-    inst->reader_waiting_sema = false;
-	return 0; 
-}*/
+	// periods are published by the dma callback, here we only supervise
+	ret = wait_event_interruptible_timeout(ring->cyclic_wait,
+				atomic_read(&ring->cyclic_periods) >= SMI_CYCLIC_PERIODS_PER_ARM ||
+				inst->state == smi_stream_idle ||
+				inst->address_changed ||
+				kthread_should_stop(),
+				msecs_to_jiffies(200));
 
+	if (atomic_read(&ring->cyclic_periods) >= SMI_CYCLIC_PERIODS_PER_ARM)
+	{
+		// the smi transfer count is exhausted - re-arm it, the dma is still running
+		int res = 0;
+		u64 arm_ns = 0;
+		u64 arm_time_ns = ring->cyclic_last_period_ns - ring->cyclic_arm_ns;
+		spin_lock(&inst->smi_inst->transaction_lock);
+		atomic_set(&ring->cyclic_periods, 0);
+		arm_ns = ktime_get_ns();
+		res = smi_init_programmed_read(inst->smi_inst, SMI_CYCLIC_ARM_BYTES);
+		spin_unlock(&inst->smi_inst->transaction_lock);
+
+		// nothing was sampled between the last period and the re-arm - estimate
+		// how much from the rate measured over the previous arm
+		if (res == 0 && arm_time_ns > 0)
+		{
+			u64 gap_ns = min_t(u64, arm_ns - ring->cyclic_last_period_ns, NSEC_PER_SEC);
+			u64 lost = div64_u64(gap_ns * SMI_CYCLIC_ARM_BYTES, arm_time_ns);
+			rx_stats_add_gap((size_t)(lost & ~3ULL));
+		}
+		ring->cyclic_arm_ns = arm_ns;
+		if (res != 0)
+		{
+			dev_err(inst->dev, "smi re-arm failed (%d), restarting cyclic rx", res);
+			reader_ring_cyclic_stop();
+		}
+	}
+	else if (ret == 0)
+	{
+		// no activity for too long - restart the whole chain
+		dev_info(inst->dev, "Reader cyclic DMA timed out");
+		reader_ring_cyclic_stop();
+	}
+}
 
 /***************************************************************************/
 int reader_thread_stream_function(void *pv) 
@@ -775,6 +988,7 @@ int reader_thread_stream_function(void *pv)
     int current_dma_buffer = 0;
 	struct bcm2835_smi_bounce_info *bounce = NULL;
     
+    unsigned int copied = 0;
     ktime_t start;
     s64 t1, t2, t3;
 
@@ -783,8 +997,17 @@ int reader_thread_stream_function(void *pv)
 
 	while(!kthread_should_stop())
 	{       
+        // a running cyclic dma is stopped when the stream / address / mode changes
+        if (inst->rx_ring.cyclic_running &&
+            (inst->state == smi_stream_idle || inst->address_changed || !inst->rx_ring.mapped || !rx_cyclic))
+        {
+            reader_ring_cyclic_stop();
+        }
+
 		// check if the streaming state is on, if not, sleep and check again
-		if (inst->state != smi_stream_rx_channel_0 && inst->state != smi_stream_rx_channel_1)
+		if (inst->state != smi_stream_rx_channel_0 && 
+            inst->state != smi_stream_rx_channel_1 &&
+            inst->state != smi_stream_rx_dual)
 		{
 			msleep(10);
 			continue;
@@ -797,6 +1020,14 @@ int reader_thread_stream_function(void *pv)
             bcm2835_smi_set_address(inst->smi_inst, inst->cur_address);
             inst->address_changed = 0;
         }
+
+        // zero-copy mode - the user consumes the samples in place
+        if (inst->rx_ring.mapped)
+        {
+            if (rx_cyclic) reader_ring_cyclic();
+            else reader_ring_transfer();
+            continue;
+        }
 		
         //--------------------------------------------------------
 		// try setup a new DMA transfer into dma bounce buffer
@@ -823,7 +1054,8 @@ int reader_thread_stream_function(void *pv)
         
         start = ktime_get();
         
-		kfifo_in(&inst->rx_fifo, bounce->buffer[1-current_dma_buffer], DMA_BOUNCE_BUFFER_SIZE);
+		copied = kfifo_in(&inst->rx_fifo, bounce->buffer[1-current_dma_buffer], DMA_BOUNCE_BUFFER_SIZE);
+		rx_stats_add_chunk(DMA_BOUNCE_BUFFER_SIZE - copied, NULL);
 		//mutex_unlock(&inst->read_lock);
 		
 		// for the polling mechanism
@@ -870,6 +1102,8 @@ int reader_thread_stream_function(void *pv)
         //dev_info(inst->dev, "TIMING (1,2,3): %lld %lld %lld %d", (long long)t1, (long long)t2, (long long)t3, current_dma_buffer);
 	}
 
+    reader_ring_cyclic_stop();
+
 	dev_info(inst->dev, "Left reader thread");
     inst->reader_thread_running = false;
     inst->reader_waiting_sema = false;
@@ -967,6 +1201,53 @@ int writer_thread_stream_function(void *pv)
 	return 0;
 }
 
+/***************************************************************************/
+static int rx_ring_alloc(void)
+{
+	struct smi_stream_rx_ring *ring = &inst->rx_ring;
+	unsigned int i = 0;
+
+	ring->num_chunks = fifo_mtu_multiplier;
+	ring->size = PAGE_SIZE + ring->num_chunks * DMA_BOUNCE_BUFFER_SIZE;
+	ring->virt = dma_alloc_coherent(inst->smi_inst->dev, ring->size, &ring->phys, GFP_KERNEL);
+	if (ring->virt == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	// the control page
+	ring->ctrl = (struct smi_stream_rx_ring_ctrl *)ring->virt;
+	memset(ring->ctrl, 0, PAGE_SIZE);
+	ring->ctrl->magic = SMI_STREAM_RX_RING_MAGIC;
+	ring->ctrl->num_chunks = ring->num_chunks;
+	ring->ctrl->chunk_size = DMA_BOUNCE_BUFFER_SIZE;
+	ring->ctrl->data_offset = PAGE_SIZE;
+
+	// a single entry scatter-list per chunk, the same way the bounce buffers are described
+	for (i = 0; i < ring->num_chunks; i++)
+	{
+		sg_init_table(&ring->sgl[i], 1);
+		sg_dma_address(&ring->sgl[i]) = ring->phys + PAGE_SIZE + i * DMA_BOUNCE_BUFFER_SIZE;
+		sg_dma_len(&ring->sgl[i]) = DMA_BOUNCE_BUFFER_SIZE;
+	}
+	ring->mapped = false;
+	return 0;
+}
+
+/***************************************************************************/
+static void rx_ring_free(void)
+{
+	struct smi_stream_rx_ring *ring = &inst->rx_ring;
+
+	ring->mapped = false;
+	if (ring->virt != NULL)
+	{
+		dma_free_coherent(inst->smi_inst->dev, ring->size, ring->virt, ring->phys);
+	}
+	ring->virt = NULL;
+	ring->ctrl = NULL;
+}
+
 /***************************************************************************/
 static int smi_stream_open(struct inode *inode, struct file *file)
 {
@@ -1003,6 +1284,15 @@ static int smi_stream_open(struct inode *inode, struct file *file)
 		return ret;
 	}
 
+	// the zero-copy rx ring - not mandatory, users fall back to read() without it
+	if (rx_ring_alloc() != 0)
+	{
+		dev_warn(inst->dev, "rx ring allocation failed, mmap will be unavailable");
+	}
+
+	// the stream accounting restarts with every open
+	memset(&inst->rx_stats, 0, sizeof(inst->rx_stats));
+
 	// when file is being openned, stream state is still idle
     set_state(smi_stream_idle);
 	
@@ -1017,6 +1307,7 @@ static int smi_stream_open(struct inode *inode, struct file *file)
 		inst->reader_thread = NULL;
 		kfifo_free(&inst->rx_fifo);
 		kfifo_free(&inst->tx_fifo);
+		rx_ring_free();
 		return ret;
 	} 
 
@@ -1035,6 +1326,7 @@ static int smi_stream_open(struct inode *inode, struct file *file)
         
 		kfifo_free(&inst->rx_fifo);
 		kfifo_free(&inst->tx_fifo);
+		rx_ring_free();
 		return ret;
 	} 
 	
@@ -1067,6 +1359,7 @@ static int smi_stream_release(struct inode *inode, struct file *file)
 	
 	if (kfifo_initialized(&inst->rx_fifo)) kfifo_free(&inst->rx_fifo);
 	if (kfifo_initialized(&inst->tx_fifo)) kfifo_free(&inst->tx_fifo);
+	rx_ring_free();
     
     inst->reader_thread = NULL;
     inst->writer_thread = NULL;
@@ -1155,6 +1448,62 @@ static unsigned int smi_stream_poll(struct file *filp, struct poll_table_struct
 	return mask;
 }
 
+/***************************************************************************/
+static void smi_stream_vma_close(struct vm_area_struct *vma)
+{
+	// back to the kfifo / read() path
+	inst->rx_ring.mapped = false;
+}
+
+static const struct vm_operations_struct smi_stream_vm_ops = 
+{
+	.close = smi_stream_vma_close,
+};
+
+/***************************************************************************/
+static int smi_stream_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct smi_stream_rx_ring *ring = &inst->rx_ring;
+	size_t len = vma->vm_end - vma->vm_start;
+	int ret = 0;
+
+	if (ring->virt == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	if (ring->mapped || inst->state != smi_stream_idle)
+	{
+		dev_err(inst->dev, "rx ring can only be mapped once, while the stream is idle");
+		return -EBUSY;
+	}
+
+	if (vma->vm_pgoff != 0 || len != PAGE_ALIGN(ring->size))
+	{
+		dev_err(inst->dev, "rx ring mmap: expected length %lu at offset 0, got %zu", PAGE_ALIGN(ring->size), len);
+		return -EINVAL;
+	}
+
+	ret = dma_mmap_coherent(inst->smi_inst->dev, vma, ring->virt, ring->phys, ring->size);
+	if (ret)
+	{
+		dev_err(inst->dev, "rx ring dma_mmap_coherent failed (%d)", ret);
+		return ret;
+	}
+	vma->vm_flags |= VM_DONTCOPY | VM_DONTEXPAND;
+	vma->vm_ops = &smi_stream_vm_ops;
+
+	// start from an empty ring
+	ring->ctrl->head = 0;
+	ring->ctrl->tail = 0;
+	ring->ctrl->overflows = 0;
+	ring->mapped = true;
+
+	dev_info(inst->dev, "rx ring mapped (%u chunks of %d bytes, %s)", ring->num_chunks, DMA_BOUNCE_BUFFER_SIZE,
+				rx_cyclic ? "cyclic" : "per chunk");
+	return 0;
+}
+
 /***************************************************************************/
 static const struct file_operations smi_stream_fops = 
 {
@@ -1165,6 +1514,7 @@ static const struct file_operations smi_stream_fops =
 	.read = smi_stream_read_file_fifo,
 	.write = smi_stream_write_file,
 	.poll = smi_stream_poll,
+	.mmap = smi_stream_mmap,
 };
 
 /****************************************************************************
@@ -1351,6 +1701,12 @@ static int smi_stream_dev_probe(struct platform_device *pdev)
     inst->writer_thread_running = false;
     inst->reader_waiting_sema = false;
     inst->writer_waiting_sema = false;
+	inst->rx_ring.virt = NULL;
+	inst->rx_ring.mapped = false;
+	inst->rx_ring.cyclic_running = false;
+	atomic_set(&inst->rx_ring.cyclic_periods, 0);
+	init_waitqueue_head(&inst->rx_ring.cyclic_wait);
+	spin_lock_init(&inst->rx_stats_lock);
 	mutex_init(&inst->read_lock);
 	mutex_init(&inst->write_lock);
 
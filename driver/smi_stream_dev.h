@@ -70,6 +70,7 @@ typedef enum
     smi_stream_rx_channel_0 = 1,
     smi_stream_rx_channel_1 = 2,
     smi_stream_tx_channel = 3,
+    smi_stream_rx_dual = 4,         // both rx channels interleaved by the FPGA (word bit 16 = channel)
 } smi_stream_state_en;
 
 #ifdef __KERNEL__
@@ -105,5 +106,51 @@ struct bcm2835_smi_instance {
 #define SMI_STREAM_IOC_GET_FIFO_MULT 	        _IO(BCM2835_SMI_IOC_MAGIC,(BCM2835_SMI_IOC_MAX+7))
 #define SMI_STREAM_IOC_GET_ADDR_DIR_OFFSET 	    _IO(BCM2835_SMI_IOC_MAGIC,(BCM2835_SMI_IOC_MAX+8))
 #define SMI_STREAM_IOC_GET_ADDR_CH_OFFSET 	    _IO(BCM2835_SMI_IOC_MAGIC,(BCM2835_SMI_IOC_MAX+9))
+#define SMI_STREAM_IOC_GET_RX_RING_SIZE 	    _IO(BCM2835_SMI_IOC_MAGIC,(BCM2835_SMI_IOC_MAX+10))
+#define SMI_STREAM_IOC_SET_RX_CYCLIC 	        _IO(BCM2835_SMI_IOC_MAGIC,(BCM2835_SMI_IOC_MAX+11))
+#define SMI_STREAM_IOC_GET_RX_STATS 	        _IO(BCM2835_SMI_IOC_MAGIC,(BCM2835_SMI_IOC_MAX+12))
+
+// RX accounting since the device was opened (SMI_STREAM_IOC_GET_RX_STATS)
+// Every DMA chunk is tagged when it completes, the position of a byte in the stream
+// (stream_bytes) also counts the bytes that were lost on the way to the user.
+struct smi_stream_rx_chunk_info
+{
+	uint64_t timestamp_ns;              // CLOCK_MONOTONIC when the chunk was complete
+	uint64_t stream_bytes;              // bytes received by the SMI up to the chunk end
+	uint64_t lost_bytes;                // bytes lost up to the chunk end (overflows)
+};
+
+struct smi_stream_rx_stats
+{
+	struct smi_stream_rx_chunk_info last_chunk;
+	uint64_t pending_bytes;             // complete but not yet consumed (fifo / ring)
+};
+
+// RX ring shared with the user through mmap (length given by SMI_STREAM_IOC_GET_RX_RING_SIZE)
+// The mapping starts with this control page followed by 'num_chunks' chunks of 'chunk_size'
+// bytes each. The driver DMAs straight into the chunks and advances 'head' when a chunk is
+// complete, the user advances 'tail' when done with it. Both count chunks and are free
+// running (chunk index = count % num_chunks). While mapped, read() returns no RX data.
+// The chunk at 'head' is owned by the DMA, so at most 'num_chunks - 1' chunks are ready.
+// In cyclic mode (SMI_STREAM_IOC_SET_RX_CYCLIC, default) the DMA never stops - when
+// 'head - tail' reaches 'num_chunks' the chunk at 'tail' is being overwritten. Otherwise
+// the driver drops new chunks (counting 'overflows') until the user catches up.
+// When the cyclic DMA (re)starts 'head' jumps forward to 'first_valid' and the user
+// should move 'tail' up to it if it is behind.
+#define SMI_STREAM_RX_RING_MAGIC                (0x52494D53)        // "SMIR"
+#define SMI_STREAM_RX_RING_MAX_CHUNKS           (20)
+
+struct smi_stream_rx_ring_ctrl
+{
+	uint32_t magic;
+	uint32_t num_chunks;
+	uint32_t chunk_size;
+	uint32_t data_offset;               // offset of the first chunk from the mapping start
+	volatile uint32_t head;             // written by the driver only
+	volatile uint32_t tail;             // written by the user only
+	volatile uint32_t overflows;        // chunks dropped while the ring was full
+	volatile uint32_t first_valid;      // written by the driver only - chunks before it are not valid
+	struct smi_stream_rx_chunk_info chunk_info[SMI_STREAM_RX_RING_MAX_CHUNKS];	// valid once published
+};
 
 #endif /* _SMI_STREAM_DEV_H_ */
@@ -30,6 +30,7 @@ module smi_ctrl
     input               i_smi_test,
     output              o_channel,
         output              o_dir,
+    output              o_rx_dual,
 
     // TX CONDITIONAL
     output reg          o_cond_tx,
@@ -44,7 +45,8 @@ module smi_ctrl
         ioc_module_version  = 5'b00000,     // read only
         ioc_fifo_status     = 5'b00001,     // read-only
         ioc_channel_select  = 5'b00010,
-        ioc_dir_select      = 5'b00011;
+        ioc_dir_select      = 5'b00011,
+        ioc_rx_dual         = 5'b00100;
 
     // ---------------------------------
     // MODULE SPECIFIC PARAMS
@@ -57,12 +59,14 @@ module smi_ctrl
     // ---------------------------------------
     assign o_channel = r_channel;
     assign o_dir = r_dir;
+    assign o_rx_dual = r_rx_dual;
     always @(posedge i_sys_clk or negedge i_rst_b)
     begin
         if (i_rst_b == 1'b0) begin
             o_address_error <= 1'b0;
             r_dir <= 1'b0;
             r_channel <= 1'b0;
+            r_rx_dual <= 1'b0;
         end else begin
             if (i_cs == 1'b1) begin
                 //=============================================
@@ -80,7 +84,8 @@ module smi_ctrl
                             o_data_out[2] <= r_channel;
                             o_data_out[3] <= i_smi_test;
                             o_data_out[4] <= r_dir;
-                            o_data_out[7:4] <= 3'b000;
+                            o_data_out[5] <= r_rx_dual;
+                            o_data_out[7:6] <= 2'b00;
                         end
                     endcase
                 end
@@ -97,6 +102,10 @@ module smi_ctrl
                         ioc_dir_select: begin
                             r_dir <= i_data_in[0];
                         end
+                        //----------------------------------------------
+                        ioc_rx_dual: begin
+                            r_rx_dual <= i_data_in[0];
+                        end
                     endcase
                 end
             end
@@ -114,6 +123,7 @@ module smi_ctrl
     wire w_fifo_pull_trigger;
     reg r_channel;
     reg r_dir;
+    reg r_rx_dual;
     reg [31:0] r_fifo_pulled_data;
 
     wire soe_and_reset;
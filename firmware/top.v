@@ -337,9 +337,35 @@ module top (
       .o_debug_state()
   );
 
+  // Dual channel RX - both modem streams share the rx fifo. Each lvds_rx pushes
+  // at most once every 16 clocks, so a 2.4GHz word colliding with a 900MHz one
+  // is delayed by a single clock. Bit 16 (always '0' from the modem) carries
+  // the source channel: '0' = RX09, '1' = RX24.
+  wire w_rx_dual;
+  reg r_rx_24_pending;
+  reg [31:0] r_rx_24_pending_data;
+
+  always @(posedge lvds_clock_buf or negedge i_rst_b) begin
+    if (i_rst_b == 1'b0) begin
+      r_rx_24_pending <= 1'b0;
+    end else begin
+      r_rx_24_pending <= w_rx_dual && w_rx_09_fifo_push && w_rx_24_fifo_push;
+      r_rx_24_pending_data <= w_rx_24_fifo_data;
+    end
+  end
+
+  wire w_rx_dual_push_24 = r_rx_24_pending || (w_rx_24_fifo_push && !w_rx_09_fifo_push);
+  wire [31:0] w_rx_dual_data_24 = r_rx_24_pending ? r_rx_24_pending_data : w_rx_24_fifo_data;
+  wire w_rx_dual_push = w_rx_09_fifo_push || w_rx_dual_push_24;
+  wire [31:0] w_rx_dual_data = w_rx_09_fifo_push ? 
+                                  {w_rx_09_fifo_data[31:17], 1'b0, w_rx_09_fifo_data[15:0]} :
+                                  {w_rx_dual_data_24[31:17], 1'b1, w_rx_dual_data_24[15:0]};
+
   wire w_rx_fifo_write_clk = lvds_clock_buf; //(channel == 1'b0) ? w_rx_09_fifo_write_clk : w_rx_24_fifo_write_clk;
-  wire w_rx_fifo_push = (channel == 1'b0) ? w_rx_09_fifo_push : w_rx_24_fifo_push;
-  wire [31:0] w_rx_fifo_data = (channel == 1'b0) ? w_rx_09_fifo_data : w_rx_24_fifo_data;
+  wire w_rx_fifo_push = w_rx_dual ? w_rx_dual_push : 
+                        (channel == 1'b0) ? w_rx_09_fifo_push : w_rx_24_fifo_push;
+  wire [31:0] w_rx_fifo_data = w_rx_dual ? w_rx_dual_data : 
+                        (channel == 1'b0) ? w_rx_09_fifo_data : w_rx_24_fifo_data;
   wire w_rx_fifo_pull;
   wire [31:0] w_rx_fifo_pulled_data;
   wire w_rx_fifo_full;
@@ -447,6 +473,7 @@ module top (
       .o_smi_write_req(w_smi_write_req),
       .o_channel(/*channel*/),
       .o_dir (/*w_smi_data_direction*/),
+      .o_rx_dual(w_rx_dual),
       .i_smi_test(1'b0/*w_debug_smi_test*/),
       .o_cond_tx(),
       .o_address_error()
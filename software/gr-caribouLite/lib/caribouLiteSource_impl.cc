@@ -7,13 +7,14 @@
 
 #include <gnuradio/io_signature.h>
 #include "caribouLiteSource_impl.h"
+#include <algorithm>
+#include <cstring>
 
 namespace gr {
     namespace caribouLite {
         
         #define NUM_NATIVE_MTUS_PER_QUEUE		( 10 )
-        #define USE_ASYNC_OVERRIDE_WRITES       ( true )
-        #define USE_ASYNC_BLOCK_READS           ( true )
+        #define RX_WAIT_TIMEOUT_MS              ( 100 )
         
         using output_type = gr_complex;
 
@@ -47,7 +48,7 @@ namespace gr {
                           gr::io_signature::make(0, 0, 0),
                           gr::io_signature::make(1 /* min outputs */, 1 /*max outputs */, sizeof(output_type)))
         {
-            _rx_queue = NULL;
+            _rx_chunk_offset = 0;
             _channel = (CaribouLiteRadio::RadioType)channel;
             _enable_agc = enable_agc;
             _rx_gain = rx_gain;
@@ -61,35 +62,39 @@ namespace gr {
             
             _mtu_size = _radio->GetNativeMtuSample();
             
-            _rx_queue = new circular_buffer<gr_complex>(_mtu_size * NUM_NATIVE_MTUS_PER_QUEUE, 
-                                                         USE_ASYNC_OVERRIDE_WRITES, 
-                                                         USE_ASYNC_BLOCK_READS);
-            
+
             // setup parameters
             _radio->SetRxGain(rx_gain);
             _radio->SetAgc(enable_agc);
             _radio->SetRxBandwidth(rx_bw);
             _radio->SetRxSampleRate(sample_rate);
             _radio->SetFrequency(freq);
-            _radio->StartReceiving([this](CaribouLiteRadio* radio, const std::complex<float>* samples, CaribouLiteMeta* sync, size_t num_samples) {
-                receivedSamples(radio, samples, sync, num_samples);
-            });
+            
+            // the chunks are queued as leased from the radio's pool (no copy on the rx
+            // thread) - the pool size bounds the queue
+            _radio->StartReceivingLeased([this](CaribouLiteRadio* radio, CaribouLiteRxLease lease) {
+                receivedSamples(radio, lease);
+            }, true, _mtu_size, NUM_NATIVE_MTUS_PER_QUEUE);
         }
 
         // virtual destructor
         //-------------------------------------------------------------------------------------------------------------
         caribouLiteSource_impl::~caribouLiteSource_impl()
         {
+            // waits for the rx thread to park and drops the callback capturing 'this'
+            // before the members it pushes to go away
             _radio->StopReceiving();
-            if (_rx_queue) delete _rx_queue;
         }
         
         // Receive samples callback
         //-------------------------------------------------------------------------------------------------------------
-        void caribouLiteSource_impl::receivedSamples(CaribouLiteRadio* radio, const std::complex<float>* samples, CaribouLiteMeta* sync, size_t num_samples)
+        void caribouLiteSource_impl::receivedSamples(CaribouLiteRadio* radio, CaribouLiteRxLease lease)
         {
-            //std::cout << "Radio: " << radio->GetRadioName() << " Received " << std::dec << num_samples << " samples" << std::endl;
-            _rx_queue->put(static_cast<const gr_complex*>(samples), num_samples);
+            {
+                std::lock_guard<std::mutex> lock(_rx_mutex);
+                _rx_chunks.push_back(lease);
+            }
+            _rx_cv.notify_one();
         }
 
         //-------------------------------------------------------------------------------------------------------------
@@ -98,8 +103,26 @@ namespace gr {
                                             gr_vector_void_star &output_items)
         {
             auto out = static_cast<output_type*>(output_items[0]);
-            size_t num_read = _rx_queue->get(out, noutput_items);
-            return noutput_items;
+            size_t num_read = 0;
+            
+            std::unique_lock<std::mutex> lock(_rx_mutex);
+            _rx_cv.wait_for(lock, std::chrono::milliseconds(RX_WAIT_TIMEOUT_MS), [this]{return !_rx_chunks.empty();});
+            
+            // copy straight out of the leased chunks, handing each back once consumed
+            while (num_read < (size_t)noutput_items && !_rx_chunks.empty())
+            {
+                const CaribouLiteRxChunk* chunk = _rx_chunks.front().get();
+                size_t len = std::min(chunk->length - _rx_chunk_offset, (size_t)noutput_items - num_read);
+                memcpy(out + num_read, chunk->samples + _rx_chunk_offset, len * sizeof(output_type));
+                num_read += len;
+                _rx_chunk_offset += len;
+                if (_rx_chunk_offset >= chunk->length)
+                {
+                    _rx_chunks.pop_front();
+                    _rx_chunk_offset = 0;
+                }
+            }
+            return num_read;
         }
 
     } /* namespace caribouLite */
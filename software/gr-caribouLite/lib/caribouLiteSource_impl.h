@@ -10,7 +10,9 @@
 
 #include <gnuradio/caribouLite/caribouLiteSource.h>
 #include <CaribouLite.hpp>
-#include "circular_buffer.h"
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 namespace gr 
 {
@@ -29,10 +31,15 @@ namespace gr
             
             CaribouLite* _cl;
             CaribouLiteRadio *_radio;
-            circular_buffer<gr_complex> *_rx_queue;
+            
+            // received chunks, kept leased from the radio until they are copied out
+            std::deque<CaribouLiteRxLease> _rx_chunks;
+            size_t _rx_chunk_offset;
+            std::mutex _rx_mutex;
+            std::condition_variable _rx_cv;
 
         private:
-            void receivedSamples(CaribouLiteRadio* radio, const std::complex<float>* samples, CaribouLiteMeta* sync, size_t num_samples);
+            void receivedSamples(CaribouLiteRadio* radio, CaribouLiteRxLease lease);
             
         public:
             caribouLiteSource_impl(int channel, bool enable_agc, float rx_gain, float rx_bw, float sample_rate, float freq);
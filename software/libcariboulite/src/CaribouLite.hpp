@@ -22,7 +22,9 @@
 #include <thread>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
 #include <functional>
+#include <atomic>
 
 #if __cplusplus <= 199711L
   #error This file needs at least a C++11 compliant compiler, try using:
@@ -80,7 +82,29 @@ struct CaribouLiteMeta
     uint8_t sync;
 };
 #pragma pack()
+
+/**
+ * @brief A received chunk leased from the radio's buffer pool
+ *
+ * Handed to "StartReceivingLeased" consumers as a CaribouLiteRxLease. The buffers
+ * stay valid (and out of the rx thread's reach) for as long as any copy of the
+ * lease exists - the chunk returns to the pool when the last one is released.
+ * Only one of 'samples' / 'samples_int' is set, by the format chosen at start.
+ */
+struct CaribouLiteRxChunk
+{
+    std::complex<float>* samples;
+    CaribouLiteComplexInt* samples_int;
+    CaribouLiteMeta* meta;
+    size_t length;
+};
+typedef std::shared_ptr<const CaribouLiteRxChunk> CaribouLiteRxLease;
  
+class CaribouLiteRxBufferPool;
+class CaribouLiteRxConsumer;
+template <class T> class spsc_circular_buffer;
+template <class T> class mirrored_circular_buffer;
+
 class CaribouLite;
 class CaribouLiteRadio
 {
@@ -104,6 +128,31 @@ public:
         Float = 2,
         IntSync = 3,
         Int = 4,
+        Pull = 5,
+        LeasedFloat = 6,
+        LeasedInt = 7,
+    };
+    
+    // what a consumer's full queue does to the shared stream
+    enum RxConsumerPolicy
+    {
+        DropNewest = 0,     // the chunk is dropped for this consumer only
+        Block = 1,          // the shared read waits for the consumer (stalls all of them)
+    };
+    
+    struct RxConsumerStats
+    {
+        uint64_t delivered_samples;
+        uint64_t dropped_samples;
+        size_t queued_samples;          // current lag behind the stream
+        size_t max_queued_samples;
+    };
+    
+    struct StreamStats
+    {
+        cariboulite_radio_stream_stats_st smi;          // the SMI stream (shared by both radios)
+        uint64_t queue_dropped_samples;                 // this radio's pull ring, buffer pool and consumer queues
+        cariboulite_latency_hist_st callback_duration;  // the rx thread's hand-off (callback / dispatch)
     };
 
 public:
@@ -160,6 +209,12 @@ public:
     float GetFrequency(void);
     std::vector<CaribouLiteFreqRange> GetFrequencyRange(void);
     float GetFrequencyResolution(void);
+    // Frequency hopping - the table is worked out once, a hop writes only the registers
+    // that differ from the previous one (see cariboulite_radio_prepare_hop_table)
+    void SetHopTable(const std::vector<double>& freqs_hz);
+    void Hop(size_t index, bool wait_lock = false);
+    // measured PLL lock times of the frequency switches (e.g. to choose a hop dwell)
+    cariboulite_radio_tune_stats_st GetTuneStats(void);
     
     // Activation
     void StartReceiving(std::function<void(CaribouLiteRadio*, const std::complex<float>*, CaribouLiteMeta*, size_t)> on_data_ready, size_t samples_per_chunk = 0);
@@ -167,13 +222,65 @@ public:
     void StartReceiving(std::function<void(CaribouLiteRadio*, const CaribouLiteComplexInt*, CaribouLiteMeta*, size_t)> on_data_ready, size_t samples_per_chunk = 0);
     void StartReceiving(std::function<void(CaribouLiteRadio*, const CaribouLiteComplexInt*, size_t)> on_data_ready, size_t samples_per_chunk = 0);
     void StartReceivingInternal(size_t samples_per_chunk);
+    // returns once the rx thread is parked and the callbacks are released - no callback
+    // runs after it (unless called from a callback, which can't wait for itself). Receiving
+    // can't be (re)started from a callback, nor while GetIsReceivingDual (both throw).
     void StopReceiving(void);
-    void StartTransmitting(std::function<void(CaribouLiteRadio*, std::complex<float>*, const bool*, size_t*)> on_data_request, size_t samples_per_chunk);
+    
+    // Pull mode - instead of a callback, the rx thread fills a ring of 'queue_chunks' x
+    // 'samples_per_chunk' samples that the application reads from its own thread. The
+    // reads wait up to 'timeout_us' for the whole request and return whatever is there
+    // once it expires (0 when nothing arrived). 'overflow' is set when samples were
+    // dropped since the previous read because the ring was full. Only one thread may read.
+    void StartReceivingPull(size_t samples_per_chunk = 0, size_t queue_chunks = 8);
+    int ReadSamples(CaribouLiteComplexInt* samples, size_t num_samples, long timeout_us = 100000, bool* overflow = NULL);
+    int ReadSamples(std::complex<float>* samples, size_t num_samples, long timeout_us = 100000, bool* overflow = NULL);
+    // zero-copy variant - a window of up to 'max_samples' samples straight in the ring. They
+    // stay valid until handed back by 'ReleaseSamples' (possibly fewer than acquired).
+    int AcquireSamples(const CaribouLiteComplexInt** samples, size_t max_samples, long timeout_us = 100000, bool* overflow = NULL);
+    void ReleaseSamples(size_t num_samples);
+    uint64_t GetRxOverflows(void);
+    
+    // Leased mode - every chunk is read into a buffer taken from a pool of 'pool_size'
+    // buffers and handed to the callback as a lease it may keep (e.g. queue for another
+    // thread) without copying. When all the buffers are leased out the incoming chunks
+    // are dropped - counted by 'GetRxLeaseDrops' (in samples).
+    void StartReceivingLeased(std::function<void(CaribouLiteRadio*, CaribouLiteRxLease)> on_data_ready, 
+                              bool float_samples = true, size_t samples_per_chunk = 0, size_t pool_size = 8);
+    uint64_t GetRxLeaseDrops(void);
+    
+    // Fan-out - every consumer runs its callback on its own thread, fed from a queue of
+    // up to 'queue_depth' chunks leased from the single shared read (no copies).
+    // Consumers are best added before 'StartReceivingConsumers', which sizes the buffer
+    // pool for all of them. 'AddConsumer' returns the consumer's id. A consumer can't
+    // remove itself from within its own callback.
+    int AddConsumer(std::function<void(CaribouLiteRadio*, CaribouLiteRxLease)> on_data_ready, 
+                    size_t queue_depth = 4, RxConsumerPolicy policy = RxConsumerPolicy::DropNewest);
+    void RemoveConsumer(int id);
+    RxConsumerStats GetConsumerStats(int id);
+    void StartReceivingConsumers(bool float_samples = true, size_t samples_per_chunk = 0);
+    // The data request callback gets a buffer of 'samples_per_chunk' samples (scaled to [-1, 1)),
+    // a flag set when the transmission ran dry since the previous call, and the number of samples
+    // to fill - set it to the number actually filled (none = asked again after a short back off).
+    // The samples are scaled by 4096 and clipped. 'queue_depth' chunks are pipelined between
+    // the callback and the hardware.
+    void StartTransmitting(std::function<void(CaribouLiteRadio*, std::complex<float>*, const bool*, size_t*)> on_data_request, size_t samples_per_chunk, size_t queue_depth = 2);
     void StartTransmittingLo(void);
     void StartTransmittingCw(void);
     void StopTransmitting(void);
     bool GetIsTransmittingLo(void);
     bool GetIsTransmittingCw(void);   
+    uint64_t GetTxUnderruns(void);
+    
+    // Streaming threads (rx, tx and writer) scheduling, affinity and memory - applied by
+    // the threads when they start (the rx thread also picks up changes while running).
+    // Parts the process lacks the privileges for are skipped with a warning.
+    void SetStreamThreadConfig(const cariboulite_thread_config_st& cfg);
+    cariboulite_thread_config_st GetStreamThreadConfig(void);
+    
+    // Always-on stream counters - throughput, drops at every stage and the read latency
+    // and callback duration histograms. Safe to call while streaming.
+    StreamStats GetStreamStats(void);
     
     // General
     size_t GetNativeMtuSample(void);
@@ -184,25 +291,60 @@ private:
     const CaribouLite* _device;
     const RadioType _type;
     
-    bool _rx_thread_running;
-    bool _rx_is_active;
+    // the rx thread is created on the first StartReceiving and parks on '_rx_cv'
+    // while the radio is not receiving
+    std::atomic<bool> _rx_thread_running;
+    std::atomic<bool> _rx_is_active;
+    bool _rx_thread_parked;                             // guarded by '_rx_mutex'
     std::thread *_rx_thread;
+    std::mutex _rx_mutex;
+    std::condition_variable _rx_cv;
     std::function<void(CaribouLiteRadio*, const std::complex<float>*, CaribouLiteMeta*, size_t)> _on_data_ready_fm;
     std::function<void(CaribouLiteRadio*, const std::complex<float>*, size_t)> _on_data_ready_f;
     std::function<void(CaribouLiteRadio*, const CaribouLiteComplexInt*, CaribouLiteMeta*, size_t)> _on_data_ready_im;
     std::function<void(CaribouLiteRadio*, const CaribouLiteComplexInt*, size_t)> _on_data_ready_i;
     size_t _rx_samples_per_chunk;
     RxCbType _rxCallbackType;
+    mirrored_circular_buffer<CaribouLiteComplexInt>* _rx_pull_queue;
+    uint64_t _rx_pull_overflows_reported;
+    std::function<void(CaribouLiteRadio*, CaribouLiteRxLease)> _on_data_ready_leased;
+    std::shared_ptr<CaribouLiteRxBufferPool> _rx_pool;
+    std::atomic<uint64_t> _rx_lease_drops;
+    cariboulite_latency_hist_st _rx_cb_hist;            // written by the rx thread only
+    cariboulite_thread_config_st _stream_cfg;
+    std::mutex _stream_cfg_mutex;
+    std::atomic<unsigned int> _stream_cfg_gen;
+    std::vector<std::shared_ptr<CaribouLiteRxConsumer>> _rx_consumers;
+    std::mutex _rx_consumers_mutex;
+    int _rx_next_consumer_id;
     
-    bool _tx_thread_running;
+    std::atomic<bool> _tx_thread_running;
     bool _tx_is_active;
     std::thread *_tx_thread;
+    std::thread *_tx_writer_thread;
     std::function<void(CaribouLiteRadio*, std::complex<float>*, const bool*, size_t*)> _on_data_request;
     size_t _tx_samples_per_chunk;
     
+    // TX pipeline - chunk indices circulate between the tx thread (callback and packing)
+    // and the writer thread through the free / ready queues
+    size_t _tx_queue_depth;
+    uint32_t* _tx_packed_buffers;
+    size_t* _tx_packed_lengths;
+    spsc_circular_buffer<size_t>* _tx_free_queue;
+    spsc_circular_buffer<size_t>* _tx_ready_queue;
+    std::atomic<uint64_t> _tx_underruns;
+    std::atomic<bool> _tx_underrun_flag;
+    
 private:
     static void CaribouLiteRxThread(CaribouLiteRadio* radio);
     static void CaribouLiteTxThread(CaribouLiteRadio* radio);
+    static void CaribouLiteTxWriterThread(CaribouLiteRadio* radio);
+    void StopTransmittingInternal(void);
+    void StopRxThread(void);
+    bool ParkRxThread(void);
+    void StopReceivingForStart(void);
+    void DispatchToConsumers(CaribouLiteRxLease lease);
+    size_t PullWindow(const CaribouLiteComplexInt** samples, size_t num_samples, long timeout_us, bool* overflow);
 };
 
 /**
@@ -242,6 +384,13 @@ public:
     std::string GetHwGuid(void);
     CaribouLiteRadio* GetRadioChannel(CaribouLiteRadio::RadioType ch);
     
+    // Simultaneous reception on both channels - the callback is invoked per radio
+    // with the samples of that channel (requires dual rx firmware support). The radios' own
+    // rx threads are parked first, and their StartReceiving* throw until StopReceivingDual.
+    void StartReceivingDual(std::function<void(CaribouLiteRadio*, const std::complex<float>*, size_t)> on_data_ready, size_t samples_per_chunk = 0);
+    void StopReceivingDual(void);
+    bool GetIsReceivingDual(void);
+    
     // Ststic detection and factory
     static CaribouLite &GetInstance(bool forceFpgaProg = false, LogLevel logLvl = LogLevel::None);
     static bool DetectBoard(SysVersion *sysVer, std::string& name, std::string& guid);
@@ -253,6 +402,13 @@ private:
     std::string _productName;
     std::string _productGuid;
     
+    std::atomic<bool> _dual_rx_running;
+    std::thread *_dual_rx_thread;
+    std::function<void(CaribouLiteRadio*, const std::complex<float>*, size_t)> _on_dual_data_ready;
+    size_t _dual_rx_samples_per_chunk;
+    
+    static void CaribouLiteDualRxThread(CaribouLite* dev);
+    
     static std::shared_ptr<CaribouLite> _instance;
     static std::mutex _instMutex;
 };
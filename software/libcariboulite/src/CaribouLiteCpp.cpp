@@ -56,6 +56,10 @@ CaribouLite &CaribouLite::GetInstance(bool forceFpgaProg, LogLevel logLvl)
 //==================================================================
 CaribouLite::CaribouLite(bool forceFpgaProg, LogLevel logLvl)
 {
+    _dual_rx_running = false;
+    _dual_rx_thread = NULL;
+    _dual_rx_samples_per_chunk = 0;
+    
     if (cariboulite_init(forceFpgaProg, (cariboulite_log_level_en)logLvl) != 0)
     {
         throw std::runtime_error("Driver initialization failed");
@@ -81,6 +85,7 @@ CaribouLite::CaribouLite(bool forceFpgaProg, LogLevel logLvl)
 void CaribouLite::ReleaseResources(void)
 {
     if (!_instance) return;
+    _instance->StopReceivingDual();
     for (size_t i = 0; i < _instance->_channels.size(); i++)
     {
         if (_instance->_channels[i]) delete _instance->_channels[i];
@@ -157,4 +162,100 @@ CaribouLiteRadio* CaribouLite::GetRadioChannel(CaribouLiteRadio::RadioType ch)
 {
     return _channels[(int)ch];
 }
+
+//==================================================================
+void CaribouLite::CaribouLiteDualRxThread(CaribouLite* dev)
+{
+    // each channel may get up to the whole chunk
+    size_t chunk = dev->_dual_rx_samples_per_chunk;
+    std::complex<float>* rx_data[2] = {new std::complex<float>[chunk], new std::complex<float>[chunk]};
+    cariboulite_radio_state_st* radio = cariboulite_get_radio(cariboulite_channel_s1g);
+    
+    // the dual stream runs with the S1G radio's streaming configuration
+    cariboulite_thread_config_st cfg = dev->_channels[0]->GetStreamThreadConfig();
+    cariboulite_thread_state_st prev;
+    cariboulite_apply_thread_config(&cfg, &prev);
+    cariboulite_prefault_buffer(&cfg, rx_data[0], chunk * sizeof(std::complex<float>));
+    cariboulite_prefault_buffer(&cfg, rx_data[1], chunk * sizeof(std::complex<float>));
     
+    while (dev->_dual_rx_running)
+    {
+        void* buffers[2] = {rx_data[0], rx_data[1]};
+        cariboulite_sample_meta* meta[2] = {NULL, NULL};
+        size_t counts[2] = {0, 0};
+        
+        int ret = cariboulite_radio_read_samples_dual(radio, cariboulite_sample_format_cf32, buffers, meta, chunk, counts);
+        if (ret <= 0)
+        {
+            if (ret == -1)
+            {
+                printf("dual reader thread failed to read SMI!\n");
+            }
+            continue;
+        }
+        
+        // notify application - per radio
+        try
+        {
+            for (int ch = 0; ch < 2; ch++)
+            {
+                if (counts[ch] > 0 && dev->_on_dual_data_ready)
+                {
+                    dev->_on_dual_data_ready(dev->_channels[ch], rx_data[ch], counts[ch]);
+                }
+            }
+        }
+        catch (std::exception &e)
+        {
+            std::cout << "OnDataReady Exception: " << e.what() << std::endl;
+        }
+    }
+    
+    cariboulite_restore_thread_config(&prev);
+    delete [] rx_data[0];
+    delete [] rx_data[1];
+}
+
+//==================================================================
+void CaribouLite::StartReceivingDual(std::function<void(CaribouLiteRadio*, const std::complex<float>*, size_t)> on_data_ready, size_t samples_per_chunk)
+{
+    StopReceivingDual();
+    
+    CaribouLiteRadio* s1g = GetRadioChannel(CaribouLiteRadio::RadioType::S1G);
+    CaribouLiteRadio* hif = GetRadioChannel(CaribouLiteRadio::RadioType::HiF);
+    // returns once each radio's rx thread is parked - out of the driver's reads
+    s1g->StopReceiving();
+    hif->StopReceiving();
+    
+    if (cariboulite_radio_activate_rx_dual(cariboulite_get_radio(cariboulite_channel_s1g), 
+                                           cariboulite_get_radio(cariboulite_channel_hif), true) != 0)
+    {
+        throw std::runtime_error("Dual channel reception is not supported");
+    }
+    
+    _dual_rx_samples_per_chunk = (samples_per_chunk == 0 || samples_per_chunk > s1g->GetNativeMtuSample()) ? 
+                                    s1g->GetNativeMtuSample() : samples_per_chunk;
+    _on_dual_data_ready = on_data_ready;
+    _dual_rx_running = true;
+    _dual_rx_thread = new std::thread(CaribouLite::CaribouLiteDualRxThread, this);
+}
+
+//==================================================================
+void CaribouLite::StopReceivingDual(void)
+{
+    if (_dual_rx_thread == NULL) return;
+    
+    _dual_rx_running = false;
+    _dual_rx_thread->join();
+    delete _dual_rx_thread;
+    _dual_rx_thread = NULL;
+    
+    cariboulite_radio_activate_rx_dual(cariboulite_get_radio(cariboulite_channel_s1g), 
+                                       cariboulite_get_radio(cariboulite_channel_hif), false);
+}
+
+//==================================================================
+bool CaribouLite::GetIsReceivingDual(void)
+{
+    return _dual_rx_thread != NULL;
+}
@@ -1,4 +1,200 @@
 #include "CaribouLite.hpp"
+#include "datatypes/spsc_circular_buffer.h"
+#include "datatypes/mirrored_circular_buffer.h"
+#include <cmath>
+#include <deque>
+#include <chrono>
+
+// TX data request back off while the application has nothing to send
+#define TX_IDLE_BACKOFF_MIN_US      (100)
+#define TX_IDLE_BACKOFF_MAX_US      (5000)
+
+//=================================================================
+// Fixed set of rx chunks leased to the application. Each lease holds a reference
+// to the pool, so the pool outlives the radio if the application keeps a lease.
+class CaribouLiteRxBufferPool : public std::enable_shared_from_this<CaribouLiteRxBufferPool>
+{
+public:
+    CaribouLiteRxBufferPool(size_t num_buffers, size_t length, bool float_samples)
+        : _chunks(num_buffers), _length(length), _float_samples(float_samples)
+    {
+        for (size_t i = 0; i < num_buffers; i++)
+        {
+            _chunks[i].samples = float_samples ? new std::complex<float>[length] : NULL;
+            _chunks[i].samples_int = float_samples ? NULL : new CaribouLiteComplexInt[length];
+            _chunks[i].meta = new CaribouLiteMeta[length];
+            _chunks[i].length = 0;
+            _free.push_back(i);
+        }
+    }
+    
+    ~CaribouLiteRxBufferPool()
+    {
+        for (size_t i = 0; i < _chunks.size(); i++)
+        {
+            if (_chunks[i].samples) delete[] _chunks[i].samples;
+            if (_chunks[i].samples_int) delete[] _chunks[i].samples_int;
+            delete[] _chunks[i].meta;
+        }
+    }
+    
+    // a free chunk (filled by the caller before it is handed out as const), or
+    // NULL when all of them are leased
+    std::shared_ptr<CaribouLiteRxChunk> Acquire(void)
+    {
+        size_t idx = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_free.empty()) return NULL;
+            idx = _free.back();
+            _free.pop_back();
+        }
+        
+        std::shared_ptr<CaribouLiteRxBufferPool> self = shared_from_this();
+        return std::shared_ptr<CaribouLiteRxChunk>(&_chunks[idx], [self, idx](CaribouLiteRxChunk*) {
+            std::lock_guard<std::mutex> lock(self->_mutex);
+            self->_free.push_back(idx);
+        });
+    }
+    
+    void Prefault(const cariboulite_thread_config_st* cfg)
+    {
+        for (size_t i = 0; i < _chunks.size(); i++)
+        {
+            if (_chunks[i].samples) cariboulite_prefault_buffer(cfg, _chunks[i].samples, _length * sizeof(std::complex<float>));
+            if (_chunks[i].samples_int) cariboulite_prefault_buffer(cfg, _chunks[i].samples_int, _length * sizeof(CaribouLiteComplexInt));
+            cariboulite_prefault_buffer(cfg, _chunks[i].meta, _length * sizeof(CaribouLiteMeta));
+        }
+    }
+    
+    bool Matches(size_t num_buffers, size_t length, bool float_samples)
+    {
+        return _chunks.size() == num_buffers && _length == length && _float_samples == float_samples;
+    }
+    
+private:
+    std::vector<CaribouLiteRxChunk> _chunks;
+    std::vector<size_t> _free;
+    std::mutex _mutex;
+    size_t _length;
+    bool _float_samples;
+};
+
+//=================================================================
+// A fan-out consumer - its own queue of leased chunks and a thread running
+// the application callback
+class CaribouLiteRxConsumer
+{
+public:
+    CaribouLiteRxConsumer(CaribouLiteRadio* radio, int id, 
+                          std::function<void(CaribouLiteRadio*, CaribouLiteRxLease)> on_data_ready, 
+                          size_t queue_depth, CaribouLiteRadio::RxConsumerPolicy policy)
+        : _radio(radio), _id(id), _on_data_ready(on_data_ready), _queue_depth(queue_depth), _policy(policy)
+    {
+        _stats = {0, 0, 0, 0};
+        _running = true;
+        _thread = std::thread(&CaribouLiteRxConsumer::Run, this);
+    }
+    
+    ~CaribouLiteRxConsumer()
+    {
+        Stop();
+    }
+    
+    void Stop(void)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _running = false;
+        }
+        _cv.notify_all();
+        if (_thread.joinable()) _thread.join();
+    }
+    
+    // called by the rx thread
+    void Push(CaribouLiteRxLease lease)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_queue.size() >= _queue_depth)
+            {
+                if (_policy == CaribouLiteRadio::RxConsumerPolicy::Block)
+                {
+                    _cv.wait(lock, [this]{return _queue.size() < _queue_depth || !_running;});
+                }
+                else
+                {
+                    _stats.dropped_samples += lease->length;
+                    return;
+                }
+            }
+            if (!_running) return;
+            
+            _queue.push_back(lease);
+            _stats.queued_samples += lease->length;
+            if (_stats.queued_samples > _stats.max_queued_samples) _stats.max_queued_samples = _stats.queued_samples;
+        }
+        _cv.notify_all();
+    }
+    
+    CaribouLiteRadio::RxConsumerStats GetStats(void)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _stats;
+    }
+    
+    int GetId(void) {return _id;}
+    size_t GetQueueDepth(void) {return _queue_depth;}
+    
+private:
+    void Run(void)
+    {
+        while (true)
+        {
+            CaribouLiteRxLease lease;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [this]{return !_queue.empty() || !_running;});
+                if (!_running) break;
+                lease = _queue.front();
+                _queue.pop_front();
+                _stats.queued_samples -= lease->length;
+            }
+            // room for a blocked producer
+            _cv.notify_all();
+            
+            try
+            {
+                if (_on_data_ready) _on_data_ready(_radio, lease);
+            }
+            catch (std::exception &e)
+            {
+                std::cout << "OnDataReady Exception: " << e.what() << std::endl;
+            }
+            
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stats.delivered_samples += lease->length;
+        }
+        
+        // hand the remaining chunks back to the pool
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queue.clear();
+        _stats.queued_samples = 0;
+    }
+    
+private:
+    CaribouLiteRadio* _radio;
+    int _id;
+    std::function<void(CaribouLiteRadio*, CaribouLiteRxLease)> _on_data_ready;
+    size_t _queue_depth;
+    CaribouLiteRadio::RxConsumerPolicy _policy;
+    std::deque<CaribouLiteRxLease> _queue;
+    CaribouLiteRadio::RxConsumerStats _stats;
+    bool _running;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::thread _thread;
+};
 
 //=================================================================
 void CaribouLiteRadio::CaribouLiteRxThread(CaribouLiteRadio* radio)
@@ -7,19 +203,99 @@ void CaribouLiteRadio::CaribouLiteRxThread(CaribouLiteRadio* radio)
     CaribouLiteComplexInt* rx_buffer = new CaribouLiteComplexInt[mtu_size];
     CaribouLiteMeta* rx_meta_buffer = new CaribouLiteMeta[mtu_size];
     std::complex<float>* rx_copmlex_data = new std::complex<float>[mtu_size];
+    unsigned int cfg_gen = radio->_stream_cfg_gen;
+    cariboulite_thread_config_st cfg = radio->GetStreamThreadConfig();
+    cariboulite_thread_state_st prev;
+    cariboulite_apply_thread_config(&cfg, &prev);
+    cariboulite_prefault_buffer(&cfg, rx_buffer, mtu_size * sizeof(CaribouLiteComplexInt));
+    cariboulite_prefault_buffer(&cfg, rx_meta_buffer, mtu_size * sizeof(CaribouLiteMeta));
+    cariboulite_prefault_buffer(&cfg, rx_copmlex_data, mtu_size * sizeof(std::complex<float>));
     
     while (radio->_rx_thread_running)
     {
+        if (cfg_gen != radio->_stream_cfg_gen)
+        {
+            cfg_gen = radio->_stream_cfg_gen;
+            cfg = radio->GetStreamThreadConfig();
+            // from the thread's original scheduling - 'default' puts it back
+            cariboulite_restore_thread_config(&prev);
+            cariboulite_apply_thread_config(&cfg, &prev);
+        }
+        
         if (!radio->_rx_is_active)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            // 'ParkRxThread' waits for this - nothing is touched until reactivated
+            std::unique_lock<std::mutex> lock(radio->_rx_mutex);
+            radio->_rx_thread_parked = true;
+            radio->_rx_cv.notify_all();
+            radio->_rx_cv.wait(lock, [radio]{return radio->_rx_is_active || !radio->_rx_thread_running;});
+            radio->_rx_thread_parked = false;
             continue;
         }
         
-        int ret = cariboulite_radio_read_samples((cariboulite_radio_state_st*)radio->_radio, 
-                                                 (cariboulite_sample_complex_int16*)rx_buffer, 
-                                                 (cariboulite_sample_meta*)rx_meta_buffer, 
+        int ret = 0;
+        bool float_cb = (radio->_rxCallbackType == CaribouLiteRadio::RxCbType::FloatSync || 
+                         radio->_rxCallbackType == CaribouLiteRadio::RxCbType::Float);
+        
+        if (radio->_rxCallbackType == CaribouLiteRadio::RxCbType::Pull)
+        {
+            // read straight into the pull ring when a whole chunk fits, otherwise
+            // through the local buffer so that the dropped samples are counted
+            CaribouLiteComplexInt* ptr = NULL;
+            bool in_place = radio->_rx_pull_queue->reserve(&ptr, radio->_rx_samples_per_chunk) == radio->_rx_samples_per_chunk;
+            ret = cariboulite_radio_read_samples((cariboulite_radio_state_st*)radio->_radio, 
+                                                 (cariboulite_sample_complex_int16*)(in_place ? ptr : rx_buffer), 
+                                                 NULL, 
                                                  radio->_rx_samples_per_chunk);
+            if (ret < 0)
+            {
+                if (ret == -1)
+                {
+                    printf("reader thread failed to read SMI!\n");
+                }
+                continue;
+            }
+            if (in_place) radio->_rx_pull_queue->commit(ret);
+            else radio->_rx_pull_queue->put(rx_buffer, ret);
+            continue;
+        }
+        
+        // leased consumers get the chunk read straight into a pool buffer. With
+        // the pool exhausted the chunk is still read (into the local buffers)
+        // to keep the stream going, and dropped.
+        bool leased = (radio->_rxCallbackType == CaribouLiteRadio::RxCbType::LeasedFloat || 
+                       radio->_rxCallbackType == CaribouLiteRadio::RxCbType::LeasedInt);
+        std::shared_ptr<CaribouLiteRxChunk> lease = NULL;
+        std::complex<float>* float_dst = rx_copmlex_data;
+        CaribouLiteComplexInt* int_dst = rx_buffer;
+        CaribouLiteMeta* meta_dst = rx_meta_buffer;
+        if (leased)
+        {
+            float_cb = (radio->_rxCallbackType == CaribouLiteRadio::RxCbType::LeasedFloat);
+            lease = radio->_rx_pool->Acquire();
+            if (lease)
+            {
+                float_dst = lease->samples;
+                int_dst = lease->samples_int;
+                meta_dst = lease->meta;
+            }
+        }
+        
+        // float consumers get the samples decoded straight into the complex buffer
+        if (float_cb)
+        {
+            ret = cariboulite_radio_read_samples_cf32((cariboulite_radio_state_st*)radio->_radio, 
+                                                      (cariboulite_sample_complex_float*)float_dst, 
+                                                      (cariboulite_sample_meta*)meta_dst, 
+                                                      radio->_rx_samples_per_chunk);
+        }
+        else
+        {
+            ret = cariboulite_radio_read_samples((cariboulite_radio_state_st*)radio->_radio, 
+                                                 (cariboulite_sample_complex_int16*)int_dst, 
+                                                 (cariboulite_sample_meta*)meta_dst, 
+                                                 radio->_rx_samples_per_chunk);
+        }
         if (ret < 0)
         {
             if (ret == -1)
@@ -30,17 +306,31 @@ void CaribouLiteRadio::CaribouLiteRxThread(CaribouLiteRadio* radio)
             continue;
         }
         
-        // convert the buffer
-        if (radio->_rxCallbackType == CaribouLiteRadio::RxCbType::FloatSync || radio->_rxCallbackType == CaribouLiteRadio::RxCbType::Float)
+        if (leased)
         {
-            for (int i = 0; i < ret; i ++)
+            if (!lease)
+            {
+                radio->_rx_lease_drops += ret;
+                continue;
+            }
+            
+            lease->length = ret;
+            auto cb_start = std::chrono::steady_clock::now();
+            try
             {
-                rx_copmlex_data[i].real(rx_buffer[i].i / 4096.0);
-                rx_copmlex_data[i].imag(rx_buffer[i].q / 4096.0);
+                if (radio->_on_data_ready_leased) radio->_on_data_ready_leased(radio, lease);
             }
+            catch (std::exception &e)
+            {
+                std::cout << "OnDataReady Exception: " << e.what() << std::endl;
+            }
+            cariboulite_latency_hist_add(&radio->_rx_cb_hist, 
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - cb_start).count());
+            continue;
         }
         
         // notify application
+        auto cb_start = std::chrono::steady_clock::now();
         try
         {
             switch(radio->_rxCallbackType)
@@ -57,36 +347,154 @@ void CaribouLiteRadio::CaribouLiteRxThread(CaribouLiteRadio* radio)
         {
             std::cout << "OnDataReady Exception: " << e.what() << std::endl;
         }
+        cariboulite_latency_hist_add(&radio->_rx_cb_hist, 
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - cb_start).count());
     }
     
+    cariboulite_restore_thread_config(&prev);
     delete[]rx_buffer;
     delete[]rx_meta_buffer;
     delete[]rx_copmlex_data;
 }
 
 //==================================================================
+// Fills and packs the chunks - runs ahead of the writer thread by up to the
+// queue depth, so the application callback and the packing of chunk N+1
+// overlap the write of chunk N
 void CaribouLiteRadio::CaribouLiteTxThread(CaribouLiteRadio* radio)
 {
+    size_t chunk = radio->_tx_samples_per_chunk;
+    std::complex<float>* tx_complex_data = new std::complex<float>[chunk];
+    long backoff_us = 0;
+    cariboulite_thread_config_st cfg = radio->GetStreamThreadConfig();
+    cariboulite_thread_state_st prev;
+    cariboulite_apply_thread_config(&cfg, &prev);
+    cariboulite_prefault_buffer(&cfg, tx_complex_data, chunk * sizeof(std::complex<float>));
+    
     while (radio->_tx_thread_running)
     {
-        if (!radio->_tx_is_active)
+        // a chunk the writer is done with
+        size_t idx = 0;
+        if (radio->_tx_free_queue->get(&idx, 1, 10000) == 0)
+        {
+            continue;
+        }
+        
+        size_t len = chunk;
+        bool underrun = radio->_tx_underrun_flag.exchange(false);
+        try
+        {
+            if (radio->_on_data_request) radio->_on_data_request(radio, tx_complex_data, &underrun, &len);
+            else len = 0;
+        }
+        catch (std::exception &e)
+        {
+            std::cout << "OnDataRequest Exception: " << e.what() << std::endl;
+            len = 0;
+        }
+        if (len > chunk) len = chunk;
+        
+        if (len == 0)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(4));
+            // nothing to send - the chunk stays free and the application is asked
+            // again after a growing back off instead of in a tight loop
+            radio->_tx_free_queue->put(idx);
+            backoff_us = (backoff_us == 0) ? TX_IDLE_BACKOFF_MIN_US : std::min(2 * backoff_us, (long)TX_IDLE_BACKOFF_MAX_US);
+            std::this_thread::sleep_for(std::chrono::microseconds(backoff_us));
             continue;
         }
-        // TBD
+        backoff_us = 0;
+        
+        // scaling (x4096, as the Soapy stream), saturation and packing in one pass
+        cariboulite_radio_pack_samples_cf32((cariboulite_radio_state_st*)radio->_radio, 
+                                            (const cariboulite_sample_complex_float*)tx_complex_data, 
+                                            radio->_tx_packed_buffers + idx * chunk, 
+                                            len);
+        radio->_tx_packed_lengths[idx] = len;
+        radio->_tx_ready_queue->put(idx);
     }
+    
+    cariboulite_restore_thread_config(&prev);
+    delete[]tx_complex_data;
+}
+
+//==================================================================
+// Writes the packed chunks in order. Finding no ready chunk once the stream
+// has started means the application didn't keep up - counted as an underrun.
+void CaribouLiteRadio::CaribouLiteTxWriterThread(CaribouLiteRadio* radio)
+{
+    bool streaming = false;
+    cariboulite_thread_config_st cfg = radio->GetStreamThreadConfig();
+    cariboulite_thread_state_st prev;
+    cariboulite_apply_thread_config(&cfg, &prev);
+    
+    while (radio->_tx_thread_running)
+    {
+        size_t idx = 0;
+        if (radio->_tx_ready_queue->get(&idx, 1, 0) == 0)
+        {
+            if (streaming)
+            {
+                radio->_tx_underruns ++;
+                radio->_tx_underrun_flag = true;
+                streaming = false;
+            }
+            if (radio->_tx_ready_queue->get(&idx, 1, 10000) == 0)
+            {
+                continue;
+            }
+        }
+        
+        size_t len = radio->_tx_packed_lengths[idx];
+        if (len > 0)
+        {
+            int ret = cariboulite_radio_write_packed_samples((cariboulite_radio_state_st*)radio->_radio, 
+                                                             radio->_tx_packed_buffers + idx * radio->_tx_samples_per_chunk, 
+                                                             len);
+            if (ret < 0)
+            {
+                printf("writer thread failed to write SMI!\n");
+            }
+            streaming = true;
+        }
+        
+        // hand the chunk back to be refilled
+        radio->_tx_free_queue->put(idx);
+    }
+    cariboulite_restore_thread_config(&prev);
 }
 
 //==================================================================
 CaribouLiteRadio::CaribouLiteRadio(const cariboulite_radio_state_st* radio, RadioType type, const CaribouLite* parent) 
             : _radio(radio), _device(parent), _type(type), _rxCallbackType(RxCbType::None)
 {
-    _rx_thread_running = true;
-    _rx_thread = new std::thread(CaribouLiteRadio::CaribouLiteRxThread, this);
+    // the rx thread is created on demand (StartReceiving)
+    _rx_thread_running = false;
+    _rx_is_active = false;
+    _rx_thread_parked = false;
+    _rx_thread = NULL;
+    _rx_samples_per_chunk = 0;
+    _rx_pull_queue = NULL;
+    _rx_pull_overflows_reported = 0;
+    _rx_lease_drops = 0;
+    memset(&_rx_cb_hist, 0, sizeof(_rx_cb_hist));
+    _rx_next_consumer_id = 0;
+    memset(&_stream_cfg, 0, sizeof(_stream_cfg));
+    _stream_cfg_gen = 0;
     
-    _tx_thread_running = true;
-    _tx_thread = new std::thread(CaribouLiteRadio::CaribouLiteTxThread, this);
+    // the tx pipeline threads run only while transmitting
+    _tx_thread_running = false;
+    _tx_is_active = false;
+    _tx_thread = NULL;
+    _tx_writer_thread = NULL;
+    _tx_samples_per_chunk = 0;
+    _tx_queue_depth = 0;
+    _tx_packed_buffers = NULL;
+    _tx_packed_lengths = NULL;
+    _tx_free_queue = NULL;
+    _tx_ready_queue = NULL;
+    _tx_underruns = 0;
+    _tx_underrun_flag = false;
 }
 
 //==================================================================
@@ -96,13 +504,60 @@ CaribouLiteRadio::~CaribouLiteRadio()
     StopReceiving();
     StopTransmitting();
     
-    _rx_thread_running = false;
-    _rx_thread->join();
-    if (_rx_thread) delete _rx_thread;
+    StopRxThread();
+    if (_rx_pull_queue) delete _rx_pull_queue;
+    _rx_consumers.clear();
+}
+
+//==================================================================
+void CaribouLiteRadio::StopRxThread()
+{
+    if (_rx_thread == NULL) return;
     
-    _tx_thread_running = false;
-    _tx_thread->join();
-    if (_tx_thread) delete _tx_thread;
+    {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        _rx_thread_running = false;
+    }
+    _rx_cv.notify_all();
+    _rx_thread->join();
+    delete _rx_thread;
+    _rx_thread = NULL;
+}
+
+//==================================================================
+// Deactivates the rx thread and waits until it parks - from then on it doesn't
+// touch the rings, the pool or the callbacks until StartReceivingInternal.
+// Called from the rx thread itself (a callback) it can't wait - returns false.
+bool CaribouLiteRadio::ParkRxThread()
+{
+    std::unique_lock<std::mutex> lock(_rx_mutex);
+    _rx_is_active = false;
+    if (_rx_thread == NULL)
+    {
+        return true;
+    }
+    if (_rx_thread->get_id() == std::this_thread::get_id())
+    {
+        return false;
+    }
+    _rx_cv.wait(lock, [this]{return _rx_thread_parked || !_rx_thread_running;});
+    return true;
+}
+
+//==================================================================
+// The callback and the mode are replaced only while the rx thread is parked.
+// A single radio can't receive while the dual reader owns both channels.
+void CaribouLiteRadio::StopReceivingForStart()
+{
+    if (((CaribouLite*)_device)->GetIsReceivingDual())
+    {
+        throw std::runtime_error("The radios are receiving in dual mode (StopReceivingDual first)");
+    }
+    if (_rx_thread != NULL && _rx_thread->get_id() == std::this_thread::get_id())
+    {
+        throw std::runtime_error("Receiving can't be (re)started from an rx callback");
+    }
+    StopReceiving();
 }    
 
 // Gain
@@ -371,6 +826,36 @@ void CaribouLiteRadio::SetFrequency(float freq_hz)
     }   
 }
 
+//==================================================================
+void CaribouLiteRadio::SetHopTable(const std::vector<double>& freqs_hz)
+{
+    if (cariboulite_radio_prepare_hop_table((cariboulite_radio_state_st*)_radio, freqs_hz.data(), freqs_hz.size()) != 0)
+    {
+        char msg[128] = {0};
+        sprintf(msg, "Hop table preparation on %s failed", GetRadioName().c_str());
+        throw std::invalid_argument(msg);
+    }
+}
+
+//==================================================================
+void CaribouLiteRadio::Hop(size_t index, bool wait_lock)
+{
+    if (cariboulite_radio_hop((cariboulite_radio_state_st*)_radio, index, wait_lock) != 0)
+    {
+        char msg[128] = {0};
+        sprintf(msg, "Hop #%d on %s failed", (int)index, GetRadioName().c_str());
+        throw std::runtime_error(msg);
+    }
+}
+
+//==================================================================
+cariboulite_radio_tune_stats_st CaribouLiteRadio::GetTuneStats()
+{
+    cariboulite_radio_tune_stats_st stats;
+    cariboulite_radio_get_tune_stats((cariboulite_radio_state_st*)_radio, &stats);
+    return stats;
+}
+
 //==================================================================
 float CaribouLiteRadio::GetFrequency()
 {
@@ -419,65 +904,386 @@ void CaribouLiteRadio::StartReceivingInternal(size_t samples_per_chunk)
     otherRadio->StopReceiving();
     
     cariboulite_radio_activate_channel((cariboulite_radio_state_st*)_radio, cariboulite_channel_dir_rx, true);
-    _rx_is_active = true;
+    
+    // wake (or create) the rx thread
+    {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        _rx_is_active = true;
+        if (_rx_thread == NULL)
+        {
+            _rx_thread_running = true;
+            _rx_thread_parked = false;
+            _rx_thread = new std::thread(CaribouLiteRadio::CaribouLiteRxThread, this);
+        }
+    }
+    _rx_cv.notify_all();
 }
 
 //==================================================================
 void CaribouLiteRadio::StartReceiving(std::function<void(CaribouLiteRadio*, const std::complex<float>*, CaribouLiteMeta*, size_t)> on_data_ready, size_t samples_per_chunk)
 {
-    _on_data_ready_fm = on_data_ready;
-    _rxCallbackType = RxCbType::FloatSync;
+    StopReceivingForStart();
+    {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        _on_data_ready_fm = on_data_ready;
+        _rxCallbackType = RxCbType::FloatSync;
+    }
     StartReceivingInternal(samples_per_chunk);
 }
 
 //==================================================================
 void CaribouLiteRadio::StartReceiving(std::function<void(CaribouLiteRadio*, const std::complex<float>*, size_t)> on_data_ready, size_t samples_per_chunk)
 {
-    _on_data_ready_f = on_data_ready;
-    _rxCallbackType = RxCbType::Float;
+    StopReceivingForStart();
+    {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        _on_data_ready_f = on_data_ready;
+        _rxCallbackType = RxCbType::Float;
+    }
     StartReceivingInternal(samples_per_chunk);
 }
 
 //==================================================================
 void CaribouLiteRadio::StartReceiving(std::function<void(CaribouLiteRadio*, const CaribouLiteComplexInt*, CaribouLiteMeta*, size_t)> on_data_ready, size_t samples_per_chunk)
 {
-    _on_data_ready_im = on_data_ready;
-    _rxCallbackType = RxCbType::IntSync;
+    StopReceivingForStart();
+    {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        _on_data_ready_im = on_data_ready;
+        _rxCallbackType = RxCbType::IntSync;
+    }
     StartReceivingInternal(samples_per_chunk);
 }
 
 //==================================================================
 void CaribouLiteRadio::StartReceiving(std::function<void(CaribouLiteRadio*, const CaribouLiteComplexInt*, size_t)> on_data_ready, size_t samples_per_chunk)
 {
-    _on_data_ready_i = on_data_ready;
-    _rxCallbackType = RxCbType::Int;
+    StopReceivingForStart();
+    {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        _on_data_ready_i = on_data_ready;
+        _rxCallbackType = RxCbType::Int;
+    }
     StartReceivingInternal(samples_per_chunk);
 }
 
+//==================================================================
+void CaribouLiteRadio::StartReceivingPull(size_t samples_per_chunk, size_t queue_chunks)
+{
+    StopReceivingForStart();
+    
+    size_t chunk = (samples_per_chunk == 0 || samples_per_chunk > GetNativeMtuSample()) ? GetNativeMtuSample() : samples_per_chunk;
+    if (queue_chunks < 2) queue_chunks = 2;
+    
+    // the rx thread owns the producer side - the ring is replaced only while it is stopped
+    if (_rx_pull_queue == NULL || _rx_pull_queue->capacity() < chunk * queue_chunks)
+    {
+        StopRxThread();
+        if (_rx_pull_queue) delete _rx_pull_queue;
+        _rx_pull_queue = new mirrored_circular_buffer<CaribouLiteComplexInt>(chunk * queue_chunks, true);
+        if (GetStreamThreadConfig().prefault_buffers) _rx_pull_queue->prefault();
+    }
+    else
+    {
+        _rx_pull_queue->reset();
+    }
+    _rx_pull_overflows_reported = _rx_pull_queue->overflows();
+    
+    {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        _rxCallbackType = RxCbType::Pull;
+    }
+    StartReceivingInternal(chunk);
+}
+
+//==================================================================
+// A window of the pull ring - the whole request if it arrives in time,
+// otherwise whatever is there once the timeout expires
+size_t CaribouLiteRadio::PullWindow(const CaribouLiteComplexInt** samples, size_t num_samples, long timeout_us, bool* overflow)
+{
+    if (_rx_pull_queue == NULL || _rxCallbackType != RxCbType::Pull)
+    {
+        throw std::runtime_error("The radio is not receiving in pull mode (StartReceivingPull)");
+    }
+    
+    size_t len = _rx_pull_queue->peek(samples, num_samples, timeout_us);
+    if (len == 0)
+    {
+        len = _rx_pull_queue->peek(samples, num_samples, 0, 1);
+    }
+    
+    if (overflow)
+    {
+        uint64_t overflows = _rx_pull_queue->overflows();
+        *overflow = overflows != _rx_pull_overflows_reported;
+        _rx_pull_overflows_reported = overflows;
+    }
+    return len;
+}
+
+//==================================================================
+int CaribouLiteRadio::ReadSamples(CaribouLiteComplexInt* samples, size_t num_samples, long timeout_us, bool* overflow)
+{
+    const CaribouLiteComplexInt* window = NULL;
+    size_t len = PullWindow(&window, num_samples, timeout_us, overflow);
+    memcpy(samples, window, len * sizeof(CaribouLiteComplexInt));
+    _rx_pull_queue->consume(len);
+    return len;
+}
+
+//==================================================================
+int CaribouLiteRadio::ReadSamples(std::complex<float>* samples, size_t num_samples, long timeout_us, bool* overflow)
+{
+    // converted straight out of the ring
+    const CaribouLiteComplexInt* window = NULL;
+    size_t len = PullWindow(&window, num_samples, timeout_us, overflow);
+    for (size_t i = 0; i < len; i++)
+    {
+        samples[i] = std::complex<float>(window[i].i / 4096.0f, window[i].q / 4096.0f);
+    }
+    _rx_pull_queue->consume(len);
+    return len;
+}
+
+//==================================================================
+int CaribouLiteRadio::AcquireSamples(const CaribouLiteComplexInt** samples, size_t max_samples, long timeout_us, bool* overflow)
+{
+    return PullWindow(samples, max_samples, timeout_us, overflow);
+}
+
+//==================================================================
+void CaribouLiteRadio::ReleaseSamples(size_t num_samples)
+{
+    if (_rx_pull_queue) _rx_pull_queue->consume(num_samples);
+}
+
+//==================================================================
+uint64_t CaribouLiteRadio::GetRxOverflows()
+{
+    return _rx_pull_queue ? _rx_pull_queue->overflows() : 0;
+}
+
+//==================================================================
+void CaribouLiteRadio::StartReceivingLeased(std::function<void(CaribouLiteRadio*, CaribouLiteRxLease)> on_data_ready, 
+                                            bool float_samples, size_t samples_per_chunk, size_t pool_size)
+{
+    StopReceivingForStart();
+    
+    size_t chunk = (samples_per_chunk == 0 || samples_per_chunk > GetNativeMtuSample()) ? GetNativeMtuSample() : samples_per_chunk;
+    if (pool_size < 2) pool_size = 2;
+    
+    // the rx thread takes buffers from the pool - it is replaced only while the thread
+    // is stopped. Chunks still leased from a previous pool keep it alive.
+    if (!_rx_pool || !_rx_pool->Matches(pool_size, chunk, float_samples))
+    {
+        StopRxThread();
+        _rx_pool = std::make_shared<CaribouLiteRxBufferPool>(pool_size, chunk, float_samples);
+        cariboulite_thread_config_st cfg = GetStreamThreadConfig();
+        _rx_pool->Prefault(&cfg);
+    }
+    _rx_lease_drops = 0;
+    
+    {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        _on_data_ready_leased = on_data_ready;
+        _rxCallbackType = float_samples ? RxCbType::LeasedFloat : RxCbType::LeasedInt;
+    }
+    StartReceivingInternal(chunk);
+}
+
+//==================================================================
+uint64_t CaribouLiteRadio::GetRxLeaseDrops()
+{
+    return _rx_lease_drops;
+}
+
+//==================================================================
+int CaribouLiteRadio::AddConsumer(std::function<void(CaribouLiteRadio*, CaribouLiteRxLease)> on_data_ready, 
+                                  size_t queue_depth, RxConsumerPolicy policy)
+{
+    if (queue_depth < 1) queue_depth = 1;
+    
+    std::lock_guard<std::mutex> lock(_rx_consumers_mutex);
+    int id = _rx_next_consumer_id++;
+    _rx_consumers.push_back(std::make_shared<CaribouLiteRxConsumer>(this, id, on_data_ready, queue_depth, policy));
+    return id;
+}
+
+//==================================================================
+void CaribouLiteRadio::RemoveConsumer(int id)
+{
+    std::shared_ptr<CaribouLiteRxConsumer> consumer = NULL;
+    {
+        std::lock_guard<std::mutex> lock(_rx_consumers_mutex);
+        for (size_t i = 0; i < _rx_consumers.size(); i++)
+        {
+            if (_rx_consumers[i]->GetId() == id)
+            {
+                consumer = _rx_consumers[i];
+                _rx_consumers.erase(_rx_consumers.begin() + i);
+                break;
+            }
+        }
+    }
+    
+    // outside the lock - also releases the rx thread if it is blocked on this consumer
+    if (consumer) consumer->Stop();
+}
+
+//==================================================================
+CaribouLiteRadio::RxConsumerStats CaribouLiteRadio::GetConsumerStats(int id)
+{
+    std::lock_guard<std::mutex> lock(_rx_consumers_mutex);
+    for (size_t i = 0; i < _rx_consumers.size(); i++)
+    {
+        if (_rx_consumers[i]->GetId() == id) return _rx_consumers[i]->GetStats();
+    }
+    throw std::invalid_argument("No such consumer");
+}
+
+//==================================================================
+CaribouLiteRadio::StreamStats CaribouLiteRadio::GetStreamStats()
+{
+    StreamStats stats;
+    cariboulite_radio_get_stream_stats((cariboulite_radio_state_st*)_radio, &stats.smi);
+    
+    stats.queue_dropped_samples = GetRxOverflows() + GetRxLeaseDrops();
+    {
+        std::lock_guard<std::mutex> lock(_rx_consumers_mutex);
+        for (size_t i = 0; i < _rx_consumers.size(); i++)
+        {
+            stats.queue_dropped_samples += _rx_consumers[i]->GetStats().dropped_samples;
+        }
+    }
+    
+    // member by member - the rx thread may be updating it
+    const uint64_t* src = (const uint64_t*)&_rx_cb_hist;
+    uint64_t* dst = (uint64_t*)&stats.callback_duration;
+    for (size_t i = 0; i < sizeof(cariboulite_latency_hist_st) / sizeof(uint64_t); i++)
+    {
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
+    return stats;
+}
+
+//==================================================================
+void CaribouLiteRadio::DispatchToConsumers(CaribouLiteRxLease lease)
+{
+    std::vector<std::shared_ptr<CaribouLiteRxConsumer>> consumers;
+    {
+        std::lock_guard<std::mutex> lock(_rx_consumers_mutex);
+        consumers = _rx_consumers;
+    }
+    
+    // every consumer shares the same leased chunk
+    for (size_t i = 0; i < consumers.size(); i++)
+    {
+        consumers[i]->Push(lease);
+    }
+}
+
+//==================================================================
+void CaribouLiteRadio::StartReceivingConsumers(bool float_samples, size_t samples_per_chunk)
+{
+    // enough buffers for every consumer's queue plus the one it is processing,
+    // and the chunk being read
+    size_t pool_size = 2;
+    {
+        std::lock_guard<std::mutex> lock(_rx_consumers_mutex);
+        for (size_t i = 0; i < _rx_consumers.size(); i++)
+        {
+            pool_size += _rx_consumers[i]->GetQueueDepth() + 1;
+        }
+    }
+    
+    StartReceivingLeased([this](CaribouLiteRadio*, CaribouLiteRxLease lease) {
+        DispatchToConsumers(lease);
+    }, float_samples, samples_per_chunk, pool_size);
+}
+
 //==================================================================
 void CaribouLiteRadio::StopReceiving()
 {
-    _rx_is_active = false;
+    bool parked = ParkRxThread();
     cariboulite_radio_activate_channel((cariboulite_radio_state_st*)_radio, cariboulite_channel_dir_rx, false);
+    
+    // drop the callbacks (and whatever they captured) - a callback stopping its own
+    // radio is still running, its callback is released by the next start instead
+    if (parked)
+    {
+        std::lock_guard<std::mutex> lock(_rx_mutex);
+        _on_data_ready_fm = nullptr;
+        _on_data_ready_f = nullptr;
+        _on_data_ready_im = nullptr;
+        _on_data_ready_i = nullptr;
+        _on_data_ready_leased = nullptr;
+    }
 }
 
 //==================================================================
-void CaribouLiteRadio::StartTransmitting(std::function<void(CaribouLiteRadio*, std::complex<float>*, const bool*, size_t*)> on_data_request, size_t samples_per_chunk)
+void CaribouLiteRadio::StartTransmitting(std::function<void(CaribouLiteRadio*, std::complex<float>*, const bool*, size_t*)> on_data_request, size_t samples_per_chunk, size_t queue_depth)
 {
-    _rx_is_active = false;
+    StopTransmittingInternal();
+    
+    ParkRxThread();
     _on_data_request = on_data_request;
-    _tx_samples_per_chunk = samples_per_chunk;
+    _tx_samples_per_chunk = (samples_per_chunk == 0) ? GetNativeMtuSample() : samples_per_chunk;
+    _tx_queue_depth = (queue_depth < 2) ? 2 : queue_depth;
+    
+    // all the chunks start out free
+    _tx_packed_buffers = new uint32_t[_tx_samples_per_chunk * _tx_queue_depth];
+    cariboulite_thread_config_st cfg = GetStreamThreadConfig();
+    cariboulite_prefault_buffer(&cfg, _tx_packed_buffers, _tx_samples_per_chunk * _tx_queue_depth * sizeof(uint32_t));
+    _tx_packed_lengths = new size_t[_tx_queue_depth];
+    _tx_free_queue = new spsc_circular_buffer<size_t>(_tx_queue_depth, false, true);
+    _tx_ready_queue = new spsc_circular_buffer<size_t>(_tx_queue_depth, false, true);
+    for (size_t i = 0; i < _tx_queue_depth; i++) _tx_free_queue->put(i);
+    _tx_underruns = 0;
+    _tx_underrun_flag = false;
+    
     cariboulite_radio_activate_channel((cariboulite_radio_state_st*)_radio, cariboulite_channel_dir_rx, false);
     cariboulite_radio_set_cw_outputs((cariboulite_radio_state_st*)_radio, false, false);
     cariboulite_radio_activate_channel((cariboulite_radio_state_st*)_radio, cariboulite_channel_dir_tx, true);
     _tx_is_active = true;
+    
+    _tx_thread_running = true;
+    _tx_thread = new std::thread(CaribouLiteRadio::CaribouLiteTxThread, this);
+    _tx_writer_thread = new std::thread(CaribouLiteRadio::CaribouLiteTxWriterThread, this);
 }
 
 //==================================================================
-void CaribouLiteRadio::StartTransmittingLo()
+void CaribouLiteRadio::StopTransmittingInternal()
 {
-    _rx_is_active = false;
     _tx_is_active = false;
+    _tx_thread_running = false;
+    if (_tx_thread)
+    {
+        _tx_thread->join();
+        delete _tx_thread;
+        _tx_thread = NULL;
+    }
+    if (_tx_writer_thread)
+    {
+        _tx_writer_thread->join();
+        delete _tx_writer_thread;
+        _tx_writer_thread = NULL;
+    }
+    
+    if (_tx_free_queue) delete _tx_free_queue;
+    if (_tx_ready_queue) delete _tx_ready_queue;
+    if (_tx_packed_buffers) delete[] _tx_packed_buffers;
+    if (_tx_packed_lengths) delete[] _tx_packed_lengths;
+    _tx_free_queue = NULL;
+    _tx_ready_queue = NULL;
+    _tx_packed_buffers = NULL;
+    _tx_packed_lengths = NULL;
+}
+
+//==================================================================
+void CaribouLiteRadio::StartTransmittingLo()
+{
+    ParkRxThread();
+    StopTransmittingInternal();
     cariboulite_radio_activate_channel((cariboulite_radio_state_st*)_radio, cariboulite_channel_dir_tx, false);
     cariboulite_radio_set_cw_outputs((cariboulite_radio_state_st*)_radio, true, false);
     cariboulite_radio_activate_channel((cariboulite_radio_state_st*)_radio, cariboulite_channel_dir_tx, true);
@@ -486,8 +1292,8 @@ void CaribouLiteRadio::StartTransmittingLo()
 //==================================================================
 void CaribouLiteRadio::StartTransmittingCw()
 {
-    _rx_is_active = false;
-    _tx_is_active = false;
+    ParkRxThread();
+    StopTransmittingInternal();
     cariboulite_radio_activate_channel((cariboulite_radio_state_st*)_radio, cariboulite_channel_dir_tx, false);
     cariboulite_radio_set_cw_outputs((cariboulite_radio_state_st*)_radio, false, true);
     cariboulite_radio_activate_channel((cariboulite_radio_state_st*)_radio, cariboulite_channel_dir_tx, true);
@@ -496,7 +1302,7 @@ void CaribouLiteRadio::StartTransmittingCw()
 //==================================================================
 void CaribouLiteRadio::StopTransmitting()
 {
-    _tx_is_active = false;
+    StopTransmittingInternal();
     cariboulite_radio_set_cw_outputs((cariboulite_radio_state_st*)_radio, false, false);
     cariboulite_radio_activate_channel((cariboulite_radio_state_st*)_radio, cariboulite_channel_dir_tx, false);
 }
@@ -517,6 +1323,29 @@ bool CaribouLiteRadio::GetIsTransmittingCw()
     return cw_out;
 }
 
+//==================================================================
+uint64_t CaribouLiteRadio::GetTxUnderruns()
+{
+    return _tx_underruns;
+}
+
+//==================================================================
+void CaribouLiteRadio::SetStreamThreadConfig(const cariboulite_thread_config_st& cfg)
+{
+    {
+        std::lock_guard<std::mutex> lock(_stream_cfg_mutex);
+        _stream_cfg = cfg;
+    }
+    _stream_cfg_gen ++;
+}
+
+//==================================================================
+cariboulite_thread_config_st CaribouLiteRadio::GetStreamThreadConfig()
+{
+    std::lock_guard<std::mutex> lock(_stream_cfg_mutex);
+    return _stream_cfg;
+}
+
 // General
 
 //==================================================================
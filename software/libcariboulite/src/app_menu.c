@@ -454,6 +454,16 @@ static void* reader_thread_func(void* arg)
     cariboulite_sample_complex_int16* buffer = malloc(sizeof(cariboulite_sample_complex_int16)*read_len);
     cariboulite_sample_meta* metadata = malloc(sizeof(cariboulite_sample_meta)*read_len);
     
+    // real-time priority when allowed - falls back to the default scheduling otherwise
+    cariboulite_thread_config_st thread_cfg = {.sched_policy = cariboulite_sched_fifo, .sched_priority = 50, .prefault_buffers = true};
+    cariboulite_thread_state_st thread_prev;
+    if (cariboulite_apply_thread_config(&thread_cfg, &thread_prev) != 0)
+    {
+        printf("Sampling thread runs without real-time scheduling\n");
+    }
+    cariboulite_prefault_buffer(&thread_cfg, buffer, sizeof(cariboulite_sample_complex_int16)*read_len);
+    cariboulite_prefault_buffer(&thread_cfg, metadata, sizeof(cariboulite_sample_meta)*read_len);
+    
     printf("Entering sampling thread\n");
 	while (ctrl->active)
     {
@@ -485,6 +495,7 @@ static void* reader_thread_func(void* arg)
         }
     }
     printf("Leaving sampling thread\n");
+    cariboulite_restore_thread_config(&thread_prev);
     free(buffer);
     free(metadata);
     return NULL;
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <time.h>
 #include "zf_log/zf_log.h"
 #include "at86rf215.h"
 #include "io_utils/io_utils.h"
@@ -17,9 +18,265 @@
 #include "at86rf215_radio.h"
 #include "at86rf215_regs.h"
 
+//===================================================================
+// Register shadow
+// Registers holding status / measurements / self-clearing bits are volatile -
+// they are never cached. Offsets of the transceiver blocks (RF09 0x1xx, RF24 0x2xx)
+// are the same for both.
+static bool at86rf215_reg_is_volatile(uint16_t addr)
+{
+    if (addr >= AT86RF215_SHADOW_SIZE) return true;
+
+    if (addr < 0x0100)
+    {
+        switch (addr)
+        {
+            case REG_RF09_IRQS:         // irq status (clear on read) x4
+            case REG_RF09_IRQS + 1:
+            case REG_BBC0_IRQS:
+            case REG_BBC0_IRQS + 1:
+            case REG_RF_RST:            // command
+            case 0x0008:                // RF_BMDVC - battery monitor status
+            case REG_RF_IQIFC1:         // fail-safe status
+            case REG_RF_IQIFC2:         // i/q interface sync status
+                return true;
+            default: return false;
+        }
+    }
+
+    switch (addr & 0xFF)
+    {
+        case (REG_RF09_AUXS & 0xFF):    // analog voltage status
+        case (REG_RF09_STATE & 0xFF):
+        case (REG_RF09_CMD & 0xFF):
+        case (REG_RF09_AGCC & 0xFF):    // agc freeze status
+        case (REG_RF09_AGCS & 0xFF):    // gain control word (agc)
+        case 0x0D:                      // RSSI
+        case 0x10:                      // EDV - energy detection value
+        case 0x11:                      // RNDV - random value
+        case 0x21:                      // PLL - lock status
+        case (REG_RF09_TXCI & 0xFF):    // tx lo leakage calibration results
+        case (REG_RF09_TXCQ & 0xFF):
+            return true;
+        default: return false;
+    }
+}
+
+static inline bool at86rf215_shadow_valid(at86rf215_st* dev, uint16_t addr)
+{
+    return (dev->shadow.valid[addr >> 3] >> (addr & 0x7)) & 0x1;
+}
+
+static inline void at86rf215_shadow_store(at86rf215_st* dev, uint16_t addr, uint8_t val)
+{
+    dev->shadow.regs[addr] = val;
+    dev->shadow.valid[addr >> 3] |= 1 << (addr & 0x7);
+}
+
+// the range holds at least one register worth caching
+static bool at86rf215_shadow_covers(at86rf215_st* dev, uint16_t addr, uint8_t size)
+{
+    if (!dev->shadow.enabled) return false;
+    for (int i = 0; i < size; i++)
+    {
+        if (!at86rf215_reg_is_volatile(addr + i)) return true;
+    }
+    return false;
+}
+
+// the range holds a register whose write may reset the register file. These are
+// volatile, so such writes must be checked whether or not the range is cached
+static inline bool at86rf215_shadow_invalidates(uint16_t addr, uint16_t size)
+{
+    uint16_t end = addr + size;
+    return (REG_RF_RST >= addr && REG_RF_RST < end) ||
+           (REG_RF09_CMD >= addr && REG_RF09_CMD < end) ||
+           (REG_RF24_CMD >= addr && REG_RF24_CMD < end);
+}
+
+// after writing registers with side effects on the register file
+static void at86rf215_shadow_written(at86rf215_st* dev, uint16_t addr, const uint8_t* buffer, uint16_t size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        uint16_t a = addr + i;
+        if (!at86rf215_reg_is_volatile(a)) at86rf215_shadow_store(dev, a, buffer[i]);
+        else if (a == REG_RF_RST) memset(dev->shadow.valid, 0, sizeof(dev->shadow.valid));
+        else if (a == REG_RF09_CMD || a == REG_RF24_CMD)
+        {
+            // reset and sleep (deep sleep when both are asleep) lose the register contents
+            uint8_t cmd = buffer[i] & 0x7;
+            if (cmd == at86rf215_radio_state_cmd_reset || cmd == at86rf215_radio_cmd_sleep)
+            {
+                memset(dev->shadow.valid, 0, sizeof(dev->shadow.valid));
+            }
+        }
+    }
+}
+
+static inline int at86rf215_spi_transmit(at86rf215_st* dev, uint8_t* tx, uint8_t* rx, int len)
+{
+    __atomic_add_fetch(&dev->shadow.spi_transactions, 1, __ATOMIC_RELAXED);
+    return io_utils_spi_transmit(dev->io_spi, dev->io_spi_handle, tx, rx, len, io_utils_spi_read_write);
+}
+
+//===================================================================
+void at86rf215_shadow_enable(at86rf215_st* dev, bool enable)
+{
+    pthread_mutex_lock(&dev->shadow.lock);
+    dev->shadow.enabled = enable;
+    memset(dev->shadow.valid, 0, sizeof(dev->shadow.valid));
+    pthread_mutex_unlock(&dev->shadow.lock);
+}
+
+//===================================================================
+void at86rf215_shadow_invalidate(at86rf215_st* dev)
+{
+    pthread_mutex_lock(&dev->shadow.lock);
+    memset(dev->shadow.valid, 0, sizeof(dev->shadow.valid));
+    pthread_mutex_unlock(&dev->shadow.lock);
+}
+
+//===================================================================
+void at86rf215_get_spi_stats(at86rf215_st* dev, uint64_t* spi_transactions, uint64_t* cached_reads)
+{
+    if (spi_transactions) *spi_transactions = __atomic_load_n(&dev->shadow.spi_transactions, __ATOMIC_RELAXED);
+    if (cached_reads) *cached_reads = __atomic_load_n(&dev->shadow.cached_reads, __ATOMIC_RELAXED);
+}
+
+//===================================================================
+// Write batching - 'active' and 'owner' are checked by every thread accessing the
+// device, so they are kept under the shadow lock. The rest of the batch is only
+// touched by its owner.
+static bool at86rf215_batch_owned(at86rf215_st* dev)
+{
+    pthread_mutex_lock(&dev->shadow.lock);
+    bool owned = dev->batch.active && pthread_equal(dev->batch.owner, pthread_self());
+    pthread_mutex_unlock(&dev->shadow.lock);
+    return owned;
+}
+
+static int at86rf215_batch_send(at86rf215_st* dev)
+{
+    at86rf215_batch_st* b = &dev->batch;
+    if (b->num_bursts == 0) return 0;
+
+    io_utils_spi_segment_st segments[AT86RF215_BATCH_MAX_BURSTS];
+    for (int i = 0; i < b->num_bursts; i++)
+    {
+        segments[i].tx_buf = b->tx + b->burst_offset[i];
+        segments[i].rx_buf = NULL;
+        segments[i].length = b->burst_len[i] + 2;
+    }
+
+    pthread_mutex_lock(&dev->shadow.lock);
+    __atomic_add_fetch(&dev->shadow.spi_transactions, 1, __ATOMIC_RELAXED);
+    int ret = io_utils_spi_transmit_multi(dev->io_spi, dev->io_spi_handle, segments, b->num_bursts);
+    if (ret == 0 && dev->shadow.enabled)
+    {
+        for (int i = 0; i < b->num_bursts; i++)
+        {
+            at86rf215_shadow_written(dev, b->burst_addr[i], b->tx + b->burst_offset[i] + 2, b->burst_len[i]);
+        }
+    }
+    else if (ret != 0)
+    {
+        // unknown how far the transfer got
+        memset(dev->shadow.valid, 0, sizeof(dev->shadow.valid));
+        ZF_LOGE("batched write of %d bursts failed", b->num_bursts);
+    }
+    pthread_mutex_unlock(&dev->shadow.lock);
+
+    b->num_bursts = 0;
+    b->tx_len = 0;
+    return ret;
+}
+
+static int at86rf215_batch_append(at86rf215_st* dev, uint16_t addr, uint8_t *buffer, uint8_t size)
+{
+    at86rf215_batch_st* b = &dev->batch;
+    int last = b->num_bursts - 1;
+
+    // continues the previous burst - auto increment covers it
+    if (last >= 0 && addr == b->burst_addr[last] + b->burst_len[last] &&
+        b->burst_len[last] + size <= 256 &&
+        b->tx_len + size <= AT86RF215_BATCH_MAX_BYTES)
+    {
+        memcpy(b->tx + b->tx_len, buffer, size);
+        b->tx_len += size;
+        b->burst_len[last] += size;
+        return 0;
+    }
+
+    int ret = 0;
+    if (b->num_bursts == AT86RF215_BATCH_MAX_BURSTS || b->tx_len + size + 2 > AT86RF215_BATCH_MAX_BYTES)
+    {
+        ret = at86rf215_batch_send(dev);
+    }
+
+    int i = b->num_bursts++;
+    b->burst_addr[i] = addr;
+    b->burst_offset[i] = b->tx_len;
+    b->burst_len[i] = size;
+    b->tx[b->tx_len++] = ((addr >> 8) & 0x3F) | 0x80;
+    b->tx[b->tx_len++] = addr & 0xFF;
+    memcpy(b->tx + b->tx_len, buffer, size);
+    b->tx_len += size;
+    return ret;
+}
+
+//===================================================================
+void at86rf215_batch_begin(at86rf215_st* dev)
+{
+    pthread_mutex_lock(&dev->shadow.lock);
+    if (dev->batch.active && pthread_equal(dev->batch.owner, pthread_self()))
+    {
+        // already collecting
+        dev->batch.depth ++;
+    }
+    else if (dev->batch.active)
+    {
+        ZF_LOGW("a write batch is already open by another thread - writing directly");
+    }
+    else
+    {
+        dev->batch.num_bursts = 0;
+        dev->batch.tx_len = 0;
+        dev->batch.depth = 1;
+        dev->batch.owner = pthread_self();
+        dev->batch.active = true;
+    }
+    pthread_mutex_unlock(&dev->shadow.lock);
+}
+
+//===================================================================
+int at86rf215_batch_flush(at86rf215_st* dev)
+{
+    if (!at86rf215_batch_owned(dev)) return 0;
+    return at86rf215_batch_send(dev);
+}
+
+//===================================================================
+int at86rf215_batch_commit(at86rf215_st* dev)
+{
+    if (!at86rf215_batch_owned(dev)) return 0;
+    if (-- dev->batch.depth > 0) return 0;
+    int ret = at86rf215_batch_send(dev);
+
+    pthread_mutex_lock(&dev->shadow.lock);
+    dev->batch.active = false;
+    pthread_mutex_unlock(&dev->shadow.lock);
+    return ret;
+}
+
 //===================================================================
 int at86rf215_write_buffer(at86rf215_st* dev, uint16_t addr, uint8_t *buffer, uint8_t size )
 {
+    if (at86rf215_batch_owned(dev))
+    {
+        return at86rf215_batch_append(dev, addr, buffer, size);
+    }
+
     // a maximal possible chunk size - 256 + 2(addr)
     uint8_t chunk_tx[258] = {0};
     uint8_t chunk_rx[258] = {0};
@@ -27,66 +284,87 @@ int at86rf215_write_buffer(at86rf215_st* dev, uint16_t addr, uint8_t *buffer, ui
     chunk_tx[1] = addr & 0xFF;
     memcpy(chunk_tx + 2, buffer, size);
 
-    return io_utils_spi_transmit(dev->io_spi, dev->io_spi_handle, chunk_tx, chunk_rx, size + 2, io_utils_spi_read_write);
+    if (!at86rf215_shadow_covers(dev, addr, size) && !at86rf215_shadow_invalidates(addr, size))
+    {
+        return at86rf215_spi_transmit(dev, chunk_tx, chunk_rx, size + 2);
+    }
+
+    pthread_mutex_lock(&dev->shadow.lock);
+    int ret = at86rf215_spi_transmit(dev, chunk_tx, chunk_rx, size + 2);
+    if (ret == 0) at86rf215_shadow_written(dev, addr, buffer, size);
+    pthread_mutex_unlock(&dev->shadow.lock);
+    return ret;
 }
 
 //===================================================================
 int at86rf215_read_buffer(at86rf215_st* dev, uint16_t addr, uint8_t *buffer, uint8_t size)
 {
+    if (at86rf215_batch_owned(dev))
+    {
+        at86rf215_batch_send(dev);
+    }
+
     // a maximal possible chunk size - 256 + 2(addr)
     uint8_t chunk_tx[258] = {0};
     uint8_t chunk_rx[258] = {0};
     chunk_tx[0] = (addr >> 8) & 0x3F;
     chunk_tx[1] = addr & 0xFF;
 
-    int ret = io_utils_spi_transmit(dev->io_spi, dev->io_spi_handle, chunk_tx, chunk_rx, size + 2, io_utils_spi_read_write);
+    if (!at86rf215_shadow_covers(dev, addr, size))
+    {
+        int ret = at86rf215_spi_transmit(dev, chunk_tx, chunk_rx, size + 2);
+        if (ret == 0)
+        {
+            memcpy(buffer, chunk_rx + 2, size);
+        }
+        return ret;
+    }
 
-    if (ret == 0)
+    pthread_mutex_lock(&dev->shadow.lock);
+    bool hit = true;
+    for (int i = 0; i < size && hit; i++)
+    {
+        hit = !at86rf215_reg_is_volatile(addr + i) && at86rf215_shadow_valid(dev, addr + i);
+    }
+
+    int ret = 0;
+    if (hit)
+    {
+        memcpy(buffer, dev->shadow.regs + addr, size);
+        __atomic_add_fetch(&dev->shadow.cached_reads, 1, __ATOMIC_RELAXED);
+    }
+    else
     {
-        memcpy(buffer, chunk_rx + 2, size);
+        ret = at86rf215_spi_transmit(dev, chunk_tx, chunk_rx, size + 2);
+        if (ret == 0)
+        {
+            memcpy(buffer, chunk_rx + 2, size);
+            for (int i = 0; i < size; i++)
+            {
+                if (!at86rf215_reg_is_volatile(addr + i)) at86rf215_shadow_store(dev, addr + i, buffer[i]);
+            }
+        }
     }
+    pthread_mutex_unlock(&dev->shadow.lock);
     return ret;
 }
 
 //===================================================================
 int at86rf215_write_byte(at86rf215_st* dev, uint16_t addr, uint8_t val )
 {
-    uint8_t chunk_tx[3] = {0};
-    uint8_t chunk_rx[3] = {0};
-    chunk_tx[0] = ((addr >> 8) & 0x3F) | 0x80;
-    chunk_tx[1] = addr & 0xFF;
-    chunk_tx[2] = val;
-    return io_utils_spi_transmit(dev->io_spi, dev->io_spi_handle,
-            chunk_tx, chunk_rx, 3, io_utils_spi_read_write);
+    return at86rf215_write_buffer(dev, addr, &val, 1);
 }
 
 //===================================================================
 int at86rf215_read_byte(at86rf215_st* dev, uint16_t addr)
 {
-    uint8_t chunk_tx[3] = {0};
-    uint8_t chunk_rx[3] = {0};
-    
-    chunk_tx[0] = (addr >> 8) & 0x3F;
-    chunk_tx[1] = addr & 0xFF;
-    
-    /*printf("TX: ");
-    for (int i = 0; i < 3; i ++)
-        printf(" 0x%02X ", chunk_tx[i]);
-    printf("\n");*/
-    
-    int ret = io_utils_spi_transmit(dev->io_spi, dev->io_spi_handle, 
-            chunk_tx, chunk_rx, 3, io_utils_spi_read_write);
+    uint8_t val = 0;
+    int ret = at86rf215_read_buffer(dev, addr, &val, 1);
     if (ret < 0)
     {
         return ret;
     }
-    
-    /*printf("RX: ");
-    for (int i = 0; i < 3; i ++)
-        printf(" 0x%02X ", chunk_rx[i]);
-    printf("\n");*/
-    
-    return chunk_rx[2];
+    return val;
 }
 
 //===================================================================
@@ -171,6 +449,12 @@ int at86rf215_init(at86rf215_st* dev,
 
 	dev->io_spi = io_spi;
 
+    // the register shadow starts empty - filled by the first accesses
+    memset(&dev->shadow, 0, sizeof(at86rf215_shadow_st));
+    pthread_mutex_init(&dev->shadow.lock, NULL);
+    dev->shadow.enabled = true;
+    memset(&dev->batch, 0, sizeof(at86rf215_batch_st));
+
     ZF_LOGD("configuring reset and irq pins");
 	// Configure GPIO pins
 	io_utils_setup_gpio(dev->reset_pin, io_utils_dir_output, io_utils_pull_off);
@@ -247,6 +531,7 @@ int at86rf215_close(at86rf215_st* dev)
 
 	// Release the SPI device
     io_utils_spi_remove_chip(dev->io_spi, dev->io_spi_handle);
+    pthread_mutex_destroy(&dev->shadow.lock);
 
 	ZF_LOGD("device release completed");
     return 0;
@@ -258,6 +543,7 @@ void at86rf215_reset(at86rf215_st* dev)
 	io_utils_write_gpio(dev->reset_pin, 0);
     io_utils_usleep(300);
 	io_utils_write_gpio(dev->reset_pin, 1);
+    memset(dev->shadow.valid, 0, sizeof(dev->shadow.valid));
 }
 
 //===================================================================
@@ -504,19 +790,40 @@ int64_t at86rf215_setup_channel ( at86rf215_st* dev, at86rf215_rf_channel_en ch,
         return -1;
     }
 
-    at86rf215_radio_channel_mode_en mode = 0;
-    at86rf215_rf_channel_en req_ch = 0;
-
-    if (at86rf215_radio_get_good_channel(freq_hz, &mode, &req_ch) < 0 || req_ch != ch)
+    at86rf215_radio_channel_plan_st plan;
+    if (at86rf215_radio_plan_channel(ch, freq_hz, &plan) != 0)
     {
-        ZF_LOGE("the requested channel or frequency not supported");
         return -1;
     }
-    int center_freq_25khz_res = 0;
-    int channel_number = 0;
-    double actual_freq = at86rf215_radio_get_frequency(mode, 1, freq_hz, &center_freq_25khz_res, &channel_number);
-    at86rf215_radio_setup_channel(dev, ch, 1, center_freq_25khz_res, channel_number, mode);
-    return (int64_t)actual_freq;
+    at86rf215_radio_apply_channel_plan(dev, &plan);
+    return (int64_t)plan.actual_freq_hz;
+}
+
+//===================================================================
+// Waits for the channel's PLL to lock. The trx_ready interrupt wakes the wait up as
+// soon as the PLL settles; the time slices (growing 20usec => 1msec) keep it polling
+// when the interrupt isn't issued (e.g. a channel change while already in TXPREP).
+// Returns 0 when locked, -1 on timeout
+int at86rf215_wait_pll_lock(at86rf215_st* dev, at86rf215_rf_channel_en ch, int timeout_us)
+{
+    event_st* ev = (ch == at86rf215_rf_channel_900mhz) ? &dev->events.lo_trx_ready_event : &dev->events.hi_trx_ready_event;
+    at86rf215_radio_pll_ctrl_st cfg = {0};
+    struct timespec t0, t1;
+    int slice_us = 20;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while (1)
+    {
+        at86rf215_radio_get_pll_ctrl(dev, ch, &cfg);
+        if (cfg.pll_locked) return 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        int64_t elapsed_us = (t1.tv_sec - t0.tv_sec) * 1000000LL + (t1.tv_nsec - t0.tv_nsec) / 1000;
+        if (elapsed_us >= timeout_us) return -1;
+
+        event_node_wait_ready_timeout(ev, slice_us);
+        if (slice_us < 1000) slice_us *= 2;
+    }
 }
 
 //===================================================================
@@ -562,6 +869,8 @@ void at86rf215_setup_iq_radio_receive (at86rf215_st* dev, at86rf215_rf_channel_e
     // 1. Set TRXOFF mode
     at86rf215_radio_set_state(dev, radio, at86rf215_radio_state_cmd_trx_off);
 
+    // steps 2-8 are register writes - sent as one batched transfer
+    at86rf215_batch_begin(dev);
 
     // 2. Enable all radio interrupts in 09,_24_IRQS
     at86rf215_radio_irq_st int_mask = {
@@ -636,6 +945,7 @@ void at86rf215_setup_iq_radio_receive (at86rf215_st* dev, at86rf215_rf_channel_e
 
     // 8. Enable the radio receiver by writing command RX to the register RFn_CMD.
     at86rf215_radio_set_state(dev, radio, at86rf215_radio_state_cmd_rx);
+    at86rf215_batch_commit(dev);
 
     // 9. To prevent the AGC from switching its gain during reception, it is recommended to set AGCC.FRZC=1
     //    after reception of the preamble, the AGC has to be released after finishing reception by setting AGCC.FRZC=0.
@@ -686,6 +996,7 @@ void at86rf215_setup_iq_radio_dac_value_override_no_freq (at86rf215_st* dev,
     }
     at86rf215_radio_set_state(dev, ch, at86rf215_radio_state_cmd_tx_prep);
 
+    at86rf215_batch_begin(dev);
     at86rf215_radio_tx_ctrl_st tx_config =
     {
         .pa_ramping_time = at86rf215_radio_tx_pa_ramp_32usec,
@@ -700,6 +1011,7 @@ void at86rf215_setup_iq_radio_dac_value_override_no_freq (at86rf215_st* dev,
 
     at86rf215_radio_set_tx_dac_input_iq(dev, ch, 1, 0x7E, 1, 0x3F);
     at86rf215_radio_set_state(dev, ch, at86rf215_radio_state_cmd_tx);
+    at86rf215_batch_commit(dev);
 }
 
 
@@ -730,6 +1042,7 @@ void at86rf215_setup_iq_radio_dac_value_override (at86rf215_st* dev,
     }
     at86rf215_radio_set_state(dev, ch, at86rf215_radio_state_cmd_tx_prep);
 
+    at86rf215_batch_begin(dev);
     at86rf215_radio_tx_ctrl_st tx_config =
     {
         .pa_ramping_time = at86rf215_radio_tx_pa_ramp_32usec,
@@ -768,4 +1081,5 @@ void at86rf215_setup_iq_radio_dac_value_override (at86rf215_st* dev,
     at86rf215_radio_set_tx_dac_input_iq(dev, ch, 1, 0x7E, 1, 0x3F);
     at86rf215_setup_channel (dev, ch, freq_hz);
     at86rf215_radio_set_state(dev, ch, at86rf215_radio_state_cmd_tx);
+    at86rf215_batch_commit(dev);
 }
\ No newline at end of file
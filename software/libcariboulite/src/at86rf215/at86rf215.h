@@ -11,6 +11,7 @@ extern "C" {
 
 int at86rf215_init(at86rf215_st* dev,
 					io_utils_spi_st* io_spi);
+void at86rf215_chip_reset_with_spi(at86rf215_st* dev);
 int at86rf215_close(at86rf215_st* dev);
 void at86rf215_reset(at86rf215_st* dev);
 
@@ -38,12 +39,14 @@ void at86rf215_setup_iq_radio_dac_value_override_no_freq (at86rf215_st* dev,
                                                           uint8_t tx_power);
 int64_t at86rf215_setup_channel ( at86rf215_st* dev, at86rf215_rf_channel_en ch, uint64_t freq_hz );
 double at86rf215_check_freq (at86rf215_st* dev, at86rf215_rf_channel_en ch, uint64_t freq_hz );
+int at86rf215_wait_pll_lock(at86rf215_st* dev, at86rf215_rf_channel_en ch, int timeout_us);
 
 // EVENTS
 
 void event_node_init(event_st* ev);
 void event_node_close(event_st* ev);
 void event_node_wait_ready(event_st* ev);
+int event_node_wait_ready_timeout(event_st* ev, int timeout_us);
 void event_node_signal_ready(event_st* ev, int ready);
 
 #ifdef __cplusplus
@@ -10,6 +10,7 @@ extern "C" {
 #include <math.h>
 #include <string.h>
 #include <stdbool.h>
+#include <pthread.h>
 #include <stdio.h>
 #include "io_utils/io_utils.h"
 #include "io_utils/io_utils_spi.h"
@@ -127,6 +128,39 @@ typedef struct
     event_st hi_energy_measure_event;
 } at86rf215_events_st;
 
+// Write-through shadow of the register file - the common and transceiver blocks
+// (the baseband cores and the frame buffers are always accessed live)
+#define AT86RF215_SHADOW_SIZE           (0x300)
+
+typedef struct
+{
+    bool enabled;
+    uint8_t regs[AT86RF215_SHADOW_SIZE];
+    uint8_t valid[AT86RF215_SHADOW_SIZE / 8];   // bitmap - the register holds the device value
+    pthread_mutex_t lock;                       // keeps the spi access and the shadow update together
+    uint64_t spi_transactions;
+    uint64_t cached_reads;                      // register reads served from the shadow
+} at86rf215_shadow_st;
+
+// Write batching - register writes issued between at86rf215_batch_begin and
+// at86rf215_batch_commit are collected, adjacent addresses merged into bursts,
+// and the bursts sent in a single multi-message spi transfer
+#define AT86RF215_BATCH_MAX_BURSTS      (32)
+#define AT86RF215_BATCH_MAX_BYTES       (512)
+
+typedef struct
+{
+    bool active;
+    pthread_t owner;                    // writes from other threads are not batched
+    int depth;                          // nested begin calls - the outermost commit sends
+    int num_bursts;
+    uint16_t burst_addr[AT86RF215_BATCH_MAX_BURSTS];
+    uint16_t burst_offset[AT86RF215_BATCH_MAX_BURSTS];  // into 'tx' - 2 address bytes + data
+    uint16_t burst_len[AT86RF215_BATCH_MAX_BURSTS];     // data bytes
+    uint8_t tx[AT86RF215_BATCH_MAX_BYTES];
+    int tx_len;
+} at86rf215_batch_st;
+
 typedef struct
 {
     // pinout
@@ -146,6 +180,8 @@ typedef struct
     bool override_cal;
     at86rf215_events_st events;
 	int num_interrupts;
+    at86rf215_shadow_st shadow;
+    at86rf215_batch_st batch;
 } at86rf215_st;
 
 
@@ -158,6 +194,21 @@ int at86rf215_write_fifo(at86rf215_st* dev, uint8_t *buffer, uint8_t size );
 int at86rf215_read_fifo(at86rf215_st* dev, uint8_t *buffer, uint8_t size );
 void at86rf215_get_irqs(at86rf215_st* dev, at86rf215_irq_st* irq, int verbose);
 
+// Register shadowing - on by default. Status registers (state, irqs, rssi, pll lock,
+// ...) are always read from the device, the other reads are served from the shadow
+// once the register was written or read. Disabling also drops the shadow.
+void at86rf215_shadow_enable(at86rf215_st* dev, bool enable);
+void at86rf215_shadow_invalidate(at86rf215_st* dev);
+void at86rf215_get_spi_stats(at86rf215_st* dev, uint64_t* spi_transactions, uint64_t* cached_reads);
+
+// Register write batching (per calling thread). Any register read in between
+// flushes the pending writes first, so read-after-write stays coherent.
+// at86rf215_batch_flush sends the pending writes and keeps the batch open.
+// Batches nest - only the outermost commit sends and closes the batch.
+void at86rf215_batch_begin(at86rf215_st* dev);
+int at86rf215_batch_flush(at86rf215_st* dev);
+int at86rf215_batch_commit(at86rf215_st* dev);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,11 +9,18 @@
 #include "zf_log/zf_log.h"
 #include "at86rf215_common.h"
 #include <pthread.h>
+#include <time.h>
+#include <errno.h>
 
 
 void event_node_init(event_st* ev)
 {
-    pthread_cond_init(&ev->ready_cond, NULL);
+    // timed waits are measured on the monotonic clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ev->ready_cond, &attr);
+    pthread_condattr_destroy(&attr);
     pthread_mutex_init(&ev->ready_mutex, NULL);
 }
 
@@ -34,6 +41,30 @@ void event_node_wait_ready(event_st* ev)
     pthread_mutex_unlock(&ev->ready_mutex);
 }
 
+// returns 0 when the event was signaled, 1 on timeout
+int event_node_wait_ready_timeout(event_st* ev, int timeout_us)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_us / 1000000;
+    deadline.tv_nsec += (long)(timeout_us % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec ++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&ev->ready_mutex);
+    while (!ev->ready)
+    {
+        if (pthread_cond_timedwait(&ev->ready_cond, &ev->ready_mutex, &deadline) == ETIMEDOUT) break;
+    }
+    int ret = ev->ready ? 0 : 1;
+    ev->ready = 0;
+    pthread_mutex_unlock(&ev->ready_mutex);
+    return ret;
+}
+
 void event_node_signal_ready(event_st* ev, int ready)
 {
     pthread_mutex_lock(&ev->ready_mutex);
@@ -149,6 +149,9 @@ void at86rf215_radio_set_state(at86rf215_st* dev, at86rf215_rf_channel_en ch, at
     uint16_t reg_address = AT86RF215_REG_ADDR(ch, CMD);
     at86rf215_write_byte(dev, reg_address, cmd & 0x7);
 
+    // state transitions are timed from here - don't leave the command in an open batch
+    at86rf215_batch_flush(dev);
+
     /*Errata #6:    State Machine Command RFn_CMD=TRXOFF may not be succeeded
                     Description: If the current state is different from SLEEP, the execution of the command TRXOFF may fail.
                     Software workaround: Check state by reading register RFn_STATE Repeat the command RFn_CMD=TRXOFF
@@ -291,6 +294,38 @@ void at86rf215_radio_setup_channel(at86rf215_st* dev, at86rf215_rf_channel_en ch
     at86rf215_write_buffer(dev, reg_address_spacing, buf, 5);
 }
 
+//==================================================================================
+int at86rf215_radio_plan_channel(at86rf215_rf_channel_en ch, uint64_t freq_hz,
+                                        at86rf215_radio_channel_plan_st* plan)
+{
+    at86rf215_radio_channel_mode_en mode = 0;
+    at86rf215_rf_channel_en req_ch = 0;
+
+    if (at86rf215_radio_get_good_channel(freq_hz, &mode, &req_ch) < 0 || req_ch != ch)
+    {
+        ZF_LOGE("the requested channel or frequency not supported");
+        return -1;
+    }
+
+    int center_freq_25khz_res = 0;
+    int channel_number = 0;
+    plan->ch = ch;
+    plan->actual_freq_hz = at86rf215_radio_get_frequency(mode, 1, freq_hz, &center_freq_25khz_res, &channel_number);
+    plan->regs[0] = 1;
+    plan->regs[1] = /*LOW*/ center_freq_25khz_res & 0xFF;
+    plan->regs[2] = /*HIGH*/ (center_freq_25khz_res >> 8) & 0xFF;
+    plan->regs[3] = /*LOW*/ channel_number & 0xFF;
+    plan->regs[4] = /*HIGH + MODE*/ ((channel_number>>8)&0x01) | ((mode & 0x3)<<6);
+    return 0;
+}
+
+//==================================================================================
+void at86rf215_radio_apply_channel_plan(at86rf215_st* dev, const at86rf215_radio_channel_plan_st* plan)
+{
+    // CNM goes last (it latches the others) - guaranteed by the burst order
+    at86rf215_write_buffer(dev, AT86RF215_REG_ADDR(plan->ch, CS), (uint8_t*)plan->regs, 5);
+}
+
 //==================================================================================
 void at86rf215_radio_set_rx_bandwidth_sampling(at86rf215_st* dev, at86rf215_rf_channel_en ch,
                                                 at86rf215_radio_set_rx_bw_samp_st* cfg)
@@ -367,6 +367,19 @@ void at86rf215_radio_get_tx_dac_input_iq(at86rf215_st* dev, at86rf215_rf_channel
 int at86rf215_radio_get_good_channel(double wanted_frequency_hz, at86rf215_radio_channel_mode_en *mode,
                                                                 at86rf215_rf_channel_en *ch);
 
+// Channel registers of a frequency, worked out ahead of time - applied by a single
+// burst write (at86rf215_radio_apply_channel_plan)
+typedef struct
+{
+    at86rf215_rf_channel_en ch;
+    uint8_t regs[5];                    // CS, CCF0L, CCF0H, CNL, CNM
+    double actual_freq_hz;
+} at86rf215_radio_channel_plan_st;
+
+int at86rf215_radio_plan_channel(at86rf215_rf_channel_en ch, uint64_t freq_hz,
+                                        at86rf215_radio_channel_plan_st* plan);
+void at86rf215_radio_apply_channel_plan(at86rf215_st* dev, const at86rf215_radio_channel_plan_st* plan);
+
 #ifdef __cplusplus
 }
 #endif
@@ -202,6 +202,43 @@ int test_at86rf215_continues_iq_loopback (at86rf215_st* dev, at86rf215_rf_channe
     return 1;
 }
 
+// -----------------------------------------------------------------------------------------
+// This test checks that a reset through SPI (chip or radio) drops the register shadow, so
+// that the next read returns the device's value and not the value written before the reset
+static int test_at86rf215_shadow_reset_read_one(at86rf215_st* dev, bool chip_reset)
+{
+    uint64_t cached_before = 0, cached_after = 0;
+
+    uint8_t written = at86rf215_read_byte(dev, REG_RF09_IRQM) ^ 0x3F;
+    at86rf215_write_byte(dev, REG_RF09_IRQM, written);
+    at86rf215_read_byte(dev, REG_RF09_IRQM);                // served from the shadow
+
+    if (chip_reset) at86rf215_chip_reset_with_spi(dev);
+    else at86rf215_radio_set_state(dev, at86rf215_rf_channel_900mhz, at86rf215_radio_state_cmd_reset);
+    io_utils_usleep(1000);
+
+    at86rf215_get_spi_stats(dev, NULL, &cached_before);
+    uint8_t val = at86rf215_read_byte(dev, REG_RF09_IRQM);
+    at86rf215_get_spi_stats(dev, NULL, &cached_after);
+
+    // the device's own value, bypassing the shadow
+    at86rf215_shadow_enable(dev, false);
+    uint8_t actual = at86rf215_read_byte(dev, REG_RF09_IRQM);
+    at86rf215_shadow_enable(dev, true);
+
+    int pass = (cached_after == cached_before) && (val == actual);
+    printf("TEST:AT86RF215:SHADOW:%s RESET->READ 0x%02X (device 0x%02X, written 0x%02X) => %s\n",
+            chip_reset ? "CHIP" : "RADIO", val, actual, written, pass ? "PASS" : "FAIL");
+    return pass;
+}
+
+int test_at86rf215_shadow_reset_read(at86rf215_st* dev)
+{
+    int pass = test_at86rf215_shadow_reset_read_one(dev, false);
+    pass &= test_at86rf215_shadow_reset_read_one(dev, true);
+    return pass;
+}
+
 // -----------------------------------------------------------------------------------------
 // TEST SELECTION
 // -----------------------------------------------------------------------------------------
@@ -212,6 +249,7 @@ int test_at86rf215_continues_iq_loopback (at86rf215_st* dev, at86rf215_rf_channe
 #define TEST_IQ_RX_WIND_RAD 0 
 #define TEST_IQ_LB_WIND     0
 #define TEST_READ_ALL_REGS  0
+#define TEST_SHADOW_RESET   1
 
 // -----------------------------------------------------------------------------------------
 // MAIN
@@ -276,6 +314,11 @@ int main ()
         test_at86rf215_read_all_regs_check(&dev);
     #endif
 
+    // resets the chip - keep last
+    #if TEST_SHADOW_RESET
+        test_at86rf215_shadow_reset_read(&dev);
+    #endif
+
 	at86rf215_close(&dev);
 	io_utils_spi_close(&io_spi_dev);
     io_utils_cleanup();
@@ -32,6 +32,7 @@
 #define IOC_SMI_CTRL_FIFO_STATUS    1
 #define IOC_SMI_CHANNEL_SELECT      2
 #define IOC_SMI_CTRL_DIR_SELECT         3
+#define IOC_SMI_CTRL_RX_DUAL            4
 
 //--------------------------------------------------------------
 // Internal Data-Types
@@ -616,3 +617,17 @@ int caribou_fpga_set_smi_ctrl_data_direction (caribou_fpga_st* dev, uint8_t dir)
     };
     return caribou_fpga_spi_transfer (dev, (uint8_t*)(&oc), (uint8_t*)&dir);
 }
+
+//--------------------------------------------------------------
+int caribou_fpga_set_smi_rx_dual (caribou_fpga_st* dev, bool dual)
+{
+    uint8_t val = dual ? 0x1 : 0x0;
+    CARIBOU_FPGA_CHECK_DEV(dev,"caribou_fpga_set_smi_rx_dual");
+    caribou_fpga_opcode_st oc =
+    {
+        .rw  = caribou_fpga_rw_write,
+        .mid = caribou_fpga_mid_smi_ctrl,
+        .ioc = IOC_SMI_CTRL_RX_DUAL
+    };
+    return caribou_fpga_spi_transfer (dev, (uint8_t*)(&oc), &val);
+}
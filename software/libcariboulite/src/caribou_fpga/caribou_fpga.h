@@ -86,7 +86,9 @@ typedef struct
     uint8_t tx_fifo_full : 1;
     uint8_t smi_channel: 1;
     uint8_t i_smi_test : 1;
-    uint8_t reserved : 4;            // MSB
+    uint8_t smi_dir : 1;
+    uint8_t rx_dual : 1;             // both rx channels interleaved (always '0' on older firmware)
+    uint8_t reserved : 2;            // MSB
 } caribou_fpga_smi_fifo_status_st;
 
 /**
@@ -173,6 +175,7 @@ int caribou_fpga_get_io_ctrl_rf_state (caribou_fpga_st* dev, caribou_fpga_rf_pin
 int caribou_fpga_get_smi_ctrl_fifo_status (caribou_fpga_st* dev, caribou_fpga_smi_fifo_status_st *status);
 int caribou_fpga_set_smi_channel (caribou_fpga_st* dev, caribou_fpga_smi_channel_en channel);
 int caribou_fpga_set_smi_ctrl_data_direction (caribou_fpga_st* dev, uint8_t dir);
+int caribou_fpga_set_smi_rx_dual (caribou_fpga_st* dev, bool dual);
 
 #ifdef __cplusplus
 }
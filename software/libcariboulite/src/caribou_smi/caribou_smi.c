@@ -16,6 +16,7 @@
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/poll.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <sched.h>
 #include <pthread.h>
@@ -24,8 +25,40 @@
 
 #include "caribou_smi.h"
 #include "smi_utils.h"
+#include "caribou_smi_unpack.h"
+#include "caribou_smi_pack.h"
 #include "io_utils/io_utils.h"
 
+// number of consecutive valid words required to (re)acquire the word phase
+#define CARIBOU_SMI_SYNC_WORDS      (4)
+
+// a single read gives up (returns an error) after this many attempts to
+// (re)acquire the word phase - the stream is not carrying valid samples
+#define CARIBOU_SMI_MAX_RESYNC_ATTEMPTS     (8)
+
+//=========================================================================
+static void caribou_smi_rx_ring_consume(caribou_smi_st* dev, size_t len)
+{
+    caribou_smi_rx_ring_st* ring = &dev->rx_ring;
+    ring->chunk_offset += len;
+    if (ring->chunk_offset >= ring->ctrl->chunk_size)
+    {
+        // hand the chunk back to the driver
+        ring->chunk_offset = 0;
+        ring->tail ++;
+        __atomic_store_n(&ring->ctrl->tail, ring->tail, __ATOMIC_RELEASE);
+    }
+}
+
+//=========================================================================
+static void caribou_smi_rx_ring_flush(caribou_smi_st* dev)
+{
+    caribou_smi_rx_ring_st* ring = &dev->rx_ring;
+    ring->chunk_offset = 0;
+    ring->tail = __atomic_load_n(&ring->ctrl->head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&ring->ctrl->tail, ring->tail, __ATOMIC_RELEASE);
+}
+
 //=========================================================================
 int caribou_smi_set_driver_streaming_state(caribou_smi_st* dev, smi_stream_state_en state)
 {
@@ -35,10 +68,65 @@ int caribou_smi_set_driver_streaming_state(caribou_smi_st* dev, smi_stream_state
         ZF_LOGE("failed setting smi stream state (%d)", state);
         return -1;
     }
+    
+    // a new stream (or channel) starts from an unknown word phase
+    if (dev->state != state)
+    {
+        caribou_smi_reset_alignment(dev);
+
+        // drop chunks left over from the previous stream
+        if (dev->rx_ring.mapped) caribou_smi_rx_ring_flush(dev);
+    }
     dev->state = state;
     return 0;
 }
 
+//=========================================================================
+// The stats have a single writer (the reading thread) - plain read-modify-write
+// with atomic stores keeps the snapshots on other threads consistent per member
+static inline void caribou_smi_stat_add(uint64_t* stat, uint64_t n)
+{
+    __atomic_store_n(stat, *stat + n, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t caribou_smi_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//=========================================================================
+void caribou_smi_latency_hist_add(caribou_smi_latency_hist_st* hist, uint64_t duration_ns)
+{
+    uint64_t usec = duration_ns / 1000;
+    int bin = (usec > 1) ? 63 - __builtin_clzll(usec) : 0;
+    if (bin >= CARIBOU_SMI_LATENCY_BINS) bin = CARIBOU_SMI_LATENCY_BINS - 1;
+
+    caribou_smi_stat_add(&hist->bins[bin], 1);
+    caribou_smi_stat_add(&hist->count, 1);
+    caribou_smi_stat_add(&hist->total_ns, duration_ns);
+    if (duration_ns > hist->max_ns) __atomic_store_n(&hist->max_ns, duration_ns, __ATOMIC_RELAXED);
+}
+
+//=========================================================================
+void caribou_smi_get_stream_stats(caribou_smi_st* dev, caribou_smi_stream_stats_st* stats)
+{
+    const uint64_t* src = (const uint64_t*)&dev->stats;
+    uint64_t* dst = (uint64_t*)stats;
+    for (size_t i = 0; i < sizeof(caribou_smi_stream_stats_st) / sizeof(uint64_t); i++)
+    {
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
+}
+
+//=========================================================================
+void caribou_smi_reset_alignment(caribou_smi_st* dev)
+{
+    dev->align.locked = false;
+    dev->align.carry_len = 0;
+}
+
 //=========================================================================
 smi_stream_state_en caribou_smi_get_driver_streaming_state(caribou_smi_st* dev)
 {
@@ -242,27 +330,7 @@ static int caribou_smi_find_buffer_offset(caribou_smi_st* dev, uint8_t *buffer,
         return 0;
     }
 
-    if (dev->debug_mode == caribou_smi_none)
-    {
-        for (offs = 0; offs<(len-(CARIBOU_SMI_BYTES_PER_SAMPLE*4)); offs++)
-        {
-            uint32_t s1 = *((uint32_t*)(&buffer[offs]));
-            uint32_t s2 = *((uint32_t*)(&buffer[offs+4]));
-            uint32_t s3 = *((uint32_t*)(&buffer[offs+8]));
-            uint32_t s4 = *((uint32_t*)(&buffer[offs+12]));
-			
-            //printf("%d => %08X\n", offs, s);
-            if ((s1 & 0xC001C000) == 0x80004000 &&
-                (s2 & 0xC001C000) == 0x80004000 &&
-                (s3 & 0xC001C000) == 0x80004000 &&
-                (s4 & 0xC001C000) == 0x80004000)
-            {
-                found = true;
-                break;
-            }
-        }
-    }
-    else if (dev->debug_mode == caribou_smi_push || dev->debug_mode == caribou_smi_pull)
+    if (dev->debug_mode == caribou_smi_push || dev->debug_mode == caribou_smi_pull)
     {
         for (offs = 0; offs<(len-CARIBOU_SMI_BYTES_PER_SAMPLE); offs++)
         {
@@ -290,104 +358,153 @@ static int caribou_smi_find_buffer_offset(caribou_smi_st* dev, uint8_t *buffer,
 }
 
 //=========================================================================
-static int caribou_smi_rx_data_analyze(caribou_smi_st* dev,
-                                caribou_smi_channel_en channel,
-                                uint8_t* data, size_t data_length,
-                                caribou_smi_sample_complex_int16* samples_out,
-                                caribou_smi_sample_meta* meta_offset)
+static size_t caribou_smi_sample_format_size(caribou_smi_sample_format_en format)
 {
-    int offs = 0;
-    size_t actual_length = data_length;                 // in bytes
-    int size_shortening_samples = 0;                    // in samples
-    uint32_t *actual_samples = (uint32_t*)(data);
-
-    caribou_smi_sample_complex_int16* cmplx_vec = samples_out;
-
-    // find the offset and adjust
-    offs = caribou_smi_find_buffer_offset(dev, data, data_length);
-    if (offs > 0)
+    switch (format)
     {
-        //printf("OFFSET = %d\n", offs);
+        case caribou_smi_sample_format_cf32: return sizeof(caribou_smi_sample_complex_float);
+        case caribou_smi_sample_format_cf64: return sizeof(caribou_smi_sample_complex_double);
+        case caribou_smi_sample_format_ci16:
+        default: return sizeof(caribou_smi_sample_complex_int16);
     }
+}
+
+//=========================================================================
+static void caribou_smi_rx_debug_analyze(caribou_smi_st* dev, uint8_t* data, size_t data_length)
+{
+    int offs = caribou_smi_find_buffer_offset(dev, data, data_length);
     if (offs < 0)
     {
-        return -1;
+        return;
     }
+    caribou_smi_anayze_smi_debug(dev, data + offs, (data_length - offs) & ~(CARIBOU_SMI_BYTES_PER_SAMPLE - 1));
+}
 
-    // adjust the lengths accroding to the sample mismatch
-    // this may be accompanied by a few samples losses (sphoradic OS
-    // scheduling) thus trying to stitch buffers one to another may
-    // be not effective. The single sample is interpolated
-    size_shortening_samples = (offs > 0) ? (offs / CARIBOU_SMI_BYTES_PER_SAMPLE + 1) : 0;
-    actual_length -= size_shortening_samples * CARIBOU_SMI_BYTES_PER_SAMPLE;
-    actual_samples = (uint32_t*)(data + offs);
-
-    // analyze the data
-    if (dev->debug_mode != caribou_smi_none)
+//=========================================================================
+static void caribou_smi_rx_unpack(caribou_smi_channel_en channel,
+                                const uint32_t* words, size_t num_words,
+                                void* samples_out,
+                                caribou_smi_sample_format_en format,
+                                caribou_smi_sample_meta* meta_out)
+{
+    // Data Structure:
+    //  [31:30] [   29:17   ]   [ 16  ]     [ 15:14 ]   [   13:1    ]   [   0   ]
+    //  [ '10'] [ I sample  ]   [ '0' ]     [  '01' ]   [  Q sample ]   [  'S'  ]
+    // (I and Q are swapped on the HiF channel - see caribou_smi_unpack.h)
+    // The words are decoded directly into the requested output format
+    switch (format)
     {
-        caribou_smi_anayze_smi_debug(dev, (uint8_t*)actual_samples, actual_length);
+        case caribou_smi_sample_format_cf32:
+            caribou_smi_unpack_cf32(words, num_words, (caribou_smi_sample_complex_float*)samples_out, meta_out, channel);
+            break;
+        case caribou_smi_sample_format_cf64:
+            caribou_smi_unpack_cf64(words, num_words, (caribou_smi_sample_complex_double*)samples_out, meta_out, channel);
+            break;
+        case caribou_smi_sample_format_ci16:
+        default:
+            caribou_smi_unpack(words, num_words, (caribou_smi_sample_complex_int16*)samples_out, meta_out, channel);
+            break;
     }
-    else
-    {
-        unsigned int i = 0;
-        // Print buffer
-        //smi_utils_dump_bin(buffer, 16);
+}
+
+//=========================================================================
+// Decodes a chunk of raw data while tracking the word phase. While locked, the
+// marker bits of every word are verified with the (vectorized) valid word
+// counter, and the phase is searched again from the first broken word. Returns the number of decoded samples, and the
+// number of bytes processed (decoded or dropped) in 'bytes_used'. Less than
+// CARIBOU_SMI_BYTES_PER_SAMPLE bytes are left unless 'max_samples' was reached.
+static size_t caribou_smi_rx_data_analyze(caribou_smi_st* dev,
+                                caribou_smi_channel_en channel,
+                                const uint8_t* data, size_t data_length,
+                                void* samples_out,
+                                caribou_smi_sample_format_en format,
+                                caribou_smi_sample_meta* meta_out,
+                                size_t max_samples,
+                                size_t* bytes_used)
+{
+    caribou_smi_align_st* align = &dev->align;
+    size_t sample_size = caribou_smi_sample_format_size(format);
+    size_t pos = 0;                                     // in bytes
+    size_t decoded = 0;                                 // in samples
 
-        // Data Structure:
-        //  [31:30] [   29:17   ]   [ 16  ]     [ 15:14 ]   [   13:1    ]   [   0   ]
-        //  [ '10'] [ I sample  ]   [ '0' ]     [  '01' ]   [  Q sample ]   [  'S'  ]
+    // in the dual stream bit [16] tags the channel instead of being a marker
+    uint32_t marker_mask = (dev->state == smi_stream_rx_dual) ? CARIBOU_SMI_WORD_DUAL_MARKER_MASK :
+                                                                CARIBOU_SMI_WORD_MARKER_MASK;
 
-        if (channel != caribou_smi_channel_2400)
-        {   /* S1G */
-            for (i = 0; i < actual_length / CARIBOU_SMI_BYTES_PER_SAMPLE; i++)
+    while (data_length - pos >= CARIBOU_SMI_BYTES_PER_SAMPLE && decoded < max_samples)
+    {
+        if (!align->locked)
+        {
+            align->resync_attempts ++;
+            int offs = caribou_smi_unpack_find_sync_mask(data + pos, data_length - pos, CARIBOU_SMI_SYNC_WORDS, marker_mask);
+            if (offs < 0)
             {
-                uint32_t s = /*__builtin_bswap32*/(actual_samples[i]);
-
-                if (meta_offset) meta_offset[i].sync = s & 0x00000001;
-                if (cmplx_vec)
-                {
-                    s >>= 1;
-	                cmplx_vec[i].q = s & 0x00001FFF; s >>= 13;
-	                s >>= 3;
-	                cmplx_vec[i].i = s & 0x00001FFF; s >>= 13;
-					
-					if (cmplx_vec[i].i >= (int16_t)0x1000) cmplx_vec[i].i -= (int16_t)0x2000;
-                	if (cmplx_vec[i].q >= (int16_t)0x1000) cmplx_vec[i].q -= (int16_t)0x2000;
-                }
+                // keep the tail - it may be the beginning of a valid sequence
+                size_t keep = data_length - pos;
+                if (keep > CARIBOU_SMI_BYTES_PER_SAMPLE - 1) keep = CARIBOU_SMI_BYTES_PER_SAMPLE - 1;
+                align->dropped_bytes += data_length - pos - keep;
+                caribou_smi_stat_add(&dev->stats.resync_dropped_bytes, data_length - pos - keep);
+                pos = data_length - keep;
+                break;
             }
-        }
-        else
-        {   /* HiF */
-            for (i = 0; i < actual_length / CARIBOU_SMI_BYTES_PER_SAMPLE; i++)
+
+            align->dropped_bytes += offs;
+            align->resync_count ++;
+            caribou_smi_stat_add(&dev->stats.resync_dropped_bytes, offs);
+            caribou_smi_stat_add(&dev->stats.resyncs, 1);
+            align->locked = true;
+            pos += offs;
+            if (offs > 0 || align->resync_count > 1)
             {
-                uint32_t s = /*__builtin_bswap32*/(actual_samples[i]);
-
-                if (meta_offset) meta_offset[i].sync = s & 0x00000001;
-                if (cmplx_vec)
-                {   
-				 	s >>= 1;
-	                cmplx_vec[i].i = s & 0x00001FFF; s >>= 13;
-	                s >>= 3;
-	                cmplx_vec[i].q = s & 0x00001FFF; s >>= 13;
-					
-					if (cmplx_vec[i].i >= (int16_t)0x1000) cmplx_vec[i].i -= (int16_t)0x2000;
-                	if (cmplx_vec[i].q >= (int16_t)0x1000) cmplx_vec[i].q -= (int16_t)0x2000;
-                }
+                ZF_LOGD("smi stream (re)synchronized: offset %d bytes, resyncs: %u", offs, align->resync_count);
             }
         }
 
-        // last sample interpolation (linear for I and Q or preserve)
-        if (size_shortening_samples > 0)
+        const uint32_t* words = (const uint32_t*)(data + pos);
+        size_t num_words = (data_length - pos) / CARIBOU_SMI_BYTES_PER_SAMPLE;
+        if (num_words > max_samples - decoded) num_words = max_samples - decoded;
+
+        // any broken word (a phase slip or a corrupted one) ends the decoded run
+        size_t good_words = caribou_smi_unpack_count_valid_mask(words, num_words, marker_mask);
+        if (good_words < num_words)
         {
-            //cmplx_vec[i].i = 2*cmplx_vec[i-1].i - cmplx_vec[i-2].i;
-            //cmplx_vec[i].q = 2*cmplx_vec[i-1].q - cmplx_vec[i-2].q;
+            align->locked = false;
+        }
 
-            cmplx_vec[i].i = 110*cmplx_vec[i-1].i/100 - cmplx_vec[i-2].i/10;
-            cmplx_vec[i].q = 110*cmplx_vec[i-1].q/100 - cmplx_vec[i-2].q/10;
+        if (dev->dual_rx.active)
+        {
+            caribou_smi_unpack_dual(words, good_words, dev->dual_rx.format,
+                                    dev->dual_rx.samples, dev->dual_rx.meta, dev->dual_rx.counts);
+        }
+        else
+        {
+            caribou_smi_rx_unpack(channel, words, good_words,
+                                samples_out ? (uint8_t*)samples_out + decoded * sample_size : NULL,
+                                format,
+                                meta_out ? meta_out + decoded : NULL);
         }
+        decoded += good_words;
+        pos += good_words * CARIBOU_SMI_BYTES_PER_SAMPLE;
     }
 
-    return offs;
+    *bytes_used = pos;
+    return decoded;
+}
+
+//=========================================================================
+// Keeps the unprocessed tail of a chunk (a partial word) for the next one
+static void caribou_smi_rx_carry(caribou_smi_st* dev, const uint8_t* data, size_t len)
+{
+    caribou_smi_align_st* align = &dev->align;
+    if (len > CARIBOU_SMI_BYTES_PER_SAMPLE - 1)
+    {
+        // output buffer full - should not happen as reads are sized accordingly
+        align->dropped_bytes += len;
+        align->locked = false;
+        len = 0;
+    }
+    memcpy(align->carry, data, len);
+    align->carry_len = len;
 }
 
 //=========================================================================
@@ -489,6 +606,124 @@ static int caribou_smi_timeout_read(caribou_smi_st* dev,
     return ret;
 }
 
+//=========================================================================
+// Waits for a chunk in the rx ring. Returns the number of bytes left in the
+// current chunk ('data' points to them), 0 on timeout or -1 on error
+static int caribou_smi_rx_ring_wait(caribou_smi_st* dev, uint8_t** data, uint32_t timeout_num_millisec)
+{
+    caribou_smi_rx_ring_st* ring = &dev->rx_ring;
+    struct smi_stream_rx_ring_ctrl* ctrl = ring->ctrl;
+
+    uint32_t head = 0;
+    while (1)
+    {
+        head = __atomic_load_n(&ctrl->head, __ATOMIC_ACQUIRE);
+
+        uint32_t first_valid = __atomic_load_n(&ctrl->first_valid, __ATOMIC_RELAXED);
+        if ((int32_t)(first_valid - ring->tail) > 0)
+        {
+            // the cyclic dma was restarted at the ring start - whatever is left
+            // before 'first_valid' is not part of the current run
+            uint32_t lost = first_valid - ring->tail;
+            dev->align.dropped_bytes += (uint64_t)lost * ctrl->chunk_size - ring->chunk_offset;
+            caribou_smi_stat_add(&dev->stats.ring_dropped_bytes, (uint64_t)lost * ctrl->chunk_size - ring->chunk_offset);
+            caribou_smi_reset_alignment(dev);
+            ring->chunk_offset = 0;
+            ring->tail = first_valid;
+            __atomic_store_n(&ctrl->tail, ring->tail, __ATOMIC_RELEASE);
+        }
+
+        if (head != ring->tail)
+        {
+            break;
+        }
+
+        // the driver notifies poll() for every completed chunk
+        int res = caribou_smi_poll(dev, timeout_num_millisec, smi_stream_dir_device_to_smi);
+        if (res <= 0)
+        {
+            return res;
+        }
+    }
+
+    if (head - ring->tail >= ctrl->num_chunks)
+    {
+        // cyclic dma lapped us - the oldest chunks were overwritten, continue
+        // from the newest complete one
+        uint32_t lost = head - 1 - ring->tail;
+        ZF_LOGW("smi rx ring overrun - %u chunks lost", lost);
+        dev->align.dropped_bytes += (uint64_t)lost * ctrl->chunk_size - ring->chunk_offset;
+        caribou_smi_stat_add(&dev->stats.ring_dropped_bytes, (uint64_t)lost * ctrl->chunk_size - ring->chunk_offset);
+        caribou_smi_reset_alignment(dev);
+        ring->chunk_offset = 0;
+        ring->tail = head - 1;
+        __atomic_store_n(&ctrl->tail, ring->tail, __ATOMIC_RELEASE);
+    }
+
+    uint32_t overflows = __atomic_load_n(&ctrl->overflows, __ATOMIC_RELAXED);
+    if (overflows != ring->overflows)
+    {
+        ZF_LOGW("smi rx ring overflow - %u chunks dropped", overflows - ring->overflows);
+        ring->overflows = overflows;
+    }
+
+    *data = ring->data + (size_t)(ring->tail % ctrl->num_chunks) * ctrl->chunk_size + ring->chunk_offset;
+    return ctrl->chunk_size - ring->chunk_offset;
+}
+
+//=========================================================================
+static int caribou_smi_map_rx_ring(caribou_smi_st* dev)
+{
+    caribou_smi_rx_ring_st* ring = &dev->rx_ring;
+    size_t map_len = 0;
+
+    memset(ring, 0, sizeof(caribou_smi_rx_ring_st));
+    if (ioctl(dev->filedesc, SMI_STREAM_IOC_GET_RX_RING_SIZE, &map_len) != 0 || map_len == 0)
+    {
+        ZF_LOGI("smi driver doesn't provide an rx ring, using read()");
+        return -1;
+    }
+
+    void* map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, dev->filedesc, 0);
+    if (map == MAP_FAILED)
+    {
+        ZF_LOGW("smi rx ring mmap failed (%s), using read()", strerror(errno));
+        return -1;
+    }
+
+    struct smi_stream_rx_ring_ctrl* ctrl = (struct smi_stream_rx_ring_ctrl*)map;
+    if (ctrl->magic != SMI_STREAM_RX_RING_MAGIC || ctrl->num_chunks == 0 || ctrl->chunk_size == 0 ||
+        ctrl->data_offset + (size_t)ctrl->num_chunks * ctrl->chunk_size > map_len)
+    {
+        ZF_LOGE("smi rx ring control page is invalid");
+        munmap(map, map_len);
+        return -1;
+    }
+
+    ring->map = map;
+    ring->map_len = map_len;
+    ring->ctrl = ctrl;
+    ring->data = (uint8_t*)map + ctrl->data_offset;
+    ring->tail = ctrl->tail;
+    ring->overflows = ctrl->overflows;
+    ring->chunk_offset = 0;
+    ring->mapped = true;
+
+    ZF_LOGI("smi rx ring mapped: %u chunks of %u bytes", ctrl->num_chunks, ctrl->chunk_size);
+    return 0;
+}
+
+//=========================================================================
+static void caribou_smi_unmap_rx_ring(caribou_smi_st* dev)
+{
+    caribou_smi_rx_ring_st* ring = &dev->rx_ring;
+    if (ring->mapped)
+    {
+        munmap(ring->map, ring->map_len);
+    }
+    memset(ring, 0, sizeof(caribou_smi_rx_ring_st));
+}
+
 //=========================================================================
 void caribou_smi_setup_ios(caribou_smi_st* dev)
 {
@@ -569,6 +804,12 @@ int caribou_smi_init(caribou_smi_st* dev,
         return -1;
     }
     memset(&dev->debug_data, 0, sizeof(caribou_smi_debug_data_st));
+    memset(&dev->stats, 0, sizeof(caribou_smi_stream_stats_st));
+
+    // zero-copy rx and rx accounting - optional, depend on the driver version
+    caribou_smi_map_rx_ring(dev);
+    struct smi_stream_rx_stats stats;
+    dev->rx_stats_supported = ioctl(dev->filedesc, SMI_STREAM_IOC_GET_RX_STATS, &stats) == 0;
 
     dev->debug_mode = caribou_smi_none;
     dev->invert_iq = false;
@@ -581,6 +822,8 @@ int caribou_smi_init(caribou_smi_st* dev,
 //=========================================================================
 int caribou_smi_close (caribou_smi_st* dev)
 {
+    caribou_smi_unmap_rx_ring(dev);
+
     // release temporary buffers
     if (dev->read_temp_buffer) free(dev->read_temp_buffer);
     if (dev->write_temp_buffer) free(dev->write_temp_buffer);
@@ -627,27 +870,179 @@ static int caribou_smi_calc_read_timeout(uint32_t sample_rate, size_t len)
 }
 
 //=========================================================================
-int caribou_smi_read(caribou_smi_st* dev, caribou_smi_channel_en channel,
-                    caribou_smi_sample_complex_int16* samples,
+// Tags the next sample to be decoded, which starts 'offset' bytes after the
+// beginning of a chunk described by 'info' (the chunk holds 'chunk_len' bytes)
+static void caribou_smi_rx_tag(caribou_smi_st* dev, const struct smi_stream_rx_chunk_info* info,
+                                int64_t offset, size_t chunk_len)
+{
+    caribou_smi_rx_info_st* rx_info = &dev->rx_info;
+    int64_t bytes_to_end = (int64_t)chunk_len - offset + dev->align.carry_len;
+    
+    rx_info->sample_index = (info->stream_bytes - bytes_to_end) / CARIBOU_SMI_BYTES_PER_SAMPLE;
+    rx_info->timestamp_ns = info->timestamp_ns - 
+                    (uint64_t)(bytes_to_end / CARIBOU_SMI_BYTES_PER_SAMPLE) * 1000000000ULL / dev->sample_rate;
+    rx_info->lost_samples = (info->lost_bytes + dev->align.dropped_bytes) / CARIBOU_SMI_BYTES_PER_SAMPLE;
+    rx_info->valid = true;
+    __atomic_store_n(&dev->stats.kernel_dropped_bytes, info->lost_bytes, __ATOMIC_RELAXED);
+}
+
+//=========================================================================
+int caribou_smi_get_rx_info(caribou_smi_st* dev, caribou_smi_rx_info_st* info)
+{
+    if (!dev->rx_info.valid)
+    {
+        return -1;
+    }
+    *info = dev->rx_info;
+    return 0;
+}
+
+//=========================================================================
+// Same as 'caribou_smi_read_format' below, consuming the samples in place from
+// the driver's rx ring. The partial word at the end of a chunk is completed
+// from the beginning of the next one.
+static int caribou_smi_read_ring(caribou_smi_st* dev, caribou_smi_channel_en channel,
+                    void* samples,
+                    caribou_smi_sample_format_en format,
                     caribou_smi_sample_meta* metadata,
                     size_t length_samples)
 {
-    caribou_smi_sample_complex_int16* sample_offset = samples;
-    caribou_smi_sample_meta* meta_offset = metadata;
-    size_t left_to_read = length_samples * CARIBOU_SMI_BYTES_PER_SAMPLE;        // in bytes
+    size_t sample_size = caribou_smi_sample_format_size(format);
+    size_t read_so_far = 0;                                                     // in samples
+    uint32_t to_millisec = caribou_smi_calc_read_timeout(dev->sample_rate, dev->rx_ring.ctrl->chunk_size);
+    uint32_t resync_attempts = dev->align.resync_attempts;
+
+    while (read_so_far < length_samples)
+    {
+        uint8_t* data = NULL;
+        uint64_t wait_start = caribou_smi_now_ns();
+        int avail = caribou_smi_rx_ring_wait(dev, &data, to_millisec);
+        caribou_smi_latency_hist_add(&dev->stats.read_latency, caribou_smi_now_ns() - wait_start);
+        if (avail < 0)
+        {
+            return -1;
+        }
+        else if (avail == 0)
+        {
+            ZF_LOGD("Reading timed-out");
+            caribou_smi_stat_add(&dev->stats.read_timeouts, 1);
+            break;
+        }
+
+        if (read_so_far == 0)
+        {
+            struct smi_stream_rx_ring_ctrl* ctrl = dev->rx_ring.ctrl;
+            caribou_smi_rx_tag(dev, &ctrl->chunk_info[dev->rx_ring.tail % ctrl->num_chunks],
+                                dev->rx_ring.chunk_offset, ctrl->chunk_size);
+        }
+
+        // A special functionality for debug modes
+        if (dev->debug_mode != caribou_smi_none)
+        {
+            dev->align.carry_len = 0;
+            caribou_smi_rx_debug_analyze(dev, data, avail);
+            caribou_smi_print_debug_stats(dev, data, avail);
+            caribou_smi_rx_ring_consume(dev, avail);
+            return -2;
+        }
+
+        size_t pos = 0;
+        size_t used = 0;
+        if (dev->align.carry_len > 0)
+        {
+            // stitch the carried bytes with the head of this chunk into a single word
+            uint8_t word[CARIBOU_SMI_BYTES_PER_SAMPLE];
+            size_t carry_len = dev->align.carry_len;
+            size_t head_len = CARIBOU_SMI_BYTES_PER_SAMPLE - carry_len;
+            if (head_len > (size_t)avail) head_len = avail;
+            memcpy(word, dev->align.carry, carry_len);
+            memcpy(word + carry_len, data, head_len);
+            dev->align.carry_len = 0;
+
+            read_so_far += caribou_smi_rx_data_analyze(dev, channel, word, carry_len + head_len,
+                                            samples ? (uint8_t*)samples + read_so_far * sample_size : NULL,
+                                            format,
+                                            metadata ? metadata + read_so_far : NULL,
+                                            length_samples - read_so_far, &used);
+
+            // bytes of this chunk that were not decoded are re-examined in place
+            size_t left = carry_len + head_len - used;
+            if (left <= head_len) pos = head_len - left;
+            else dev->align.dropped_bytes += left - head_len;
+        }
+
+        read_so_far += caribou_smi_rx_data_analyze(dev, channel, data + pos, avail - pos,
+                                        samples ? (uint8_t*)samples + read_so_far * sample_size : NULL,
+                                        format,
+                                        metadata ? metadata + read_so_far : NULL,
+                                        length_samples - read_so_far, &used);
+        pos += used;
+
+        // the chunk's tail (a partial word) is carried into the next chunk
+        if ((size_t)avail - pos < CARIBOU_SMI_BYTES_PER_SAMPLE)
+        {
+            caribou_smi_rx_carry(dev, data + pos, avail - pos);
+            pos = avail;
+        }
+        caribou_smi_rx_ring_consume(dev, pos);
+
+        if (dev->align.resync_attempts - resync_attempts > CARIBOU_SMI_MAX_RESYNC_ATTEMPTS)
+        {
+            ZF_LOGE("smi stream out of sync - gave up after %d resync attempts", CARIBOU_SMI_MAX_RESYNC_ATTEMPTS);
+            return -1;
+        }
+    }
+
+    return read_so_far;
+}
+
+//=========================================================================
+static int caribou_smi_read_stream(caribou_smi_st* dev, caribou_smi_channel_en channel,
+                    void* samples,
+                    caribou_smi_sample_format_en format,
+                    caribou_smi_sample_meta* metadata,
+                    size_t length_samples)
+{
+    if ((dev->state == smi_stream_rx_dual) != dev->dual_rx.active)
+    {
+        ZF_LOGE("the dual rx stream should be read using caribou_smi_read_dual");
+        return -1;
+    }
+
+    if (dev->rx_ring.mapped)
+    {
+        return caribou_smi_read_ring(dev, channel, samples, format, metadata, length_samples);
+    }
+
+    size_t sample_size = caribou_smi_sample_format_size(format);
     size_t read_so_far = 0;                                                     // in samples
     uint32_t to_millisec = caribou_smi_calc_read_timeout(dev->sample_rate, dev->native_batch_len);
+    uint32_t resync_attempts = dev->align.resync_attempts;
+
+    // the next byte out of the driver's fifo follows the last chunk by 'pending_bytes'
+    struct smi_stream_rx_stats stats = {0};
+    if (dev->rx_stats_supported && ioctl(dev->filedesc, SMI_STREAM_IOC_GET_RX_STATS, &stats) == 0)
+    {
+        caribou_smi_rx_tag(dev, &stats.last_chunk, 0, stats.pending_bytes);
+    }
   
-    while (left_to_read)
+    while (read_so_far < length_samples)
     {
-        if (sample_offset) sample_offset = samples + read_so_far;
-        if (meta_offset) meta_offset = metadata + read_so_far;
+        uint8_t* sample_offset = samples ? (uint8_t*)samples + read_so_far * sample_size : NULL;
+        caribou_smi_sample_meta* meta_offset = metadata ? metadata + read_so_far : NULL;
+
+        // the bytes carried from the previous read are placed in front of the new data
+        size_t carry_len = dev->align.carry_len;
+        memcpy(dev->read_temp_buffer, dev->align.carry, carry_len);
 
         // current_read_len in bytes
+        size_t left_to_read = (length_samples - read_so_far) * CARIBOU_SMI_BYTES_PER_SAMPLE - carry_len;
         size_t current_read_len = ((left_to_read > dev->native_batch_len) ? dev->native_batch_len : left_to_read);
         
         to_millisec = caribou_smi_calc_read_timeout(dev->sample_rate, current_read_len);
-        int ret = caribou_smi_timeout_read(dev, dev->read_temp_buffer, current_read_len, to_millisec);
+        uint64_t read_start = caribou_smi_now_ns();
+        int ret = caribou_smi_timeout_read(dev, dev->read_temp_buffer + carry_len, current_read_len, to_millisec);
+        caribou_smi_latency_hist_add(&dev->stats.read_latency, caribou_smi_now_ns() - read_start);
         if (ret < 0)
         {
             return -1;
@@ -655,55 +1050,114 @@ int caribou_smi_read(caribou_smi_st* dev, caribou_smi_channel_en channel,
         else if (ret == 0)
         {
             ZF_LOGD("Reading timed-out");
+            caribou_smi_stat_add(&dev->stats.read_timeouts, 1);
             break;
         }
-        else
+
+        // A special functionality for debug modes
+        if (dev->debug_mode != caribou_smi_none)
         {
-            int data_affset = caribou_smi_rx_data_analyze(dev, channel, dev->read_temp_buffer, ret, sample_offset, meta_offset);
-            if (data_affset < 0)
-            {
-                return -1;
-            }
+            dev->align.carry_len = 0;
+            caribou_smi_rx_debug_analyze(dev, dev->read_temp_buffer + carry_len, ret);
+            caribou_smi_print_debug_stats(dev, dev->read_temp_buffer + carry_len, ret);
+            return -2;
+        }
 
-            // A special functionality for debug modes
-            if (dev->debug_mode != caribou_smi_none)
-            {
-                caribou_smi_print_debug_stats(dev, dev->read_temp_buffer, ret);
-                return -2;
-            }
+        size_t used = 0;
+        read_so_far += caribou_smi_rx_data_analyze(dev, channel, dev->read_temp_buffer, carry_len + ret,
+                                                   sample_offset, format, meta_offset,
+                                                   length_samples - read_so_far, &used);
+        caribou_smi_rx_carry(dev, dev->read_temp_buffer + used, carry_len + ret - used);
+
+        if (dev->align.resync_attempts - resync_attempts > CARIBOU_SMI_MAX_RESYNC_ATTEMPTS)
+        {
+            ZF_LOGE("smi stream out of sync - gave up after %d resync attempts", CARIBOU_SMI_MAX_RESYNC_ATTEMPTS);
+            return -1;
         }
-        read_so_far += ret / CARIBOU_SMI_BYTES_PER_SAMPLE;
-        left_to_read -= ret;
     }
 
     return read_so_far;
 }
 
+//=========================================================================
+static int caribou_smi_read_format(caribou_smi_st* dev, caribou_smi_channel_en channel,
+                    void* samples,
+                    caribou_smi_sample_format_en format,
+                    caribou_smi_sample_meta* metadata,
+                    size_t length_samples)
+{
+    int ret = caribou_smi_read_stream(dev, channel, samples, format, metadata, length_samples);
+    caribou_smi_stat_add(&dev->stats.read_calls, 1);
+    if (ret > 0) caribou_smi_stat_add(&dev->stats.samples_delivered, ret);
+    return ret;
+}
+
+//=========================================================================
+int caribou_smi_read(caribou_smi_st* dev, caribou_smi_channel_en channel,
+                    caribou_smi_sample_complex_int16* samples,
+                    caribou_smi_sample_meta* metadata,
+                    size_t length_samples)
+{
+    return caribou_smi_read_format(dev, channel, samples, caribou_smi_sample_format_ci16, metadata, length_samples);
+}
+
+//=========================================================================
+int caribou_smi_read_cf32(caribou_smi_st* dev, caribou_smi_channel_en channel,
+                    caribou_smi_sample_complex_float* samples,
+                    caribou_smi_sample_meta* metadata,
+                    size_t length_samples)
+{
+    return caribou_smi_read_format(dev, channel, samples, caribou_smi_sample_format_cf32, metadata, length_samples);
+}
+
+//=========================================================================
+int caribou_smi_read_cf64(caribou_smi_st* dev, caribou_smi_channel_en channel,
+                    caribou_smi_sample_complex_double* samples,
+                    caribou_smi_sample_meta* metadata,
+                    size_t length_samples)
+{
+    return caribou_smi_read_format(dev, channel, samples, caribou_smi_sample_format_cf64, metadata, length_samples);
+}
+
+//=========================================================================
+int caribou_smi_read_dual(caribou_smi_st* dev, caribou_smi_sample_format_en format,
+                    void* samples[2], caribou_smi_sample_meta* metadata[2],
+                    size_t length_words, size_t counts[2])
+{
+    if (dev->state != smi_stream_rx_dual)
+    {
+        ZF_LOGE("the smi stream is not in dual rx mode (state %d)", dev->state);
+        return -1;
+    }
+
+    // the words of both channels are decoded by the same path - the outputs are
+    // taken from 'dual_rx' instead of the single channel buffers
+    caribou_smi_dual_rx_st* dual = &dev->dual_rx;
+    dual->format = format;
+    for (int ch = 0; ch < 2; ch++)
+    {
+        dual->samples[ch] = samples[ch];
+        dual->meta[ch] = metadata[ch];
+        dual->counts[ch] = 0;
+    }
+    dual->active = true;
+
+    int ret = caribou_smi_read_format(dev, caribou_smi_channel_900, NULL, format, NULL, length_words);
+
+    dual->active = false;
+    counts[0] = dual->counts[0];
+    counts[1] = dual->counts[1];
+    return ret;
+}
+
 #define SMI_TX_SAMPLE_SOF               (1<<2)
 #define SMI_TX_SAMPLE_MODEM_TX_CTRL     (1<<1)
 #define SMI_TX_SAMPLE_COND_TX_CTRL      (1<<0)
 //=========================================================================
 static void caribou_smi_generate_data(caribou_smi_st* dev, uint8_t* data, size_t data_length, caribou_smi_sample_complex_int16* sample_offset)
 {
-    caribou_smi_sample_complex_int16* cmplx_vec = sample_offset;  
-    uint32_t *samples = (uint32_t*)(data);
-	
-    for (unsigned int i = 0; i < (data_length / CARIBOU_SMI_BYTES_PER_SAMPLE); i++)
-    {                    
-        int32_t ii = cmplx_vec[i].i;
-        int32_t qq = cmplx_vec[i].q;
-		
-        uint32_t s = SMI_TX_SAMPLE_SOF | SMI_TX_SAMPLE_MODEM_TX_CTRL | SMI_TX_SAMPLE_COND_TX_CTRL; s <<= 5;
-        s |= (ii >> 8) & 0x1F; s <<= 8;
-        s |= (ii >> 1) & 0x7F; s <<= 2;
-        s |= (ii & 0x1); s <<= 6;
-        s |= (qq >> 7) & 0x3F; s <<= 8;
-        s |= (qq & 0x7F);
-		
-		//if (i < 2) printf("0x%08X\n", s);
-		
-        samples[i] = __builtin_bswap32(s);
-    }
+    // SOF / modem tx ctrl / cond. tx ctrl are set on every word (see caribou_smi_pack.h)
+    caribou_smi_pack(sample_offset, data_length / CARIBOU_SMI_BYTES_PER_SAMPLE, (uint32_t*)data);
 }
 
 //=========================================================================
@@ -751,6 +1205,47 @@ int caribou_smi_write(caribou_smi_st* dev, caribou_smi_channel_en channel,
     return written_so_far;
 }
 
+//=========================================================================
+void caribou_smi_pack_tx(caribou_smi_st* dev, uint32_t* words,
+                        const caribou_smi_sample_complex_int16* samples, size_t length_samples)
+{
+    caribou_smi_generate_data(dev, (uint8_t*)words, length_samples * CARIBOU_SMI_BYTES_PER_SAMPLE,
+                            (caribou_smi_sample_complex_int16*)samples);
+}
+
+//=========================================================================
+int caribou_smi_write_packed(caribou_smi_st* dev, const uint32_t* words, size_t length_samples)
+{
+    size_t left_to_write = length_samples * CARIBOU_SMI_BYTES_PER_SAMPLE;   // in bytes
+    size_t written_so_far = 0;                                              // in bytes
+    uint32_t to_millisec = (2 * length_samples * 1000) / CARIBOU_SMI_SAMPLE_RATE;
+    if (to_millisec < 2) to_millisec = 2;
+
+    if (caribou_smi_set_driver_streaming_state(dev, smi_stream_tx_channel) != 0)
+    {
+        ZF_LOGE("failed setting the tx streaming state");
+        return -1;
+    }
+
+    // the words are already in their wire format - written straight from the
+    // caller's buffer
+    while (left_to_write)
+    {
+        size_t current_write_len = (left_to_write > dev->native_batch_len) ? dev->native_batch_len : left_to_write;
+        int ret = caribou_smi_timeout_write(dev, (uint8_t*)words + written_so_far, current_write_len, to_millisec);
+        if (ret < 0)
+        {
+            return -1;
+        }
+        else if (ret == 0) break;
+
+        written_so_far += ret;
+        left_to_write -= ret;
+    }
+
+    return written_so_far / CARIBOU_SMI_BYTES_PER_SAMPLE;
+}
+
 //=========================================================================
 size_t caribou_smi_get_native_batch_samples(caribou_smi_st* dev)
 {
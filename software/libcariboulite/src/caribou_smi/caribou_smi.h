@@ -58,12 +58,107 @@ typedef struct
 	int16_t q;                      // MSB
 } caribou_smi_sample_complex_int16;
 
+// associated with CF32 - total 8 bytes / element
+typedef struct
+{
+	float i;                        // LSB
+	float q;                        // MSB
+} caribou_smi_sample_complex_float;
+
+// associated with CF64 - total 16 bytes / element
+typedef struct
+{
+	double i;                       // LSB
+	double q;                       // MSB
+} caribou_smi_sample_complex_double;
+
 typedef struct
 {
 	uint8_t sync;
 } caribou_smi_sample_meta;
 #pragma pack()
 
+typedef enum
+{
+	caribou_smi_sample_format_ci16 = 0,     // caribou_smi_sample_complex_int16
+	caribou_smi_sample_format_cf32 = 1,     // caribou_smi_sample_complex_float (scaled to [-1, 1))
+	caribou_smi_sample_format_cf64 = 2,     // caribou_smi_sample_complex_double (scaled to [-1, 1))
+} caribou_smi_sample_format_en;
+
+// RX word alignment tracking - kept across reads so the sample stream
+// stays contiguous between consecutive driver chunks
+typedef struct
+{
+    bool locked;                                        // the word phase is known
+    uint8_t carry[CARIBOU_SMI_BYTES_PER_SAMPLE];        // partial word left over from the last read
+    size_t carry_len;                                   // in bytes
+    uint32_t resync_count;                              // number of (re)synchronizations
+    uint32_t resync_attempts;                           // word phase searches, successful or not
+    uint64_t dropped_bytes;                             // bytes discarded while out of sync
+} caribou_smi_align_st;
+
+// Zero-copy RX ring mapped from the driver (see struct smi_stream_rx_ring_ctrl)
+// When the loaded driver doesn't support it, reads fall back to read()
+typedef struct
+{
+    bool mapped;
+    void* map;
+    size_t map_len;
+    struct smi_stream_rx_ring_ctrl* ctrl;
+    uint8_t* data;
+    uint32_t tail;                                      // local copy of ctrl->tail
+    size_t chunk_offset;                                // bytes consumed from the current chunk
+    uint32_t overflows;                                 // last seen ctrl->overflows
+} caribou_smi_rx_ring_st;
+
+// Timing and loss accounting of the first sample returned by the last read
+// (estimated from the completion time of the driver's DMA chunk it arrived in)
+typedef struct
+{
+    bool valid;                                         // the driver provides rx accounting
+    uint64_t timestamp_ns;                              // CLOCK_MONOTONIC
+    uint64_t sample_index;                              // position in the stream since the device was opened
+    uint64_t lost_samples;                              // total lost - driver overflows and resynchronization
+} caribou_smi_rx_info_st;
+
+// Destination of a dual rx read (smi_stream_rx_dual) - both channels are
+// demultiplexed while decoding, indexed by caribou_smi_channel_en
+typedef struct
+{
+    bool active;
+    caribou_smi_sample_format_en format;
+    void* samples[2];
+    caribou_smi_sample_meta* meta[2];
+    size_t counts[2];                                   // samples written to each channel
+} caribou_smi_dual_rx_st;
+
+// Duration histogram - bin 'n' counts the durations in [2^n, 2^(n+1)) usec, the
+// first bin also takes the shorter ones and the last bin the longer ones
+#define CARIBOU_SMI_LATENCY_BINS                        (16)
+
+typedef struct
+{
+    uint64_t bins[CARIBOU_SMI_LATENCY_BINS];
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} caribou_smi_latency_hist_st;
+
+// Always-on RX accounting since the device was opened. Updated by the reading
+// thread only - other threads take a snapshot with 'caribou_smi_get_stream_stats'.
+// (all members are uint64_t, so that the snapshot can be copied word by word)
+typedef struct
+{
+    uint64_t read_calls;
+    uint64_t samples_delivered;
+    uint64_t resyncs;                                   // word (re)synchronizations
+    uint64_t resync_dropped_bytes;                      // discarded while out of word sync
+    uint64_t read_timeouts;
+    uint64_t kernel_dropped_bytes;                      // lost in the driver (fifo / ring full)
+    uint64_t ring_dropped_bytes;                        // overwritten in the rx ring before consumed
+    caribou_smi_latency_hist_st read_latency;           // waiting for the driver (read / poll)
+} caribou_smi_stream_stats_st;
+
 typedef struct
 {
     int initialized;
@@ -76,6 +171,12 @@ typedef struct
     uint8_t *write_temp_buffer;
     
     bool invert_iq;
+    caribou_smi_align_st align;
+    caribou_smi_rx_ring_st rx_ring;
+    bool rx_stats_supported;
+    caribou_smi_rx_info_st rx_info;
+    caribou_smi_dual_rx_st dual_rx;
+    caribou_smi_stream_stats_st stats;
 
 	// debugging
 	caribou_smi_debug_mode_en debug_mode;
@@ -92,13 +193,39 @@ void caribou_smi_invert_iq(caribou_smi_st* dev, bool invert);
 void caribou_smi_set_debug_mode(caribou_smi_st* dev, caribou_smi_debug_mode_en mode);
 int caribou_smi_set_driver_streaming_state(caribou_smi_st* dev, smi_stream_state_en state);
 smi_stream_state_en caribou_smi_get_driver_streaming_state(caribou_smi_st* dev);
+void caribou_smi_reset_alignment(caribou_smi_st* dev);
 
 int caribou_smi_read(caribou_smi_st* dev, caribou_smi_channel_en channel, 
                         caribou_smi_sample_complex_int16* buffer, caribou_smi_sample_meta* metadata, size_t length_samples);
+int caribou_smi_read_cf32(caribou_smi_st* dev, caribou_smi_channel_en channel, 
+                        caribou_smi_sample_complex_float* buffer, caribou_smi_sample_meta* metadata, size_t length_samples);
+int caribou_smi_read_cf64(caribou_smi_st* dev, caribou_smi_channel_en channel, 
+                        caribou_smi_sample_complex_double* buffer, caribou_smi_sample_meta* metadata, size_t length_samples);
                         
+// Reads up to 'length_words' words of a dual rx stream (the driver must be in
+// smi_stream_rx_dual) and splits them by channel into 'samples[ch]' / 'metadata[ch]'
+// (each large enough for 'length_words' samples, any may be NULL). The number of
+// samples written to each channel is returned in 'counts', the total is returned.
+int caribou_smi_read_dual(caribou_smi_st* dev, caribou_smi_sample_format_en format,
+                        void* samples[2], caribou_smi_sample_meta* metadata[2],
+                        size_t length_words, size_t counts[2]);
+
+int caribou_smi_get_rx_info(caribou_smi_st* dev, caribou_smi_rx_info_st* info);
+
+// Safe to call from any thread while another one reads
+void caribou_smi_get_stream_stats(caribou_smi_st* dev, caribou_smi_stream_stats_st* stats);
+void caribou_smi_latency_hist_add(caribou_smi_latency_hist_st* hist, uint64_t duration_ns);
+
 int caribou_smi_write(caribou_smi_st* dev, caribou_smi_channel_en channel, 
                         caribou_smi_sample_complex_int16* buffer, size_t length_samples);
 
+// TX split into its two stages so that they can be pipelined - 'caribou_smi_pack_tx'
+// converts samples into SMI words (the wire format) and 'caribou_smi_write_packed'
+// writes such words. Returns the number of samples written.
+void caribou_smi_pack_tx(caribou_smi_st* dev, uint32_t* words,
+                        const caribou_smi_sample_complex_int16* samples, size_t length_samples);
+int caribou_smi_write_packed(caribou_smi_st* dev, const uint32_t* words, size_t length_samples);
+
 size_t caribou_smi_get_native_batch_samples(caribou_smi_st* dev);
 
 void caribou_smi_setup_ios(caribou_smi_st* dev);
@@ -0,0 +1,336 @@
+#ifndef ZF_LOG_LEVEL
+    #define ZF_LOG_LEVEL ZF_LOG_VERBOSE
+#endif
+#define ZF_LOG_DEF_SRCLOC ZF_LOG_SRCLOC_LONG
+#define ZF_LOG_TAG "CARIBOU_SMI_PACK"
+#include "zf_log/zf_log.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define CARIBOU_SMI_PACK_X86        1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+    #include <arm_neon.h>
+    #define CARIBOU_SMI_PACK_NEON       1
+#endif
+
+#include "caribou_smi_pack.h"
+
+// The TX word is built directly in its byte swapped (wire) order from the
+// native sample word x = {I (LSB), Q (MSB)} - every field is a single
+// shift and mask of x, so the same sequence vectorizes as is:
+//      byte 0  = 0xE0 | I[12:8]    <=  (x >> 8)  & 0x0000001F
+//      byte 1  = I[7:1]            <=  (x << 7)  & 0x00007F00
+//      byte 2  = I[0] | Q[12:7]    <=  (x << 22) & 0x00400000,  (x >> 7) & 0x003F0000
+//      byte 3  = Q[6:0]            <=  (x << 8)  & 0x7F000000
+#define PACK_CTRL_BITS          (0x000000E0)
+#define PACK_WORD(x)            (PACK_CTRL_BITS | \
+                                (((x) >> 8) & 0x0000001F) | \
+                                (((x) << 7) & 0x00007F00) | \
+                                (((x) << 22) & 0x00400000) | \
+                                (((x) >> 7) & 0x003F0000) | \
+                                (((x) << 8) & 0x7F000000))
+
+// Native sample full-scale (13 bit signed)
+#define PACK_FLOAT_SCALE        (4096.0f)
+#define PACK_MAX_VAL            (4095.0f)
+#define PACK_MIN_VAL            (-4096.0f)
+
+static caribou_smi_unpack_engine_en pack_engine = caribou_smi_unpack_auto;
+static caribou_smi_pack_func pack_func = NULL;
+static caribou_smi_pack_cf32_func pack_func_cf32 = NULL;
+
+//=========================================================================
+// Saturates the same way as minps / maxps - the second operand is taken
+// when the comparison fails (NaN)
+static inline int16_t caribou_smi_pack_saturate(float v)
+{
+    v = (v < PACK_MAX_VAL) ? v : PACK_MAX_VAL;
+    v = (v > PACK_MIN_VAL) ? v : PACK_MIN_VAL;
+    return (int16_t)v;
+}
+
+//=========================================================================
+static void caribou_smi_pack_scalar_func(const caribou_smi_sample_complex_int16* samples,
+                                        size_t num_samples,
+                                        uint32_t* words)
+{
+    const uint8_t* src = (const uint8_t*)samples;
+    for (size_t i = 0; i < num_samples; i++)
+    {
+        uint32_t x;
+        memcpy(&x, src + i * sizeof(uint32_t), sizeof(uint32_t));
+        words[i] = PACK_WORD(x);
+    }
+}
+
+//=========================================================================
+static void caribou_smi_pack_scalar_cf32_func(const caribou_smi_sample_complex_float* samples,
+                                        size_t num_samples,
+                                        uint32_t* words)
+{
+    for (size_t i = 0; i < num_samples; i++)
+    {
+        uint16_t ii = (uint16_t)caribou_smi_pack_saturate(samples[i].i * PACK_FLOAT_SCALE);
+        uint16_t qq = (uint16_t)caribou_smi_pack_saturate(samples[i].q * PACK_FLOAT_SCALE);
+        uint32_t x = ii | ((uint32_t)qq << 16);
+        words[i] = PACK_WORD(x);
+    }
+}
+
+#if defined(CARIBOU_SMI_PACK_X86)
+//=========================================================================
+__attribute__((target("sse2")))
+static inline __m128i caribou_smi_pack_sse2_word(__m128i x)
+{
+    __m128i w = _mm_set1_epi32(PACK_CTRL_BITS);
+    w = _mm_or_si128(w, _mm_and_si128(_mm_srli_epi32(x, 8), _mm_set1_epi32(0x0000001F)));
+    w = _mm_or_si128(w, _mm_and_si128(_mm_slli_epi32(x, 7), _mm_set1_epi32(0x00007F00)));
+    w = _mm_or_si128(w, _mm_and_si128(_mm_slli_epi32(x, 22), _mm_set1_epi32(0x00400000)));
+    w = _mm_or_si128(w, _mm_and_si128(_mm_srli_epi32(x, 7), _mm_set1_epi32(0x003F0000)));
+    w = _mm_or_si128(w, _mm_and_si128(_mm_slli_epi32(x, 8), _mm_set1_epi32(0x7F000000)));
+    return w;
+}
+
+//=========================================================================
+__attribute__((target("avx2")))
+static inline __m256i caribou_smi_pack_avx2_word(__m256i x)
+{
+    __m256i w = _mm256_set1_epi32(PACK_CTRL_BITS);
+    w = _mm256_or_si256(w, _mm256_and_si256(_mm256_srli_epi32(x, 8), _mm256_set1_epi32(0x0000001F)));
+    w = _mm256_or_si256(w, _mm256_and_si256(_mm256_slli_epi32(x, 7), _mm256_set1_epi32(0x00007F00)));
+    w = _mm256_or_si256(w, _mm256_and_si256(_mm256_slli_epi32(x, 22), _mm256_set1_epi32(0x00400000)));
+    w = _mm256_or_si256(w, _mm256_and_si256(_mm256_srli_epi32(x, 7), _mm256_set1_epi32(0x003F0000)));
+    w = _mm256_or_si256(w, _mm256_and_si256(_mm256_slli_epi32(x, 8), _mm256_set1_epi32(0x7F000000)));
+    return w;
+}
+
+//=========================================================================
+__attribute__((target("sse2")))
+static void caribou_smi_pack_sse2_func(const caribou_smi_sample_complex_int16* samples,
+                                        size_t num_samples,
+                                        uint32_t* words)
+{
+    size_t i = 0;
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(samples + i));
+        _mm_storeu_si128((__m128i*)(words + i), caribou_smi_pack_sse2_word(x));
+    }
+
+    caribou_smi_pack_scalar_func(samples + i, num_samples - i, words + i);
+}
+
+//=========================================================================
+__attribute__((target("avx2")))
+static void caribou_smi_pack_avx2_func(const caribou_smi_sample_complex_int16* samples,
+                                        size_t num_samples,
+                                        uint32_t* words)
+{
+    size_t i = 0;
+    for (; i + 8 <= num_samples; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(samples + i));
+        _mm256_storeu_si256((__m256i*)(words + i), caribou_smi_pack_avx2_word(x));
+    }
+
+    caribou_smi_pack_sse2_func(samples + i, num_samples - i, words + i);
+}
+
+//=========================================================================
+__attribute__((target("sse2")))
+static void caribou_smi_pack_sse2_cf32_func(const caribou_smi_sample_complex_float* samples,
+                                        size_t num_samples,
+                                        uint32_t* words)
+{
+    const __m128 scale = _mm_set1_ps(PACK_FLOAT_SCALE);
+    const __m128 max_val = _mm_set1_ps(PACK_MAX_VAL);
+    const __m128 min_val = _mm_set1_ps(PACK_MIN_VAL);
+    const float* src = (const float*)samples;
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        // {i0, q0, i1, q1}, {i2, q2, i3, q3}
+        __m128 f0 = _mm_mul_ps(_mm_loadu_ps(src + 2 * i), scale);
+        __m128 f1 = _mm_mul_ps(_mm_loadu_ps(src + 2 * i + 4), scale);
+        f0 = _mm_max_ps(_mm_min_ps(f0, max_val), min_val);
+        f1 = _mm_max_ps(_mm_min_ps(f1, max_val), min_val);
+
+        // truncating conversion, then the int16 pairs already form the
+        // native {i, q} sample words
+        __m128i x = _mm_packs_epi32(_mm_cvttps_epi32(f0), _mm_cvttps_epi32(f1));
+        _mm_storeu_si128((__m128i*)(words + i), caribou_smi_pack_sse2_word(x));
+    }
+
+    caribou_smi_pack_scalar_cf32_func(samples + i, num_samples - i, words + i);
+}
+#endif // CARIBOU_SMI_PACK_X86
+
+#if defined(CARIBOU_SMI_PACK_NEON)
+//=========================================================================
+static inline uint32x4_t caribou_smi_pack_neon_word(uint32x4_t x)
+{
+    uint32x4_t w = vdupq_n_u32(PACK_CTRL_BITS);
+    w = vorrq_u32(w, vandq_u32(vshrq_n_u32(x, 8), vdupq_n_u32(0x0000001F)));
+    w = vorrq_u32(w, vandq_u32(vshlq_n_u32(x, 7), vdupq_n_u32(0x00007F00)));
+    w = vorrq_u32(w, vandq_u32(vshlq_n_u32(x, 22), vdupq_n_u32(0x00400000)));
+    w = vorrq_u32(w, vandq_u32(vshrq_n_u32(x, 7), vdupq_n_u32(0x003F0000)));
+    w = vorrq_u32(w, vandq_u32(vshlq_n_u32(x, 8), vdupq_n_u32(0x7F000000)));
+    return w;
+}
+
+//=========================================================================
+static void caribou_smi_pack_neon_func(const caribou_smi_sample_complex_int16* samples,
+                                        size_t num_samples,
+                                        uint32_t* words)
+{
+    const uint8_t* src = (const uint8_t*)samples;
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        // byte loads - the samples are not necessarily word aligned
+        uint32x4_t x = vreinterpretq_u32_u8(vld1q_u8(src + i * sizeof(uint32_t)));
+        vst1q_u32(words + i, caribou_smi_pack_neon_word(x));
+    }
+
+    caribou_smi_pack_scalar_func(samples + i, num_samples - i, words + i);
+}
+
+//=========================================================================
+static void caribou_smi_pack_neon_cf32_func(const caribou_smi_sample_complex_float* samples,
+                                        size_t num_samples,
+                                        uint32_t* words)
+{
+    const float32x4_t max_val = vdupq_n_f32(PACK_MAX_VAL);
+    const float32x4_t min_val = vdupq_n_f32(PACK_MIN_VAL);
+    const uint8_t* src = (const uint8_t*)samples;
+    size_t i = 0;
+
+    for (; i + 4 <= num_samples; i += 4)
+    {
+        float32x4_t f0 = vmulq_n_f32(vreinterpretq_f32_u8(vld1q_u8(src + i * 8)), PACK_FLOAT_SCALE);
+        float32x4_t f1 = vmulq_n_f32(vreinterpretq_f32_u8(vld1q_u8(src + i * 8 + 16)), PACK_FLOAT_SCALE);
+        // compare + select rather than vminq / vmaxq - those propagate NaNs
+        // while the other engines saturate them to the maximum
+        f0 = vbslq_f32(vcltq_f32(f0, max_val), f0, max_val);
+        f1 = vbslq_f32(vcltq_f32(f1, max_val), f1, max_val);
+        f0 = vbslq_f32(vcgtq_f32(f0, min_val), f0, min_val);
+        f1 = vbslq_f32(vcgtq_f32(f1, min_val), f1, min_val);
+
+        // truncating conversion, the narrowed {i, q} pairs are the native words
+        int16x8_t iq = vcombine_s16(vmovn_s32(vcvtq_s32_f32(f0)), vmovn_s32(vcvtq_s32_f32(f1)));
+        vst1q_u32(words + i, caribou_smi_pack_neon_word(vreinterpretq_u32_s16(iq)));
+    }
+
+    caribou_smi_pack_scalar_cf32_func(samples + i, num_samples - i, words + i);
+}
+#endif // CARIBOU_SMI_PACK_NEON
+
+//=========================================================================
+caribou_smi_pack_func caribou_smi_pack_get_func(caribou_smi_unpack_engine_en engine)
+{
+    if (!caribou_smi_unpack_engine_supported(engine))
+    {
+        return NULL;
+    }
+
+    switch (engine)
+    {
+        case caribou_smi_unpack_scalar: return caribou_smi_pack_scalar_func;
+#if defined(CARIBOU_SMI_PACK_X86)
+        case caribou_smi_unpack_sse2: return caribou_smi_pack_sse2_func;
+        case caribou_smi_unpack_avx2: return caribou_smi_pack_avx2_func;
+#endif
+#if defined(CARIBOU_SMI_PACK_NEON)
+        case caribou_smi_unpack_neon: return caribou_smi_pack_neon_func;
+#endif
+        default: return NULL;
+    }
+}
+
+//=========================================================================
+caribou_smi_pack_cf32_func caribou_smi_pack_get_func_cf32(caribou_smi_unpack_engine_en engine)
+{
+    if (!caribou_smi_unpack_engine_supported(engine))
+    {
+        return NULL;
+    }
+
+    switch (engine)
+    {
+        case caribou_smi_unpack_scalar: return caribou_smi_pack_scalar_cf32_func;
+#if defined(CARIBOU_SMI_PACK_X86)
+        // the conversion dominates - the sse2 variant is used for avx2 as well
+        case caribou_smi_unpack_sse2:
+        case caribou_smi_unpack_avx2: return caribou_smi_pack_sse2_cf32_func;
+#endif
+#if defined(CARIBOU_SMI_PACK_NEON)
+        case caribou_smi_unpack_neon: return caribou_smi_pack_neon_cf32_func;
+#endif
+        default: return NULL;
+    }
+}
+
+//=========================================================================
+caribou_smi_unpack_engine_en caribou_smi_pack_select(caribou_smi_unpack_engine_en engine)
+{
+    if (engine == caribou_smi_unpack_auto || !caribou_smi_unpack_engine_supported(engine))
+    {
+        if (engine != caribou_smi_unpack_auto)
+        {
+            ZF_LOGW("smi pack engine '%s' is not supported, using the best available",
+                    caribou_smi_unpack_engine_name(engine));
+        }
+
+        // the same preference as the unpacking engines
+        engine = caribou_smi_unpack_get_engine();
+    }
+
+    pack_func = caribou_smi_pack_get_func(engine);
+    pack_func_cf32 = caribou_smi_pack_get_func_cf32(engine);
+    pack_engine = engine;
+    ZF_LOGD("smi pack engine: %s", caribou_smi_unpack_engine_name(engine));
+    return engine;
+}
+
+//=========================================================================
+caribou_smi_unpack_engine_en caribou_smi_pack_get_engine(void)
+{
+    if (pack_func == NULL) caribou_smi_pack_select(caribou_smi_unpack_auto);
+    return pack_engine;
+}
+
+//=========================================================================
+void caribou_smi_pack(const caribou_smi_sample_complex_int16* samples, size_t num_samples, uint32_t* words)
+{
+    if (pack_func == NULL) caribou_smi_pack_select(caribou_smi_unpack_auto);
+    pack_func(samples, num_samples, words);
+}
+
+//=========================================================================
+void caribou_smi_pack_cf32(const caribou_smi_sample_complex_float* samples, size_t num_samples, uint32_t* words)
+{
+    if (pack_func_cf32 == NULL) caribou_smi_pack_select(caribou_smi_unpack_auto);
+    pack_func_cf32(samples, num_samples, words);
+}
+
+//=========================================================================
+void caribou_smi_pack_cf64(const caribou_smi_sample_complex_double* samples, size_t num_samples, uint32_t* words)
+{
+    // double precision is rarely used on the target - a plain loop that the
+    // compiler is free to auto-vectorize
+    for (size_t i = 0; i < num_samples; i++)
+    {
+        uint16_t ii = (uint16_t)caribou_smi_pack_saturate((float)(samples[i].i * 4096.0));
+        uint16_t qq = (uint16_t)caribou_smi_pack_saturate((float)(samples[i].q * 4096.0));
+        uint32_t x = ii | ((uint32_t)qq << 16);
+        words[i] = PACK_WORD(x);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef __CARIBOU_SMI_PACK_H__
+#define __CARIBOU_SMI_PACK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "caribou_smi.h"
+#include "caribou_smi_unpack.h"
+
+// SMI TX word packing engines (the engines are shared with caribou_smi_unpack.h)
+// Data Structure (per 32bit word, as written to the SMI - byte swapped):
+//  byte 0: [7:5] '111' (SOF, modem tx ctrl, cond. tx ctrl)   [4:0] I[12:8]
+//  byte 1: [7] '0'     [6:0] I[7:1]
+//  byte 2: [7] '0'     [6] I[0]    [5:0] Q[12:7]
+//  byte 3: [7] '0'     [6:0] Q[6:0]
+// Only the low 13 bits of each int16 field are sent.
+
+typedef void (*caribou_smi_pack_func)(const caribou_smi_sample_complex_int16* samples,
+                                        size_t num_samples,
+                                        uint32_t* words);
+
+// Fused scaling (sample * 4096.0, truncated and saturated to the 13 bit
+// range [-4096, 4095]) and packing of interleaved float I/Q
+typedef void (*caribou_smi_pack_cf32_func)(const caribou_smi_sample_complex_float* samples,
+                                        size_t num_samples,
+                                        uint32_t* words);
+
+// Select the engine used by 'caribou_smi_pack' / 'caribou_smi_pack_cf32'. Returns
+// the engine actually selected (the best available one if not supported).
+caribou_smi_unpack_engine_en caribou_smi_pack_select(caribou_smi_unpack_engine_en engine);
+caribou_smi_unpack_engine_en caribou_smi_pack_get_engine(void);
+caribou_smi_pack_func caribou_smi_pack_get_func(caribou_smi_unpack_engine_en engine);
+caribou_smi_pack_cf32_func caribou_smi_pack_get_func_cf32(caribou_smi_unpack_engine_en engine);
+
+// Pack 'num_samples' int16 I/Q pairs into TX words
+void caribou_smi_pack(const caribou_smi_sample_complex_int16* samples, size_t num_samples, uint32_t* words);
+
+// Pack straight from the scaled floating point formats (single pass, no
+// intermediate int16 buffer), saturating out of range samples
+void caribou_smi_pack_cf32(const caribou_smi_sample_complex_float* samples, size_t num_samples, uint32_t* words);
+void caribou_smi_pack_cf64(const caribou_smi_sample_complex_double* samples, size_t num_samples, uint32_t* words);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CARIBOU_SMI_PACK_H__
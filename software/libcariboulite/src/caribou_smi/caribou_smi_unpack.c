@@ -0,0 +1,677 @@
+#ifndef ZF_LOG_LEVEL
+    #define ZF_LOG_LEVEL ZF_LOG_VERBOSE
+#endif
+#define ZF_LOG_DEF_SRCLOC ZF_LOG_SRCLOC_LONG
+#define ZF_LOG_TAG "CARIBOU_SMI_UNPACK"
+#include "zf_log/zf_log.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define CARIBOU_SMI_UNPACK_X86      1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+    #include <arm_neon.h>
+    #define CARIBOU_SMI_UNPACK_NEON     1
+#endif
+
+#include "caribou_smi_unpack.h"
+
+// Field extraction - the two 13 bit fields are moved to the top of the word
+// and arithmetically shifted back, which sign-extends them in one step
+//      high field [29:17]  =>  (s << 2) >> 19
+//      low field  [13:1]   =>  (s << 18) >> 19
+#define UNPACK_HIGH_FIELD(s)    ((int16_t)(((int32_t)((uint32_t)(s) << 2)) >> 19))
+#define UNPACK_LOW_FIELD(s)     ((int16_t)(((int32_t)((uint32_t)(s) << 18)) >> 19))
+
+// Native sample full-scale (13 bit signed) - a power of two, so the float
+// multiplication is exactly equivalent to dividing by 4096.0
+#define UNPACK_FLOAT_SCALE      (1.0f / 4096.0f)
+
+static caribou_smi_unpack_engine_en unpack_engine = caribou_smi_unpack_auto;
+static caribou_smi_unpack_func unpack_func = NULL;
+static caribou_smi_unpack_cf32_func unpack_func_cf32 = NULL;
+
+//=========================================================================
+static void caribou_smi_unpack_scalar_func(const uint32_t* words, size_t num_words,
+                                        caribou_smi_sample_complex_int16* samples,
+                                        caribou_smi_sample_meta* meta,
+                                        bool swap_iq)
+{
+    const uint8_t* src = (const uint8_t*)words;
+    for (size_t i = 0; i < num_words; i++)
+    {
+        uint32_t s;
+        memcpy(&s, src + i * sizeof(uint32_t), sizeof(uint32_t));
+
+        if (meta) meta[i].sync = s & 0x00000001;
+        if (samples)
+        {
+            int16_t hi = UNPACK_HIGH_FIELD(s);
+            int16_t lo = UNPACK_LOW_FIELD(s);
+            samples[i].i = swap_iq ? lo : hi;
+            samples[i].q = swap_iq ? hi : lo;
+        }
+    }
+}
+
+//=========================================================================
+static void caribou_smi_unpack_scalar_cf32_func(const uint32_t* words, size_t num_words,
+                                        caribou_smi_sample_complex_float* samples,
+                                        caribou_smi_sample_meta* meta,
+                                        bool swap_iq)
+{
+    const uint8_t* src = (const uint8_t*)words;
+    for (size_t i = 0; i < num_words; i++)
+    {
+        uint32_t s;
+        memcpy(&s, src + i * sizeof(uint32_t), sizeof(uint32_t));
+
+        if (meta) meta[i].sync = s & 0x00000001;
+        if (samples)
+        {
+            float hi = (float)UNPACK_HIGH_FIELD(s) * UNPACK_FLOAT_SCALE;
+            float lo = (float)UNPACK_LOW_FIELD(s) * UNPACK_FLOAT_SCALE;
+            samples[i].i = swap_iq ? lo : hi;
+            samples[i].q = swap_iq ? hi : lo;
+        }
+    }
+}
+
+#if defined(CARIBOU_SMI_UNPACK_X86)
+//=========================================================================
+__attribute__((target("sse2")))
+static inline void caribou_smi_unpack_sse2_sync(caribou_smi_sample_meta* meta, __m128i s)
+{
+    __m128i sync = _mm_and_si128(s, _mm_set1_epi32(0x00000001));
+    sync = _mm_packs_epi32(sync, sync);
+    sync = _mm_packus_epi16(sync, sync);
+    int32_t sync4 = _mm_cvtsi128_si32(sync);
+    memcpy(meta, &sync4, sizeof(sync4));
+}
+
+//=========================================================================
+__attribute__((target("avx2")))
+static inline void caribou_smi_unpack_avx2_sync(caribou_smi_sample_meta* meta, __m256i s)
+{
+    // packing is done per 128 bit lane - four sync bytes end up at
+    // the bottom of each lane
+    __m256i sync = _mm256_and_si256(s, _mm256_set1_epi32(0x00000001));
+    sync = _mm256_packs_epi32(sync, sync);
+    sync = _mm256_packus_epi16(sync, sync);
+    int32_t sync_lo = _mm256_extract_epi32(sync, 0);
+    int32_t sync_hi = _mm256_extract_epi32(sync, 4);
+    memcpy(meta, &sync_lo, sizeof(sync_lo));
+    memcpy(meta + 4, &sync_hi, sizeof(sync_hi));
+}
+
+//=========================================================================
+__attribute__((target("sse2")))
+static void caribou_smi_unpack_sse2_func(const uint32_t* words, size_t num_words,
+                                        caribou_smi_sample_complex_int16* samples,
+                                        caribou_smi_sample_meta* meta,
+                                        bool swap_iq)
+{
+    const __m128i mask_low = _mm_set1_epi32(0x0000FFFF);
+    size_t i = 0;
+
+    for (; i + 4 <= num_words; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(words + i));
+
+        if (samples)
+        {
+            __m128i hi = _mm_srai_epi32(_mm_slli_epi32(s, 2), 19);
+            __m128i lo = _mm_srai_epi32(_mm_slli_epi32(s, 18), 19);
+            __m128i i_vec = swap_iq ? lo : hi;
+            __m128i q_vec = swap_iq ? hi : lo;
+
+            // each 32 bit lane becomes {i (LSB), q (MSB)}
+            __m128i iq = _mm_or_si128(_mm_and_si128(i_vec, mask_low), _mm_slli_epi32(q_vec, 16));
+            _mm_storeu_si128((__m128i*)(samples + i), iq);
+        }
+
+        if (meta) caribou_smi_unpack_sse2_sync(meta + i, s);
+    }
+
+    caribou_smi_unpack_scalar_func(words + i, num_words - i,
+                                   samples ? samples + i : NULL,
+                                   meta ? meta + i : NULL,
+                                   swap_iq);
+}
+
+//=========================================================================
+__attribute__((target("avx2")))
+static void caribou_smi_unpack_avx2_func(const uint32_t* words, size_t num_words,
+                                        caribou_smi_sample_complex_int16* samples,
+                                        caribou_smi_sample_meta* meta,
+                                        bool swap_iq)
+{
+    const __m256i mask_low = _mm256_set1_epi32(0x0000FFFF);
+    size_t i = 0;
+
+    for (; i + 8 <= num_words; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(words + i));
+
+        if (samples)
+        {
+            __m256i hi = _mm256_srai_epi32(_mm256_slli_epi32(s, 2), 19);
+            __m256i lo = _mm256_srai_epi32(_mm256_slli_epi32(s, 18), 19);
+            __m256i i_vec = swap_iq ? lo : hi;
+            __m256i q_vec = swap_iq ? hi : lo;
+
+            __m256i iq = _mm256_or_si256(_mm256_and_si256(i_vec, mask_low), _mm256_slli_epi32(q_vec, 16));
+            _mm256_storeu_si256((__m256i*)(samples + i), iq);
+        }
+
+        if (meta) caribou_smi_unpack_avx2_sync(meta + i, s);
+    }
+
+    caribou_smi_unpack_sse2_func(words + i, num_words - i,
+                                 samples ? samples + i : NULL,
+                                 meta ? meta + i : NULL,
+                                 swap_iq);
+}
+
+//=========================================================================
+__attribute__((target("sse2")))
+static void caribou_smi_unpack_sse2_cf32_func(const uint32_t* words, size_t num_words,
+                                        caribou_smi_sample_complex_float* samples,
+                                        caribou_smi_sample_meta* meta,
+                                        bool swap_iq)
+{
+    const __m128 scale = _mm_set1_ps(UNPACK_FLOAT_SCALE);
+    size_t i = 0;
+
+    for (; i + 4 <= num_words; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(words + i));
+
+        if (samples)
+        {
+            __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(s, 2), 19)), scale);
+            __m128 lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(s, 18), 19)), scale);
+            __m128 i_vec = swap_iq ? lo : hi;
+            __m128 q_vec = swap_iq ? hi : lo;
+
+            // {i0, q0, i1, q1}, {i2, q2, i3, q3}
+            _mm_storeu_ps((float*)(samples + i), _mm_unpacklo_ps(i_vec, q_vec));
+            _mm_storeu_ps((float*)(samples + i + 2), _mm_unpackhi_ps(i_vec, q_vec));
+        }
+
+        if (meta) caribou_smi_unpack_sse2_sync(meta + i, s);
+    }
+
+    caribou_smi_unpack_scalar_cf32_func(words + i, num_words - i,
+                                   samples ? samples + i : NULL,
+                                   meta ? meta + i : NULL,
+                                   swap_iq);
+}
+
+//=========================================================================
+__attribute__((target("avx2")))
+static void caribou_smi_unpack_avx2_cf32_func(const uint32_t* words, size_t num_words,
+                                        caribou_smi_sample_complex_float* samples,
+                                        caribou_smi_sample_meta* meta,
+                                        bool swap_iq)
+{
+    const __m256 scale = _mm256_set1_ps(UNPACK_FLOAT_SCALE);
+    size_t i = 0;
+
+    for (; i + 8 <= num_words; i += 8)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(words + i));
+
+        if (samples)
+        {
+            __m256 hi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(s, 2), 19)), scale);
+            __m256 lo = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(s, 18), 19)), scale);
+            __m256 i_vec = swap_iq ? lo : hi;
+            __m256 q_vec = swap_iq ? hi : lo;
+
+            // the unpacks are in-lane: {0,1 | 4,5} and {2,3 | 6,7}
+            __m256 iq_a = _mm256_unpacklo_ps(i_vec, q_vec);
+            __m256 iq_b = _mm256_unpackhi_ps(i_vec, q_vec);
+            _mm256_storeu_ps((float*)(samples + i), _mm256_permute2f128_ps(iq_a, iq_b, 0x20));
+            _mm256_storeu_ps((float*)(samples + i + 4), _mm256_permute2f128_ps(iq_a, iq_b, 0x31));
+        }
+
+        if (meta) caribou_smi_unpack_avx2_sync(meta + i, s);
+    }
+
+    caribou_smi_unpack_sse2_cf32_func(words + i, num_words - i,
+                                 samples ? samples + i : NULL,
+                                 meta ? meta + i : NULL,
+                                 swap_iq);
+}
+#endif // CARIBOU_SMI_UNPACK_X86
+
+#if defined(CARIBOU_SMI_UNPACK_NEON)
+//=========================================================================
+static void caribou_smi_unpack_neon_func(const uint32_t* words, size_t num_words,
+                                        caribou_smi_sample_complex_int16* samples,
+                                        caribou_smi_sample_meta* meta,
+                                        bool swap_iq)
+{
+    const uint8_t* src = (const uint8_t*)words;
+    const uint32x4_t sync_mask = vdupq_n_u32(0x00000001);
+    size_t i = 0;
+
+    for (; i + 8 <= num_words; i += 8)
+    {
+        // byte loads - the source buffer is not necessarily word aligned
+        uint32x4_t s0 = vreinterpretq_u32_u8(vld1q_u8(src + i * sizeof(uint32_t)));
+        uint32x4_t s1 = vreinterpretq_u32_u8(vld1q_u8(src + i * sizeof(uint32_t) + 16));
+
+        if (samples)
+        {
+            int16x8_t hi = vcombine_s16(vmovn_s32(vshrq_n_s32(vreinterpretq_s32_u32(vshlq_n_u32(s0, 2)), 19)),
+                                        vmovn_s32(vshrq_n_s32(vreinterpretq_s32_u32(vshlq_n_u32(s1, 2)), 19)));
+            int16x8_t lo = vcombine_s16(vmovn_s32(vshrq_n_s32(vreinterpretq_s32_u32(vshlq_n_u32(s0, 18)), 19)),
+                                        vmovn_s32(vshrq_n_s32(vreinterpretq_s32_u32(vshlq_n_u32(s1, 18)), 19)));
+
+            // interleaving store {i, q, i, q, ...}
+            int16x8x2_t iq;
+            iq.val[0] = swap_iq ? lo : hi;
+            iq.val[1] = swap_iq ? hi : lo;
+            vst2q_s16((int16_t*)(samples + i), iq);
+        }
+
+        if (meta)
+        {
+            uint16x8_t sync = vcombine_u16(vmovn_u32(vandq_u32(s0, sync_mask)),
+                                           vmovn_u32(vandq_u32(s1, sync_mask)));
+            vst1_u8((uint8_t*)(meta + i), vmovn_u16(sync));
+        }
+    }
+
+    caribou_smi_unpack_scalar_func((const uint32_t*)(src + i * sizeof(uint32_t)), num_words - i,
+                                   samples ? samples + i : NULL,
+                                   meta ? meta + i : NULL,
+                                   swap_iq);
+}
+
+//=========================================================================
+static void caribou_smi_unpack_neon_cf32_func(const uint32_t* words, size_t num_words,
+                                        caribou_smi_sample_complex_float* samples,
+                                        caribou_smi_sample_meta* meta,
+                                        bool swap_iq)
+{
+    const uint8_t* src = (const uint8_t*)words;
+    const uint32x4_t sync_mask = vdupq_n_u32(0x00000001);
+    size_t i = 0;
+
+    for (; i + 8 <= num_words; i += 8)
+    {
+        uint32x4_t s0 = vreinterpretq_u32_u8(vld1q_u8(src + i * sizeof(uint32_t)));
+        uint32x4_t s1 = vreinterpretq_u32_u8(vld1q_u8(src + i * sizeof(uint32_t) + 16));
+
+        if (samples)
+        {
+            float32x4_t hi0 = vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(vreinterpretq_s32_u32(vshlq_n_u32(s0, 2)), 19)), UNPACK_FLOAT_SCALE);
+            float32x4_t lo0 = vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(vreinterpretq_s32_u32(vshlq_n_u32(s0, 18)), 19)), UNPACK_FLOAT_SCALE);
+            float32x4_t hi1 = vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(vreinterpretq_s32_u32(vshlq_n_u32(s1, 2)), 19)), UNPACK_FLOAT_SCALE);
+            float32x4_t lo1 = vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(vreinterpretq_s32_u32(vshlq_n_u32(s1, 18)), 19)), UNPACK_FLOAT_SCALE);
+
+            float32x4x2_t iq0, iq1;
+            iq0.val[0] = swap_iq ? lo0 : hi0;
+            iq0.val[1] = swap_iq ? hi0 : lo0;
+            iq1.val[0] = swap_iq ? lo1 : hi1;
+            iq1.val[1] = swap_iq ? hi1 : lo1;
+            vst2q_f32((float*)(samples + i), iq0);
+            vst2q_f32((float*)(samples + i + 4), iq1);
+        }
+
+        if (meta)
+        {
+            uint16x8_t sync = vcombine_u16(vmovn_u32(vandq_u32(s0, sync_mask)),
+                                           vmovn_u32(vandq_u32(s1, sync_mask)));
+            vst1_u8((uint8_t*)(meta + i), vmovn_u16(sync));
+        }
+    }
+
+    caribou_smi_unpack_scalar_cf32_func((const uint32_t*)(src + i * sizeof(uint32_t)), num_words - i,
+                                   samples ? samples + i : NULL,
+                                   meta ? meta + i : NULL,
+                                   swap_iq);
+}
+#endif // CARIBOU_SMI_UNPACK_NEON
+
+//=========================================================================
+bool caribou_smi_unpack_engine_supported(caribou_smi_unpack_engine_en engine)
+{
+    switch (engine)
+    {
+        case caribou_smi_unpack_auto:
+        case caribou_smi_unpack_scalar:
+            return true;
+
+#if defined(CARIBOU_SMI_UNPACK_X86)
+        case caribou_smi_unpack_sse2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+
+        case caribou_smi_unpack_avx2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+
+#if defined(CARIBOU_SMI_UNPACK_NEON)
+        case caribou_smi_unpack_neon:
+            return true;
+#endif
+
+        default:
+            return false;
+    }
+}
+
+//=========================================================================
+const char* caribou_smi_unpack_engine_name(caribou_smi_unpack_engine_en engine)
+{
+    switch (engine)
+    {
+        case caribou_smi_unpack_auto: return "auto";
+        case caribou_smi_unpack_scalar: return "scalar";
+        case caribou_smi_unpack_sse2: return "sse2";
+        case caribou_smi_unpack_avx2: return "avx2";
+        case caribou_smi_unpack_neon: return "neon";
+        default: return "unknown";
+    }
+}
+
+//=========================================================================
+caribou_smi_unpack_func caribou_smi_unpack_get_func(caribou_smi_unpack_engine_en engine)
+{
+    if (!caribou_smi_unpack_engine_supported(engine))
+    {
+        return NULL;
+    }
+
+    switch (engine)
+    {
+        case caribou_smi_unpack_scalar: return caribou_smi_unpack_scalar_func;
+#if defined(CARIBOU_SMI_UNPACK_X86)
+        case caribou_smi_unpack_sse2: return caribou_smi_unpack_sse2_func;
+        case caribou_smi_unpack_avx2: return caribou_smi_unpack_avx2_func;
+#endif
+#if defined(CARIBOU_SMI_UNPACK_NEON)
+        case caribou_smi_unpack_neon: return caribou_smi_unpack_neon_func;
+#endif
+        default: return NULL;
+    }
+}
+
+//=========================================================================
+caribou_smi_unpack_cf32_func caribou_smi_unpack_get_func_cf32(caribou_smi_unpack_engine_en engine)
+{
+    if (!caribou_smi_unpack_engine_supported(engine))
+    {
+        return NULL;
+    }
+
+    switch (engine)
+    {
+        case caribou_smi_unpack_scalar: return caribou_smi_unpack_scalar_cf32_func;
+#if defined(CARIBOU_SMI_UNPACK_X86)
+        case caribou_smi_unpack_sse2: return caribou_smi_unpack_sse2_cf32_func;
+        case caribou_smi_unpack_avx2: return caribou_smi_unpack_avx2_cf32_func;
+#endif
+#if defined(CARIBOU_SMI_UNPACK_NEON)
+        case caribou_smi_unpack_neon: return caribou_smi_unpack_neon_cf32_func;
+#endif
+        default: return NULL;
+    }
+}
+
+//=========================================================================
+static caribou_smi_unpack_engine_en caribou_smi_unpack_best_engine(void)
+{
+    const caribou_smi_unpack_engine_en preference[] = {
+        caribou_smi_unpack_neon,
+        caribou_smi_unpack_avx2,
+        caribou_smi_unpack_sse2,
+    };
+
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++)
+    {
+        if (caribou_smi_unpack_engine_supported(preference[i])) return preference[i];
+    }
+    return caribou_smi_unpack_scalar;
+}
+
+//=========================================================================
+caribou_smi_unpack_engine_en caribou_smi_unpack_select(caribou_smi_unpack_engine_en engine)
+{
+    if (engine == caribou_smi_unpack_auto || !caribou_smi_unpack_engine_supported(engine))
+    {
+        if (engine != caribou_smi_unpack_auto)
+        {
+            ZF_LOGW("smi unpack engine '%s' is not supported, using the best available",
+                    caribou_smi_unpack_engine_name(engine));
+        }
+        engine = caribou_smi_unpack_best_engine();
+    }
+
+    unpack_func = caribou_smi_unpack_get_func(engine);
+    unpack_func_cf32 = caribou_smi_unpack_get_func_cf32(engine);
+    unpack_engine = engine;
+    ZF_LOGD("smi unpack engine: %s", caribou_smi_unpack_engine_name(engine));
+    return engine;
+}
+
+//=========================================================================
+caribou_smi_unpack_engine_en caribou_smi_unpack_get_engine(void)
+{
+    if (unpack_func == NULL) caribou_smi_unpack_select(caribou_smi_unpack_auto);
+    return unpack_engine;
+}
+
+//=========================================================================
+void caribou_smi_unpack(const uint32_t* words, size_t num_words,
+                        caribou_smi_sample_complex_int16* samples,
+                        caribou_smi_sample_meta* meta,
+                        caribou_smi_channel_en channel)
+{
+    if (unpack_func == NULL) caribou_smi_unpack_select(caribou_smi_unpack_auto);
+    unpack_func(words, num_words, samples, meta, channel == caribou_smi_channel_2400);
+}
+
+//=========================================================================
+void caribou_smi_unpack_cf32(const uint32_t* words, size_t num_words,
+                        caribou_smi_sample_complex_float* samples,
+                        caribou_smi_sample_meta* meta,
+                        caribou_smi_channel_en channel)
+{
+    if (unpack_func_cf32 == NULL) caribou_smi_unpack_select(caribou_smi_unpack_auto);
+    unpack_func_cf32(words, num_words, samples, meta, channel == caribou_smi_channel_2400);
+}
+
+//=========================================================================
+void caribou_smi_unpack_cf64(const uint32_t* words, size_t num_words,
+                        caribou_smi_sample_complex_double* samples,
+                        caribou_smi_sample_meta* meta,
+                        caribou_smi_channel_en channel)
+{
+    // double precision is rarely used on the target - a plain loop that the
+    // compiler is free to auto-vectorize
+    const uint8_t* src = (const uint8_t*)words;
+    bool swap_iq = (channel == caribou_smi_channel_2400);
+    for (size_t i = 0; i < num_words; i++)
+    {
+        uint32_t s;
+        memcpy(&s, src + i * sizeof(uint32_t), sizeof(uint32_t));
+
+        if (meta) meta[i].sync = s & 0x00000001;
+        if (samples)
+        {
+            double hi = (double)UNPACK_HIGH_FIELD(s) / 4096.0;
+            double lo = (double)UNPACK_LOW_FIELD(s) / 4096.0;
+            samples[i].i = swap_iq ? lo : hi;
+            samples[i].q = swap_iq ? hi : lo;
+        }
+    }
+}
+
+//=========================================================================
+static size_t caribou_smi_count_valid_scalar(const uint8_t* src, size_t num_words, uint32_t marker_mask)
+{
+    for (size_t i = 0; i < num_words; i++)
+    {
+        uint32_t s;
+        memcpy(&s, src + i * sizeof(uint32_t), sizeof(uint32_t));
+        if ((s & marker_mask) != CARIBOU_SMI_WORD_MARKER) return i;
+    }
+    return num_words;
+}
+
+#if defined(CARIBOU_SMI_UNPACK_X86)
+//=========================================================================
+__attribute__((target("sse2")))
+static size_t caribou_smi_count_valid_sse2(const uint8_t* src, size_t num_words, uint32_t marker_mask)
+{
+    const __m128i mask = _mm_set1_epi32(marker_mask);
+    const __m128i marker = _mm_set1_epi32(CARIBOU_SMI_WORD_MARKER);
+    size_t i = 0;
+
+    for (; i + 4 <= num_words; i += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i * sizeof(uint32_t)));
+        __m128i eq = _mm_cmpeq_epi32(_mm_and_si128(s, mask), marker);
+        int valid = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        if (valid != 0xF) return i + __builtin_ctz(~valid);
+    }
+    return i + caribou_smi_count_valid_scalar(src + i * sizeof(uint32_t), num_words - i, marker_mask);
+}
+#endif // CARIBOU_SMI_UNPACK_X86
+
+#if defined(CARIBOU_SMI_UNPACK_NEON)
+//=========================================================================
+static size_t caribou_smi_count_valid_neon(const uint8_t* src, size_t num_words, uint32_t marker_mask)
+{
+    const uint32x4_t mask = vdupq_n_u32(marker_mask);
+    const uint32x4_t marker = vdupq_n_u32(CARIBOU_SMI_WORD_MARKER);
+    size_t i = 0;
+
+    for (; i + 4 <= num_words; i += 4)
+    {
+        uint32x4_t s = vreinterpretq_u32_u8(vld1q_u8(src + i * sizeof(uint32_t)));
+        uint16x4_t eq = vmovn_u32(vceqq_u32(vandq_u32(s, mask), marker));
+        if (vget_lane_u64(vreinterpret_u64_u16(eq), 0) != 0xFFFFFFFFFFFFFFFFULL)
+        {
+            return i + caribou_smi_count_valid_scalar(src + i * sizeof(uint32_t), 4, marker_mask);
+        }
+    }
+    return i + caribou_smi_count_valid_scalar(src + i * sizeof(uint32_t), num_words - i, marker_mask);
+}
+#endif // CARIBOU_SMI_UNPACK_NEON
+
+//=========================================================================
+size_t caribou_smi_unpack_count_valid_mask(const uint32_t* words, size_t num_words, uint32_t marker_mask)
+{
+    const uint8_t* src = (const uint8_t*)words;
+    caribou_smi_unpack_engine_en engine = caribou_smi_unpack_get_engine();
+
+#if defined(CARIBOU_SMI_UNPACK_NEON)
+    if (engine == caribou_smi_unpack_neon) return caribou_smi_count_valid_neon(src, num_words, marker_mask);
+#endif
+#if defined(CARIBOU_SMI_UNPACK_X86)
+    if (engine == caribou_smi_unpack_sse2 || engine == caribou_smi_unpack_avx2) return caribou_smi_count_valid_sse2(src, num_words, marker_mask);
+#endif
+    return caribou_smi_count_valid_scalar(src, num_words, marker_mask);
+}
+
+//=========================================================================
+size_t caribou_smi_unpack_count_valid(const uint32_t* words, size_t num_words)
+{
+    return caribou_smi_unpack_count_valid_mask(words, num_words, CARIBOU_SMI_WORD_MARKER_MASK);
+}
+
+//=========================================================================
+int caribou_smi_unpack_find_sync(const uint8_t* buffer, size_t len, size_t min_words)
+{
+    return caribou_smi_unpack_find_sync_mask(buffer, len, min_words, CARIBOU_SMI_WORD_MARKER_MASK);
+}
+
+//=========================================================================
+int caribou_smi_unpack_find_sync_mask(const uint8_t* buffer, size_t len, size_t min_words, uint32_t marker_mask)
+{
+    int best = -1;
+
+    // each of the four byte phases is scanned word-wise (vectorized) and the
+    // earliest match wins - equivalent to a byte-by-byte search
+    for (size_t phase = 0; phase < sizeof(uint32_t) && phase < len; phase++)
+    {
+        const uint8_t* src = buffer + phase;
+        size_t num_words = (len - phase) / sizeof(uint32_t);
+        size_t i = 0;
+
+        while (i + min_words <= num_words)
+        {
+            if (best >= 0 && (int)(phase + i * sizeof(uint32_t)) >= best) break;
+
+            size_t valid = caribou_smi_unpack_count_valid_mask((const uint32_t*)(src + i * sizeof(uint32_t)), num_words - i, marker_mask);
+            if (valid >= min_words)
+            {
+                best = (int)(phase + i * sizeof(uint32_t));
+                break;
+            }
+            i += valid + 1;
+        }
+    }
+    return best;
+}
+
+//=========================================================================
+void caribou_smi_unpack_dual(const uint32_t* words, size_t num_words,
+                        caribou_smi_sample_format_en format,
+                        void* samples[2],
+                        caribou_smi_sample_meta* meta[2],
+                        size_t counts[2])
+{
+    // each word is routed by its channel bit - the output index is looked up
+    // instead of branching, the words of the two channels are interleaved
+    // irregularly. The HiF (2400) channel has I and Q swapped.
+    const uint8_t* src = (const uint8_t*)words;
+    size_t n[2] = {counts[0], counts[1]};
+
+    for (size_t i = 0; i < num_words; i++)
+    {
+        uint32_t s;
+        memcpy(&s, src + i * sizeof(uint32_t), sizeof(uint32_t));
+        unsigned ch = CARIBOU_SMI_WORD_CHANNEL(s);
+        int16_t hi = UNPACK_HIGH_FIELD(s);
+        int16_t lo = UNPACK_LOW_FIELD(s);
+        int16_t si = ch ? lo : hi;
+        int16_t sq = ch ? hi : lo;
+        size_t k = n[ch]++;
+
+        if (meta[ch]) meta[ch][k].sync = s & 0x00000001;
+        if (samples[ch] == NULL) continue;
+
+        switch (format)
+        {
+            case caribou_smi_sample_format_cf32:
+                ((caribou_smi_sample_complex_float*)samples[ch])[k].i = (float)si * UNPACK_FLOAT_SCALE;
+                ((caribou_smi_sample_complex_float*)samples[ch])[k].q = (float)sq * UNPACK_FLOAT_SCALE;
+                break;
+            case caribou_smi_sample_format_cf64:
+                ((caribou_smi_sample_complex_double*)samples[ch])[k].i = (double)si / 4096.0;
+                ((caribou_smi_sample_complex_double*)samples[ch])[k].q = (double)sq / 4096.0;
+                break;
+            case caribou_smi_sample_format_ci16:
+            default:
+                ((caribou_smi_sample_complex_int16*)samples[ch])[k].i = si;
+                ((caribou_smi_sample_complex_int16*)samples[ch])[k].q = sq;
+                break;
+        }
+    }
+
+    counts[0] = n[0];
+    counts[1] = n[1];
+}
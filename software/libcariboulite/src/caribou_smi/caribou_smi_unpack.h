@@ -0,0 +1,103 @@
+#ifndef __CARIBOU_SMI_UNPACK_H__
+#define __CARIBOU_SMI_UNPACK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "caribou_smi.h"
+
+// Valid RX words carry fixed marker bits: [31:30] = '10', [16] = '0', [15:14] = '01'
+#define CARIBOU_SMI_WORD_MARKER_MASK    (0xC001C000)
+#define CARIBOU_SMI_WORD_MARKER         (0x80004000)
+#define CARIBOU_SMI_WORD_VALID(s)       (((s) & CARIBOU_SMI_WORD_MARKER_MASK) == CARIBOU_SMI_WORD_MARKER)
+
+// In the dual rx stream (smi_stream_rx_dual) bit [16] carries the source channel
+// ('0' = 900MHz, '1' = 2400MHz) and is not part of the marker
+#define CARIBOU_SMI_WORD_DUAL_MARKER_MASK   (0xC000C000)
+#define CARIBOU_SMI_WORD_CHANNEL(s)         (((s) >> 16) & 0x1)
+
+// SMI RX word unpacking engines
+// Data Structure (per 32bit little-endian word):
+//  [31:30] [   29:17   ]   [ 16  ]     [ 15:14 ]   [   13:1    ]   [   0   ]
+//  [ '10'] [ I sample  ]   [ '0' ]     [  '01' ]   [  Q sample ]   [  'S'  ]
+// On the HiF (2400) channel the I and Q fields are swapped.
+typedef enum
+{
+	caribou_smi_unpack_auto = 0,        // best engine available on the running CPU
+	caribou_smi_unpack_scalar = 1,
+	caribou_smi_unpack_sse2 = 2,
+	caribou_smi_unpack_avx2 = 3,
+	caribou_smi_unpack_neon = 4,
+} caribou_smi_unpack_engine_en;
+
+typedef void (*caribou_smi_unpack_func)(const uint32_t* words, size_t num_words,
+                                        caribou_smi_sample_complex_int16* samples,
+                                        caribou_smi_sample_meta* meta,
+                                        bool swap_iq);
+
+// Fused unpack + scaling into interleaved float I/Q (sample / 4096.0)
+typedef void (*caribou_smi_unpack_cf32_func)(const uint32_t* words, size_t num_words,
+                                        caribou_smi_sample_complex_float* samples,
+                                        caribou_smi_sample_meta* meta,
+                                        bool swap_iq);
+
+// Select the engine used by 'caribou_smi_unpack'. Returns the engine actually
+// selected - if the requested engine is not supported by the CPU / build, the
+// best available engine is chosen instead.
+caribou_smi_unpack_engine_en caribou_smi_unpack_select(caribou_smi_unpack_engine_en engine);
+caribou_smi_unpack_engine_en caribou_smi_unpack_get_engine(void);
+bool caribou_smi_unpack_engine_supported(caribou_smi_unpack_engine_en engine);
+const char* caribou_smi_unpack_engine_name(caribou_smi_unpack_engine_en engine);
+caribou_smi_unpack_func caribou_smi_unpack_get_func(caribou_smi_unpack_engine_en engine);
+caribou_smi_unpack_cf32_func caribou_smi_unpack_get_func_cf32(caribou_smi_unpack_engine_en engine);
+
+// Unpack 'num_words' raw SMI words into int16 I/Q pairs and sync bits.
+// Either 'samples' or 'meta' may be NULL.
+void caribou_smi_unpack(const uint32_t* words, size_t num_words,
+                        caribou_smi_sample_complex_int16* samples,
+                        caribou_smi_sample_meta* meta,
+                        caribou_smi_channel_en channel);
+
+// Unpack straight into the scaled floating point formats (single pass, no
+// intermediate int16 buffer). Either 'samples' or 'meta' may be NULL.
+void caribou_smi_unpack_cf32(const uint32_t* words, size_t num_words,
+                        caribou_smi_sample_complex_float* samples,
+                        caribou_smi_sample_meta* meta,
+                        caribou_smi_channel_en channel);
+void caribou_smi_unpack_cf64(const uint32_t* words, size_t num_words,
+                        caribou_smi_sample_complex_double* samples,
+                        caribou_smi_sample_meta* meta,
+                        caribou_smi_channel_en channel);
+
+// Demultiplex a dual rx stream into per-channel outputs in a single pass. 'samples'
+// and 'meta' are indexed by caribou_smi_channel_en (any of them may be NULL), and
+// 'counts' holds the number of samples already in each output - it is advanced
+// by the number of words that went to each channel.
+void caribou_smi_unpack_dual(const uint32_t* words, size_t num_words,
+                        caribou_smi_sample_format_en format,
+                        void* samples[2],
+                        caribou_smi_sample_meta* meta[2],
+                        size_t counts[2]);
+
+// Number of leading words (starting at 'words') that carry valid marker bits
+size_t caribou_smi_unpack_count_valid(const uint32_t* words, size_t num_words);
+
+// Searches 'buffer' for the first byte offset from which 'min_words' consecutive
+// valid words follow. Returns the byte offset or -1 if not found.
+int caribou_smi_unpack_find_sync(const uint8_t* buffer, size_t len, size_t min_words);
+
+// Same as above with the marker bits selected by 'marker_mask' (CARIBOU_SMI_WORD_MARKER_MASK
+// or CARIBOU_SMI_WORD_DUAL_MARKER_MASK)
+size_t caribou_smi_unpack_count_valid_mask(const uint32_t* words, size_t num_words, uint32_t marker_mask);
+int caribou_smi_unpack_find_sync_mask(const uint8_t* buffer, size_t len, size_t min_words, uint32_t marker_mask);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CARIBOU_SMI_UNPACK_H__
@@ -0,0 +1,309 @@
+#define ZF_LOG_LEVEL ZF_LOG_INFO
+#define ZF_LOG_DEF_SRCLOC ZF_LOG_SRCLOC_LONG
+#define ZF_LOG_TAG "CARIBOU_SMI_PACK_Test"
+
+#include "zf_log/zf_log.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "caribou_smi_pack.h"
+
+#define NUM_SAMPLES         (1024 * 128)        // a typical native batch
+#define NUM_BENCH_ROUNDS    (200)
+
+#define SMI_TX_SAMPLE_SOF               (1<<2)
+#define SMI_TX_SAMPLE_MODEM_TX_CTRL     (1<<1)
+#define SMI_TX_SAMPLE_COND_TX_CTRL      (1<<0)
+
+//==============================================
+// The original per-sample packing (taken from caribou_smi_generate_data)
+static void reference_pack(const caribou_smi_sample_complex_int16* cmplx_vec, size_t num_samples, uint32_t* samples)
+{
+    for (unsigned int i = 0; i < num_samples; i++)
+    {
+        int32_t ii = cmplx_vec[i].i;
+        int32_t qq = cmplx_vec[i].q;
+
+        uint32_t s = SMI_TX_SAMPLE_SOF | SMI_TX_SAMPLE_MODEM_TX_CTRL | SMI_TX_SAMPLE_COND_TX_CTRL; s <<= 5;
+        s |= (ii >> 8) & 0x1F; s <<= 8;
+        s |= (ii >> 1) & 0x7F; s <<= 2;
+        s |= (ii & 0x1); s <<= 6;
+        s |= (qq >> 7) & 0x3F; s <<= 8;
+        s |= (qq & 0x7F);
+
+        samples[i] = __builtin_bswap32(s);
+    }
+}
+
+//==============================================
+// The float reference - saturate to the 13 bit range, truncate and pack
+static int16_t reference_float_to_int16(float v)
+{
+    v *= 4096.0f;
+    if (isnan(v) || v > 4095.0f) v = 4095.0f;
+    if (v < -4096.0f) v = -4096.0f;
+    return (int16_t)v;
+}
+
+//==============================================
+static uint32_t xorshift32(uint32_t* state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+//==============================================
+static void generate_samples(caribou_smi_sample_complex_int16* samples, size_t num_samples)
+{
+    uint32_t state = 0x12345678;
+    for (size_t i = 0; i < num_samples; i++)
+    {
+        uint32_t s = xorshift32(&state);
+        samples[i].i = (int16_t)(s & 0xFFFF);
+        samples[i].q = (int16_t)(s >> 16);
+    }
+
+    // edge values - the 13 bit range limits and out of range int16 values
+    const int16_t edges[] = {0, -1, 1, 4095, -4096, 4096, -4097, 32767, -32768, 0x1FFF, 0x1000, -0x1000};
+    const size_t num_edges = sizeof(edges) / sizeof(edges[0]);
+    for (size_t i = 0; i < num_edges * num_edges && i < num_samples; i++)
+    {
+        samples[i].i = edges[i % num_edges];
+        samples[i].q = edges[i / num_edges];
+    }
+}
+
+//==============================================
+static void generate_floats(caribou_smi_sample_complex_float* samples, size_t num_samples)
+{
+    uint32_t state = 0xCAFEBABE;
+    for (size_t i = 0; i < num_samples; i++)
+    {
+        // mostly in range with some overdrive
+        samples[i].i = ((int32_t)xorshift32(&state) / 2147483648.0f) * 1.25f;
+        samples[i].q = ((int32_t)xorshift32(&state) / 2147483648.0f) * 1.25f;
+    }
+
+    const float edges[] = {0.0f, -0.0f, 1.0f, -1.0f, 4095.0f / 4096.0f, 4095.5f / 4096.0f,
+                           -4096.5f / 4096.0f, 0.5f / 4096.0f, -0.5f / 4096.0f, 1e9f, -1e9f,
+                           INFINITY, -INFINITY, NAN};
+    const size_t num_edges = sizeof(edges) / sizeof(edges[0]);
+    for (size_t i = 0; i < num_edges * num_edges && i < num_samples; i++)
+    {
+        samples[i].i = edges[i % num_edges];
+        samples[i].q = edges[i / num_edges];
+    }
+}
+
+//==============================================
+static double time_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//==============================================
+static int test_bit_exact(caribou_smi_unpack_engine_en engine)
+{
+    // one extra sample to allow unaligned source buffers
+    uint8_t* raw = malloc((NUM_SAMPLES + 1) * sizeof(caribou_smi_sample_complex_int16));
+    caribou_smi_sample_complex_int16* samples = malloc(NUM_SAMPLES * sizeof(caribou_smi_sample_complex_int16));
+    uint32_t* ref_words = malloc(NUM_SAMPLES * sizeof(uint32_t));
+    uint32_t* words = malloc(NUM_SAMPLES * sizeof(uint32_t));
+    caribou_smi_pack_func func = caribou_smi_pack_get_func(engine);
+    const size_t lengths[] = {0, 1, 3, 7, 8, 15, 17, 31, 33, 1000, NUM_SAMPLES};
+    int errors = 0;
+
+    generate_samples(samples, NUM_SAMPLES);
+
+    for (size_t byte_offs = 0; byte_offs < 4; byte_offs += 2)
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+    {
+        size_t n = lengths[l];
+        const caribou_smi_sample_complex_int16* src = (const caribou_smi_sample_complex_int16*)(raw + byte_offs);
+        memcpy(raw + byte_offs, samples, NUM_SAMPLES * sizeof(caribou_smi_sample_complex_int16));
+
+        memset(ref_words, 0xA5, NUM_SAMPLES * sizeof(uint32_t));
+        memset(words, 0xA5, NUM_SAMPLES * sizeof(uint32_t));
+
+        reference_pack(samples, n, ref_words);
+        func(src, n, words);
+
+        if (memcmp(ref_words, words, NUM_SAMPLES * sizeof(uint32_t)) != 0)
+        {
+            printf("    MISMATCH: engine %s, length %lu, source offset %lu\n",
+                    caribou_smi_unpack_engine_name(engine), n, byte_offs);
+            errors ++;
+        }
+    }
+
+    // exhaustive over a single field - every int16 value in I and in Q
+    for (int32_t v = -32768; v <= 32767; v++)
+    {
+        caribou_smi_sample_complex_int16 s[2] = {{.i = (int16_t)v, .q = 0x0ABC}, {.i = 0x0ABC, .q = (int16_t)v}};
+        caribou_smi_sample_complex_int16 tmp[8];
+        uint32_t ref[8], out[8];
+        for (int k = 0; k < 8; k++) tmp[k] = s[k & 1];
+        reference_pack(tmp, 8, ref);
+        func(tmp, 8, out);
+        if (memcmp(ref, out, sizeof(ref)) != 0)
+        {
+            printf("    MISMATCH (exhaustive): engine %s, value %d\n", caribou_smi_unpack_engine_name(engine), v);
+            errors ++;
+            break;
+        }
+    }
+
+    free(raw);
+    free(samples);
+    free(ref_words);
+    free(words);
+    return errors;
+}
+
+//==============================================
+// The fused float path must match the saturated two-pass conversion
+static int test_float_exact(caribou_smi_unpack_engine_en engine)
+{
+    caribou_smi_sample_complex_float* samples = malloc(NUM_SAMPLES * sizeof(caribou_smi_sample_complex_float));
+    caribou_smi_sample_complex_double* samples_dbl = malloc(NUM_SAMPLES * sizeof(caribou_smi_sample_complex_double));
+    caribou_smi_sample_complex_int16* ref_iq = malloc(NUM_SAMPLES * sizeof(caribou_smi_sample_complex_int16));
+    uint32_t* ref_words = malloc(NUM_SAMPLES * sizeof(uint32_t));
+    uint32_t* words = malloc(NUM_SAMPLES * sizeof(uint32_t));
+    uint32_t* words_dbl = malloc(NUM_SAMPLES * sizeof(uint32_t));
+    caribou_smi_pack_cf32_func func = caribou_smi_pack_get_func_cf32(engine);
+    const size_t lengths[] = {1, 3, 7, 9, 17, 1000, NUM_SAMPLES};
+    int errors = 0;
+
+    generate_floats(samples, NUM_SAMPLES);
+    for (size_t i = 0; i < NUM_SAMPLES; i++)
+    {
+        samples_dbl[i].i = samples[i].i;
+        samples_dbl[i].q = samples[i].q;
+        ref_iq[i].i = reference_float_to_int16(samples[i].i);
+        ref_iq[i].q = reference_float_to_int16(samples[i].q);
+    }
+
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+    {
+        size_t n = lengths[l];
+        reference_pack(ref_iq, n, ref_words);
+        func(samples, n, words);
+        caribou_smi_pack_cf64(samples_dbl, n, words_dbl);
+
+        if (memcmp(ref_words, words, n * sizeof(uint32_t)) != 0 ||
+            memcmp(ref_words, words_dbl, n * sizeof(uint32_t)) != 0)
+        {
+            printf("    MISMATCH (float): engine %s, length %lu\n",
+                    caribou_smi_unpack_engine_name(engine), n);
+            errors ++;
+        }
+    }
+
+    free(samples);
+    free(samples_dbl);
+    free(ref_iq);
+    free(ref_words);
+    free(words);
+    free(words_dbl);
+    return errors;
+}
+
+//==============================================
+static void benchmark_float(const char* name, caribou_smi_pack_cf32_func func)
+{
+    caribou_smi_sample_complex_float* samples = malloc(NUM_SAMPLES * sizeof(caribou_smi_sample_complex_float));
+    caribou_smi_sample_complex_int16* iq = malloc(NUM_SAMPLES * sizeof(caribou_smi_sample_complex_int16));
+    uint32_t* words = malloc(NUM_SAMPLES * sizeof(uint32_t));
+
+    generate_floats(samples, NUM_SAMPLES);
+
+    double start = time_now();
+    for (int r = 0; r < NUM_BENCH_ROUNDS; r++)
+    {
+        if (func) func(samples, NUM_SAMPLES, words);
+        else
+        {
+            // the previous path - convert to int16 and pack in a second pass
+            for (size_t i = 0; i < NUM_SAMPLES; i++)
+            {
+                iq[i].i = (int16_t)(samples[i].i * 4096);
+                iq[i].q = (int16_t)(samples[i].q * 4096);
+            }
+            reference_pack(iq, NUM_SAMPLES, words);
+        }
+    }
+    double elapsed = time_now() - start;
+    double msps = (double)NUM_SAMPLES * NUM_BENCH_ROUNDS / elapsed / 1e6;
+
+    printf("    %-10s %9.1f MSPS\n", name, msps);
+
+    free(samples);
+    free(iq);
+    free(words);
+}
+
+//==============================================
+static void benchmark(const char* name, caribou_smi_pack_func func)
+{
+    caribou_smi_sample_complex_int16* iq = malloc(NUM_SAMPLES * sizeof(caribou_smi_sample_complex_int16));
+    uint32_t* words = malloc(NUM_SAMPLES * sizeof(uint32_t));
+
+    generate_samples(iq, NUM_SAMPLES);
+
+    double start = time_now();
+    for (int r = 0; r < NUM_BENCH_ROUNDS; r++)
+    {
+        if (func) func(iq, NUM_SAMPLES, words);
+        else reference_pack(iq, NUM_SAMPLES, words);
+    }
+    double elapsed = time_now() - start;
+    double msps = (double)NUM_SAMPLES * NUM_BENCH_ROUNDS / elapsed / 1e6;
+
+    printf("    %-10s %9.1f MSPS  (%.1f%% of one core at %d SPS)\n", name, msps,
+            100.0 * CARIBOU_SMI_SAMPLE_RATE / (msps * 1e6), CARIBOU_SMI_SAMPLE_RATE);
+
+    free(iq);
+    free(words);
+}
+
+//==============================================
+int main()
+{
+    int errors = 0;
+
+    printf("Bit-exact test against the reference packer:\n");
+    for (int e = caribou_smi_unpack_scalar; e <= caribou_smi_unpack_neon; e++)
+    {
+        if (!caribou_smi_unpack_engine_supported(e)) continue;
+        int err = test_bit_exact(e) + test_float_exact(e);
+        printf("    %-10s %s\n", caribou_smi_unpack_engine_name(e), err ? "FAILED" : "OK");
+        errors += err;
+    }
+
+    printf("Throughput (%d samples per buffer):\n", NUM_SAMPLES);
+    benchmark("reference", NULL);
+    for (int e = caribou_smi_unpack_scalar; e <= caribou_smi_unpack_neon; e++)
+    {
+        if (!caribou_smi_unpack_engine_supported(e)) continue;
+        benchmark(caribou_smi_unpack_engine_name(e), caribou_smi_pack_get_func(e));
+    }
+    printf("Float32 throughput (reference = int16 conversion + second packing pass):\n");
+    benchmark_float("reference", NULL);
+    for (int e = caribou_smi_unpack_scalar; e <= caribou_smi_unpack_neon; e++)
+    {
+        if (!caribou_smi_unpack_engine_supported(e)) continue;
+        benchmark_float(caribou_smi_unpack_engine_name(e), caribou_smi_pack_get_func_cf32(e));
+    }
+    printf("Auto-selected engine: %s\n", caribou_smi_unpack_engine_name(caribou_smi_pack_get_engine()));
+
+    return errors ? 1 : 0;
+}
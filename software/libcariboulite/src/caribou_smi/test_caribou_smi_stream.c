@@ -0,0 +1,206 @@
+#define ZF_LOG_LEVEL ZF_LOG_INFO
+#define ZF_LOG_DEF_SRCLOC ZF_LOG_SRCLOC_LONG
+#define ZF_LOG_TAG "CARIBOU_SMI_STREAM_Test"
+
+#include "zf_log/zf_log.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "caribou_smi.h"
+#include "caribou_smi_unpack.h"
+
+// A fake rx ring (no driver) - the chunks are filled and published here and read
+// back through caribou_smi_read, as the driver's ring would be
+#define NUM_CHUNKS          (16)
+#define CHUNK_SIZE          (1024)
+#define STREAM_OFFSET       (3)                 // garbage bytes before the first word
+#define READ_LEN            (37)                // samples per read - not aligned to anything
+
+//==============================================
+// Sample 'n' of the test stream - a running counter in I (low bits) and Q
+static uint32_t stream_word(size_t n)
+{
+    uint32_t i = n % 4096;
+    uint32_t q = (n / 4096) % 4096;
+    return CARIBOU_SMI_WORD_MARKER | (i << 17) | (q << 1);
+}
+
+static uint8_t stream_byte(size_t b, bool valid)
+{
+    if (!valid || b < STREAM_OFFSET) return 0;
+    uint32_t w = stream_word((b - STREAM_OFFSET) / CARIBOU_SMI_BYTES_PER_SAMPLE);
+    return (w >> (8 * ((b - STREAM_OFFSET) % CARIBOU_SMI_BYTES_PER_SAMPLE))) & 0xFF;
+}
+
+//==============================================
+typedef struct
+{
+    caribou_smi_st dev;
+    struct smi_stream_rx_ring_ctrl ctrl;
+    uint8_t data[NUM_CHUNKS * CHUNK_SIZE];
+} fake_ring_st;
+
+static void fake_ring_init(fake_ring_st* r)
+{
+    memset(r, 0, sizeof(fake_ring_st));
+    r->ctrl.magic = SMI_STREAM_RX_RING_MAGIC;
+    r->ctrl.num_chunks = NUM_CHUNKS;
+    r->ctrl.chunk_size = CHUNK_SIZE;
+
+    r->dev.initialized = 1;
+    r->dev.filedesc = -1;
+    r->dev.sample_rate = CARIBOU_SMI_SAMPLE_RATE;
+    r->dev.state = smi_stream_rx_channel_0;
+    r->dev.debug_mode = caribou_smi_none;
+    r->dev.rx_ring.mapped = true;
+    r->dev.rx_ring.ctrl = &r->ctrl;
+    r->dev.rx_ring.data = r->data;
+}
+
+// writes the next chunk of the stream into the ring and publishes it
+static void fake_ring_publish(fake_ring_st* r, bool valid)
+{
+    uint32_t head = r->ctrl.head;
+    uint8_t* chunk = r->data + (head % NUM_CHUNKS) * CHUNK_SIZE;
+    for (size_t k = 0; k < CHUNK_SIZE; k++)
+    {
+        chunk[k] = stream_byte((size_t)head * CHUNK_SIZE + k, valid);
+    }
+    r->ctrl.chunk_info[head % NUM_CHUNKS].stream_bytes = (uint64_t)(head + 1) * CHUNK_SIZE;
+    __atomic_store_n(&r->ctrl.head, head + 1, __ATOMIC_RELEASE);
+}
+
+//==============================================
+// Every chunk boundary splits a word (the stream starts at an odd offset), and
+// the reads end in the middle of chunks - the samples must come out contiguous
+static int test_stitch(void)
+{
+    static fake_ring_st r;
+    caribou_smi_sample_complex_int16 samples[READ_LEN];
+    size_t read = 0;
+    int errors = 0;
+
+    fake_ring_init(&r);
+
+    for (int c = 0; c < 3 * NUM_CHUNKS && !errors; c++)
+    {
+        fake_ring_publish(&r, true);
+
+        // read exactly what is complete, so the reads never wait for the driver
+        size_t complete = ((size_t)r.ctrl.head * CHUNK_SIZE - STREAM_OFFSET) / CARIBOU_SMI_BYTES_PER_SAMPLE;
+        while (read < complete && !errors)
+        {
+            size_t len = complete - read < READ_LEN ? complete - read : READ_LEN;
+            int ret = caribou_smi_read(&r.dev, caribou_smi_channel_900, samples, NULL, len);
+            if (ret != (int)len)
+            {
+                printf("    chunk %d: read returned %d instead of %lu\n", c, ret, len);
+                errors ++;
+                break;
+            }
+
+            for (int k = 0; k < ret; k++, read++)
+            {
+                if (samples[k].i != (int16_t)(read % 4096) || samples[k].q != (int16_t)((read / 4096) % 4096))
+                {
+                    printf("    sample %lu: got (%d, %d)\n", read, samples[k].i, samples[k].q);
+                    errors ++;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (r.dev.align.dropped_bytes != STREAM_OFFSET || r.dev.align.resync_count != 1)
+    {
+        printf("    dropped %llu bytes in %u resyncs (expected %d in 1)\n",
+                (unsigned long long)r.dev.align.dropped_bytes, r.dev.align.resync_count, STREAM_OFFSET);
+        errors ++;
+    }
+    return errors;
+}
+
+//==============================================
+// A single broken word inside a locked read (not the first, middle or last one)
+// must not be decoded - the stream resyncs past it and goes on
+#define BROKEN_WORD         (10)
+static int test_broken_word(void)
+{
+    static fake_ring_st r;
+    caribou_smi_sample_complex_int16 samples[READ_LEN];
+    int errors = 0;
+
+    fake_ring_init(&r);
+    fake_ring_publish(&r, true);
+    memset(r.data + STREAM_OFFSET + BROKEN_WORD * CARIBOU_SMI_BYTES_PER_SAMPLE, 0, CARIBOU_SMI_BYTES_PER_SAMPLE);
+
+    int ret = caribou_smi_read(&r.dev, caribou_smi_channel_900, samples, NULL, READ_LEN);
+    if (ret != READ_LEN)
+    {
+        printf("    read returned %d instead of %d\n", ret, READ_LEN);
+        return 1;
+    }
+
+    for (int k = 0; k < ret; k++)
+    {
+        int n = (k < BROKEN_WORD) ? k : k + 1;
+        if (samples[k].i != n % 4096 || samples[k].q != (n / 4096) % 4096)
+        {
+            printf("    sample %d: got (%d, %d), expected stream sample %d\n", k, samples[k].i, samples[k].q, n);
+            errors ++;
+            break;
+        }
+    }
+
+    if (r.dev.align.resync_count != 2)
+    {
+        printf("    %u resyncs (expected 2)\n", r.dev.align.resync_count);
+        errors ++;
+    }
+    return errors;
+}
+
+//==============================================
+// A stream without valid words must fail the read instead of searching forever
+static int test_resync_limit(void)
+{
+    static fake_ring_st r;
+    caribou_smi_sample_complex_int16 samples[READ_LEN];
+
+    fake_ring_init(&r);
+    for (int c = 0; c < NUM_CHUNKS - 1; c++)
+    {
+        fake_ring_publish(&r, false);
+    }
+
+    int ret = caribou_smi_read(&r.dev, caribou_smi_channel_900, samples, NULL, READ_LEN);
+    if (ret != -1)
+    {
+        printf("    read of an invalid stream returned %d\n", ret);
+        return 1;
+    }
+    return 0;
+}
+
+//==============================================
+int main()
+{
+    int errors = 0;
+    int err = 0;
+
+    err = test_stitch();
+    printf("Carry / stitch across chunks and reads: %s\n", err ? "FAILED" : "OK");
+    errors += err;
+
+    err = test_broken_word();
+    printf("Broken word inside a locked read: %s\n", err ? "FAILED" : "OK");
+    errors += err;
+
+    err = test_resync_limit();
+    printf("Resync attempts limit: %s\n", err ? "FAILED" : "OK");
+    errors += err;
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,370 @@
+#define ZF_LOG_LEVEL ZF_LOG_INFO
+#define ZF_LOG_DEF_SRCLOC ZF_LOG_SRCLOC_LONG
+#define ZF_LOG_TAG "CARIBOU_SMI_UNPACK_Test"
+
+#include "zf_log/zf_log.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "caribou_smi_unpack.h"
+
+#define NUM_WORDS           (1024 * 128)        // a typical native batch
+#define NUM_BENCH_ROUNDS    (200)
+
+//==============================================
+// The original per-sample unpacking (taken from caribou_smi_rx_data_analyze)
+static void reference_unpack(const uint32_t* actual_samples, size_t num_words,
+                             caribou_smi_sample_complex_int16* cmplx_vec,
+                             caribou_smi_sample_meta* meta_offset,
+                             caribou_smi_channel_en channel)
+{
+    unsigned int i = 0;
+    if (channel != caribou_smi_channel_2400)
+    {   /* S1G */
+        for (i = 0; i < num_words; i++)
+        {
+            uint32_t s = actual_samples[i];
+
+            if (meta_offset) meta_offset[i].sync = s & 0x00000001;
+            if (cmplx_vec)
+            {
+                s >>= 1;
+                cmplx_vec[i].q = s & 0x00001FFF; s >>= 13;
+                s >>= 3;
+                cmplx_vec[i].i = s & 0x00001FFF; s >>= 13;
+
+                if (cmplx_vec[i].i >= (int16_t)0x1000) cmplx_vec[i].i -= (int16_t)0x2000;
+                if (cmplx_vec[i].q >= (int16_t)0x1000) cmplx_vec[i].q -= (int16_t)0x2000;
+            }
+        }
+    }
+    else
+    {   /* HiF */
+        for (i = 0; i < num_words; i++)
+        {
+            uint32_t s = actual_samples[i];
+
+            if (meta_offset) meta_offset[i].sync = s & 0x00000001;
+            if (cmplx_vec)
+            {
+                s >>= 1;
+                cmplx_vec[i].i = s & 0x00001FFF; s >>= 13;
+                s >>= 3;
+                cmplx_vec[i].q = s & 0x00001FFF; s >>= 13;
+
+                if (cmplx_vec[i].i >= (int16_t)0x1000) cmplx_vec[i].i -= (int16_t)0x2000;
+                if (cmplx_vec[i].q >= (int16_t)0x1000) cmplx_vec[i].q -= (int16_t)0x2000;
+            }
+        }
+    }
+}
+
+//==============================================
+static uint32_t xorshift32(uint32_t* state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+//==============================================
+static void generate_words(uint32_t* words, size_t num_words, bool valid_markers)
+{
+    uint32_t state = 0x12345678;
+    for (size_t i = 0; i < num_words; i++)
+    {
+        uint32_t s = xorshift32(&state);
+        if (valid_markers) s = (s & ~0xC001C000) | 0x80004000;
+        words[i] = s;
+    }
+
+    // edge values for the sign extension
+    const uint32_t edges[] = {0x00000000, 0xFFFFFFFF, 0x80004000, 0xBFFFFFFF,
+                              0x9FFE5FFF, 0xA0006000, 0x80024002, 0xBFFC7FFC};
+    for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]) && i < num_words; i++)
+    {
+        words[i] = edges[i];
+    }
+}
+
+//==============================================
+static double time_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//==============================================
+static int test_bit_exact(caribou_smi_unpack_engine_en engine)
+{
+    // one extra word to allow unaligned source buffers
+    uint32_t* raw = malloc((NUM_WORDS + 1) * sizeof(uint32_t));
+    caribou_smi_sample_complex_int16* ref_iq = malloc(NUM_WORDS * sizeof(caribou_smi_sample_complex_int16));
+    caribou_smi_sample_complex_int16* iq = malloc(NUM_WORDS * sizeof(caribou_smi_sample_complex_int16));
+    caribou_smi_sample_meta* ref_meta = malloc(NUM_WORDS * sizeof(caribou_smi_sample_meta));
+    caribou_smi_sample_meta* meta = malloc(NUM_WORDS * sizeof(caribou_smi_sample_meta));
+    uint32_t* aligned = malloc(NUM_WORDS * sizeof(uint32_t));
+    caribou_smi_unpack_func func = caribou_smi_unpack_get_func(engine);
+    const size_t lengths[] = {0, 1, 3, 7, 8, 15, 17, 31, 33, 1000, NUM_WORDS};
+    int errors = 0;
+
+    for (int valid = 0; valid < 2; valid++)
+    for (size_t byte_offs = 0; byte_offs < 4; byte_offs++)
+    for (int ch = caribou_smi_channel_900; ch <= caribou_smi_channel_2400; ch++)
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+    {
+        size_t n = lengths[l];
+        const uint32_t* words = (const uint32_t*)((uint8_t*)raw + byte_offs);
+
+        generate_words(aligned, NUM_WORDS, valid);
+        memcpy((uint8_t*)raw + byte_offs, aligned, NUM_WORDS * sizeof(uint32_t));
+
+        memset(ref_iq, 0xA5, NUM_WORDS * sizeof(caribou_smi_sample_complex_int16));
+        memset(iq, 0xA5, NUM_WORDS * sizeof(caribou_smi_sample_complex_int16));
+        memset(ref_meta, 0xA5, NUM_WORDS * sizeof(caribou_smi_sample_meta));
+        memset(meta, 0xA5, NUM_WORDS * sizeof(caribou_smi_sample_meta));
+
+        reference_unpack(aligned, n, ref_iq, ref_meta, ch);
+        func(words, n, iq, meta, ch == caribou_smi_channel_2400);
+
+        if (memcmp(ref_iq, iq, NUM_WORDS * sizeof(caribou_smi_sample_complex_int16)) != 0 ||
+            memcmp(ref_meta, meta, NUM_WORDS * sizeof(caribou_smi_sample_meta)) != 0)
+        {
+            printf("    MISMATCH: engine %s, channel %d, length %lu, source offset %lu\n",
+                    caribou_smi_unpack_engine_name(engine), ch, n, byte_offs);
+            errors ++;
+        }
+
+        // partial outputs
+        memset(iq, 0xA5, NUM_WORDS * sizeof(caribou_smi_sample_complex_int16));
+        memset(meta, 0xA5, NUM_WORDS * sizeof(caribou_smi_sample_meta));
+        func(words, n, iq, NULL, ch == caribou_smi_channel_2400);
+        func(words, n, NULL, meta, ch == caribou_smi_channel_2400);
+        if (memcmp(ref_iq, iq, NUM_WORDS * sizeof(caribou_smi_sample_complex_int16)) != 0 ||
+            memcmp(ref_meta, meta, NUM_WORDS * sizeof(caribou_smi_sample_meta)) != 0)
+        {
+            printf("    MISMATCH (partial outputs): engine %s, channel %d, length %lu\n",
+                    caribou_smi_unpack_engine_name(engine), ch, n);
+            errors ++;
+        }
+    }
+
+    free(raw);
+    free(aligned);
+    free(ref_iq);
+    free(iq);
+    free(ref_meta);
+    free(meta);
+    return errors;
+}
+
+//==============================================
+// The float path must match the previous two-pass conversion (int16 / 4096.0)
+static int test_float_exact(caribou_smi_unpack_engine_en engine)
+{
+    uint32_t* words = malloc(NUM_WORDS * sizeof(uint32_t));
+    caribou_smi_sample_complex_int16* ref_iq = malloc(NUM_WORDS * sizeof(caribou_smi_sample_complex_int16));
+    caribou_smi_sample_complex_float* iq = malloc(NUM_WORDS * sizeof(caribou_smi_sample_complex_float));
+    caribou_smi_sample_complex_double* iq_dbl = malloc(NUM_WORDS * sizeof(caribou_smi_sample_complex_double));
+    caribou_smi_sample_meta* ref_meta = malloc(NUM_WORDS * sizeof(caribou_smi_sample_meta));
+    caribou_smi_sample_meta* meta = malloc(NUM_WORDS * sizeof(caribou_smi_sample_meta));
+    caribou_smi_unpack_cf32_func func = caribou_smi_unpack_get_func_cf32(engine);
+    const size_t lengths[] = {1, 3, 7, 9, 17, 1000, NUM_WORDS};
+    int errors = 0;
+
+    generate_words(words, NUM_WORDS, true);
+
+    for (int ch = caribou_smi_channel_900; ch <= caribou_smi_channel_2400; ch++)
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+    {
+        size_t n = lengths[l];
+        int mismatch = 0;
+        reference_unpack(words, n, ref_iq, ref_meta, ch);
+        func(words, n, iq, meta, ch == caribou_smi_channel_2400);
+        caribou_smi_unpack_cf64(words, n, iq_dbl, NULL, ch);
+
+        for (size_t i = 0; i < n; i++)
+        {
+            if (iq[i].i != ref_iq[i].i / 4096.0f || iq[i].q != ref_iq[i].q / 4096.0f) mismatch = 1;
+            if (iq_dbl[i].i != ref_iq[i].i / 4096.0 || iq_dbl[i].q != ref_iq[i].q / 4096.0) mismatch = 1;
+        }
+        if (memcmp(ref_meta, meta, n * sizeof(caribou_smi_sample_meta)) != 0) mismatch = 1;
+
+        if (mismatch)
+        {
+            printf("    MISMATCH (float): engine %s, channel %d, length %lu\n",
+                    caribou_smi_unpack_engine_name(engine), ch, n);
+            errors ++;
+        }
+    }
+
+    free(words);
+    free(ref_iq);
+    free(iq);
+    free(iq_dbl);
+    free(ref_meta);
+    free(meta);
+    return errors;
+}
+
+//==============================================
+static int reference_find_sync(const uint8_t* buffer, size_t len, size_t min_words)
+{
+    for (size_t offs = 0; offs + min_words * 4 <= len; offs++)
+    {
+        size_t i = 0;
+        for (; i < min_words; i++)
+        {
+            uint32_t s;
+            memcpy(&s, buffer + offs + i * 4, 4);
+            if (!CARIBOU_SMI_WORD_VALID(s)) break;
+        }
+        if (i == min_words) return (int)offs;
+    }
+    return -1;
+}
+
+//==============================================
+static int test_sync(caribou_smi_unpack_engine_en engine)
+{
+    int errors = 0;
+    const size_t n = 1024;
+    uint32_t state = 0xCAFEBABE;
+    uint8_t* buffer = malloc(n * 4 + 8);
+    uint32_t* words = malloc(n * 4);
+
+    caribou_smi_unpack_select(engine);
+    generate_words(words, n, true);
+    for (size_t i = 0; i < 8; i++) words[i] = CARIBOU_SMI_WORD_MARKER;   // the edge values are not all valid
+
+    for (size_t garbage = 0; garbage < 8; garbage++)
+    {
+        for (size_t i = 0; i < garbage; i++) buffer[i] = xorshift32(&state);
+        memcpy(buffer + garbage, words, n * 4);
+        int offs = caribou_smi_unpack_find_sync(buffer, n * 4 + garbage, 4);
+        if (offs != reference_find_sync(buffer, n * 4 + garbage, 4))
+        {
+            printf("    MISMATCH (sync): engine %s, garbage %lu, offset %d\n",
+                    caribou_smi_unpack_engine_name(engine), garbage, offs);
+            errors ++;
+        }
+    }
+
+    for (size_t broken = 0; broken <= n; broken += 37)
+    {
+        uint32_t saved = broken < n ? words[broken] : 0;
+        if (broken < n) words[broken] = 0;
+        if (caribou_smi_unpack_count_valid(words, n) != broken)
+        {
+            printf("    MISMATCH (count valid): engine %s, broken word %lu\n",
+                    caribou_smi_unpack_engine_name(engine), broken);
+            errors ++;
+        }
+        if (broken < n) words[broken] = saved;
+    }
+
+    free(buffer);
+    free(words);
+    return errors;
+}
+
+//==============================================
+static void benchmark_float(const char* name, caribou_smi_unpack_cf32_func func)
+{
+    uint32_t* words = malloc(NUM_WORDS * sizeof(uint32_t));
+    caribou_smi_sample_complex_int16* iq = malloc(NUM_WORDS * sizeof(caribou_smi_sample_complex_int16));
+    caribou_smi_sample_complex_float* iq_flt = malloc(NUM_WORDS * sizeof(caribou_smi_sample_complex_float));
+    caribou_smi_sample_meta* meta = malloc(NUM_WORDS * sizeof(caribou_smi_sample_meta));
+
+    generate_words(words, NUM_WORDS, true);
+
+    double start = time_now();
+    for (int r = 0; r < NUM_BENCH_ROUNDS; r++)
+    {
+        if (func) func(words, NUM_WORDS, iq_flt, meta, false);
+        else
+        {
+            // the previous path - unpack to int16 and convert in a second pass
+            reference_unpack(words, NUM_WORDS, iq, meta, caribou_smi_channel_900);
+            for (size_t i = 0; i < NUM_WORDS; i++)
+            {
+                iq_flt[i].i = iq[i].i / 4096.0;
+                iq_flt[i].q = iq[i].q / 4096.0;
+            }
+        }
+    }
+    double elapsed = time_now() - start;
+    double msps = (double)NUM_WORDS * NUM_BENCH_ROUNDS / elapsed / 1e6;
+
+    printf("    %-10s %9.1f MSPS\n", name, msps);
+
+    free(words);
+    free(iq);
+    free(iq_flt);
+    free(meta);
+}
+
+//==============================================
+static void benchmark(const char* name, caribou_smi_unpack_func func, bool reference)
+{
+    uint32_t* words = malloc(NUM_WORDS * sizeof(uint32_t));
+    caribou_smi_sample_complex_int16* iq = malloc(NUM_WORDS * sizeof(caribou_smi_sample_complex_int16));
+    caribou_smi_sample_meta* meta = malloc(NUM_WORDS * sizeof(caribou_smi_sample_meta));
+
+    generate_words(words, NUM_WORDS, true);
+
+    double start = time_now();
+    for (int r = 0; r < NUM_BENCH_ROUNDS; r++)
+    {
+        if (reference) reference_unpack(words, NUM_WORDS, iq, meta, caribou_smi_channel_900);
+        else func(words, NUM_WORDS, iq, meta, false);
+    }
+    double elapsed = time_now() - start;
+    double msps = (double)NUM_WORDS * NUM_BENCH_ROUNDS / elapsed / 1e6;
+
+    printf("    %-10s %9.1f MSPS  (%.1f%% of one core at %d SPS)\n", name, msps,
+            100.0 * CARIBOU_SMI_SAMPLE_RATE / (msps * 1e6), CARIBOU_SMI_SAMPLE_RATE);
+
+    free(words);
+    free(iq);
+    free(meta);
+}
+
+//==============================================
+int main()
+{
+    int errors = 0;
+
+    printf("Bit-exact test against the reference unpacker:\n");
+    for (int e = caribou_smi_unpack_scalar; e <= caribou_smi_unpack_neon; e++)
+    {
+        if (!caribou_smi_unpack_engine_supported(e)) continue;
+        int err = test_bit_exact(e) + test_float_exact(e) + test_sync(e);
+        printf("    %-10s %s\n", caribou_smi_unpack_engine_name(e), err ? "FAILED" : "OK");
+        errors += err;
+    }
+
+    printf("Throughput (%d words per buffer):\n", NUM_WORDS);
+    benchmark("reference", NULL, true);
+    for (int e = caribou_smi_unpack_scalar; e <= caribou_smi_unpack_neon; e++)
+    {
+        if (!caribou_smi_unpack_engine_supported(e)) continue;
+        benchmark(caribou_smi_unpack_engine_name(e), caribou_smi_unpack_get_func(e), false);
+    }
+    printf("Float32 throughput (reference = int16 + second conversion pass):\n");
+    benchmark_float("reference", NULL);
+    for (int e = caribou_smi_unpack_scalar; e <= caribou_smi_unpack_neon; e++)
+    {
+        if (!caribou_smi_unpack_engine_supported(e)) continue;
+        benchmark_float(caribou_smi_unpack_engine_name(e), caribou_smi_unpack_get_func_cf32(e));
+    }
+    printf("Auto-selected engine: %s\n", caribou_smi_unpack_engine_name(caribou_smi_unpack_get_engine()));
+
+    return errors ? 1 : 0;
+}
@@ -1,3 +1,18 @@
+#define _GNU_SOURCE         // pthread_setaffinity_np
+#ifndef ZF_LOG_LEVEL
+    #define ZF_LOG_LEVEL ZF_LOG_VERBOSE
+#endif
+#define ZF_LOG_DEF_SRCLOC ZF_LOG_SRCLOC_LONG
+#define ZF_LOG_TAG "CARIBOULITE API"
+#include "zf_log/zf_log.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
 #include "cariboulite.h"
 #include "cariboulite_setup.h"
 #include "cariboulite_radio.h"
@@ -242,4 +257,110 @@ int cariboulite_get_frequency_limits(cariboulite_channel_en ch, float *freq_low,
         }
     }
     return -1;
-}
\ No newline at end of file
+}
+
+//=============================================================================
+int cariboulite_apply_thread_config(const cariboulite_thread_config_st* cfg, cariboulite_thread_state_st* prev)
+{
+    int ret = 0;
+    if (prev != NULL) memset(prev, 0, sizeof(cariboulite_thread_state_st));
+    if (cfg == NULL) return 0;
+
+    if (cfg->sched_policy != cariboulite_sched_default)
+    {
+        int policy = (cfg->sched_policy == cariboulite_sched_rr) ? SCHED_RR : SCHED_FIFO;
+        struct sched_param params = {0};
+        int prio = cfg->sched_priority;
+        if (prio < sched_get_priority_min(policy)) prio = sched_get_priority_min(policy);
+        if (prio > sched_get_priority_max(policy)) prio = sched_get_priority_max(policy);
+
+        int old_policy = 0;
+        struct sched_param old_params = {0};
+        bool saved = pthread_getschedparam(pthread_self(), &old_policy, &old_params) == 0;
+
+        params.sched_priority = prio;
+        int err = pthread_setschedparam(pthread_self(), policy, &params);
+        if (err != 0)
+        {
+            ZF_LOGW("couldn't set %s priority %d (%s) - running with the default scheduling",
+                    (policy == SCHED_RR) ? "SCHED_RR" : "SCHED_FIFO", prio, strerror(err));
+            ret = -1;
+        }
+        else if (prev != NULL && saved)
+        {
+            prev->sched_saved = true;
+            prev->sched_policy = old_policy;
+            prev->sched_priority = old_params.sched_priority;
+        }
+    }
+
+    if (CPU_COUNT(&cfg->cpus) != 0)
+    {
+        cpu_set_t old_cpus;
+        bool saved = pthread_getaffinity_np(pthread_self(), sizeof(old_cpus), &old_cpus) == 0;
+
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cfg->cpus), &cfg->cpus);
+        if (err != 0)
+        {
+            ZF_LOGW("couldn't set the cpu affinity to %d cpus (%s)", CPU_COUNT(&cfg->cpus), strerror(err));
+            ret = -1;
+        }
+        else if (prev != NULL && saved)
+        {
+            prev->cpus_saved = true;
+            prev->cpus = old_cpus;
+        }
+    }
+
+    // process wide - once is enough, the stream threads may get here together
+    static int memory_locked = 0;
+    if (cfg->lock_memory && !__atomic_exchange_n(&memory_locked, 1, __ATOMIC_ACQ_REL))
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            ZF_LOGW("couldn't lock the process memory (%s) - check RLIMIT_MEMLOCK", strerror(errno));
+            __atomic_store_n(&memory_locked, 0, __ATOMIC_RELEASE);
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
+
+//=============================================================================
+void cariboulite_restore_thread_config(cariboulite_thread_state_st* prev)
+{
+    if (prev == NULL) return;
+
+    if (prev->sched_saved)
+    {
+        struct sched_param params = {0};
+        params.sched_priority = prev->sched_priority;
+        int err = pthread_setschedparam(pthread_self(), prev->sched_policy, &params);
+        if (err != 0) ZF_LOGW("couldn't restore the thread scheduling (%s)", strerror(err));
+    }
+
+    if (prev->cpus_saved)
+    {
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(prev->cpus), &prev->cpus);
+        if (err != 0) ZF_LOGW("couldn't restore the cpu affinity (%s)", strerror(err));
+    }
+
+    // restored once
+    prev->sched_saved = false;
+    prev->cpus_saved = false;
+}
+
+//=============================================================================
+void cariboulite_prefault_buffer(const cariboulite_thread_config_st* cfg, void* buffer, size_t size)
+{
+    if (cfg == NULL || !cfg->prefault_buffers || buffer == NULL) return;
+
+    long page = sysconf(_SC_PAGESIZE);
+    volatile uint8_t* p = (volatile uint8_t*)buffer;
+    for (size_t i = 0; i < size; i += page)
+    {
+        p[i] = 0;
+    }
+    if (size) p[size - 1] = 0;
+}
@@ -15,6 +15,7 @@ extern "C" {
 #endif
 
 #include <signal.h>
+#include <sched.h>
 #include "cariboulite_radio.h"
 
 /**
@@ -47,6 +48,43 @@ typedef enum
     cariboulite_ism = 2,
 } cariboulite_version_en;
 
+/**
+ * @brief Streaming thread scheduling policy
+ */
+typedef enum
+{
+    cariboulite_sched_default = 0,      /**< leave the thread's policy as is */
+    cariboulite_sched_fifo = 1,         /**< SCHED_FIFO */
+    cariboulite_sched_rr = 2,           /**< SCHED_RR */
+} cariboulite_sched_policy_en;
+
+/**
+ * @brief Streaming thread configuration
+ */
+typedef struct
+{
+    cariboulite_sched_policy_en sched_policy;
+    int sched_priority;                 /**< 1 (lowest) .. 99 for fifo / rr */
+    cpu_set_t cpus;                     /**< the cores the thread may run on, empty = no change */
+    bool lock_memory;                   /**< mlockall the process (current and future pages) */
+    bool prefault_buffers;              /**< touch the stream buffers when allocated */
+} cariboulite_thread_config_st;
+
+/**
+ * @brief A thread's scheduling before a configuration was applied
+ *
+ * Filled by "cariboulite_apply_thread_config", only the parts it changed are
+ * put back by "cariboulite_restore_thread_config"
+ */
+typedef struct
+{
+    bool sched_saved;
+    int sched_policy;
+    int sched_priority;
+    bool cpus_saved;
+    cpu_set_t cpus;
+} cariboulite_thread_state_st;
+
 /**
  * @brief custom signal handler
  */
@@ -210,6 +248,45 @@ int cariboulite_get_frequency_limits(cariboulite_channel_en ch, float *freq_low,
  */
  int cariboulite_get_channel_name(cariboulite_channel_en ch, char* name, size_t max_len);
 
+/**
+ * @brief Apply a streaming thread configuration
+ *
+ * Applies the scheduling policy / priority and the CPU affinity to the calling
+ * thread and locks the process memory if requested. Every part that can't be
+ * applied (typically for lack of privileges - CAP_SYS_NICE / RLIMIT_MEMLOCK) is
+ * skipped with a warning and the thread keeps running as it was.
+ *
+ * @param cfg the configuration (NULL = no change)
+ * @param prev filled with the thread's previous scheduling and affinity for
+ *          "cariboulite_restore_thread_config" (may be NULL)
+ * @return 0 when everything was applied, -1 if some part was skipped
+ */
+int cariboulite_apply_thread_config(const cariboulite_thread_config_st* cfg, cariboulite_thread_state_st* prev);
+
+/**
+ * @brief Restore a thread's scheduling
+ *
+ * Puts back the scheduling policy / priority and the CPU affinity that the
+ * calling thread had before "cariboulite_apply_thread_config". The process memory
+ * lock is process wide and stays.
+ *
+ * @param prev the state saved by "cariboulite_apply_thread_config" (NULL = no change)
+ */
+void cariboulite_restore_thread_config(cariboulite_thread_state_st* prev);
+
+/**
+ * @brief Pre-fault a buffer
+ *
+ * Touches every page of a freshly allocated buffer so that the first pass of the
+ * stream doesn't take page faults. Only when "cfg->prefault_buffers" is set.
+ * The buffer contents are not preserved.
+ *
+ * @param cfg the configuration (NULL = nothing to do)
+ * @param buffer the buffer
+ * @param size the buffer size in bytes
+ */
+void cariboulite_prefault_buffer(const cariboulite_thread_config_st* cfg, void* buffer, size_t size);
+
 
 
 #ifdef __cplusplus
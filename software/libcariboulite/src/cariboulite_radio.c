@@ -10,6 +10,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
+#include <time.h>
 #include <linux/random.h>
 #include <sys/ioctl.h>
 
@@ -17,6 +18,7 @@
 #include "cariboulite_radio.h"
 #include "cariboulite_events.h"
 #include "cariboulite_setup.h"
+#include "caribou_smi/caribou_smi_pack.h"
 
 #define GET_MODEM_CH(rad_ch)	((rad_ch)==cariboulite_channel_s1g ? at86rf215_rf_channel_900mhz : at86rf215_rf_channel_2400mhz)
 #define GET_SMI_CH(rad_ch)		((rad_ch)==cariboulite_channel_s1g ? caribou_smi_channel_900 : caribou_smi_channel_2400)
@@ -52,6 +54,7 @@ int cariboulite_radio_init(cariboulite_radio_state_st* radio, sys_st *sys, carib
 int cariboulite_radio_dispose(cariboulite_radio_state_st* radio)
 {
 	cariboulite_radio_activate_channel(radio, cariboulite_channel_dir_rx, false);
+    cariboulite_radio_clear_hop_table(radio);
 
     at86rf215_radio_set_state( &radio->sys->modem, 
 								GET_MODEM_CH(radio->type), 
@@ -149,7 +152,9 @@ int cariboulite_radio_set_rx_gain_control(cariboulite_radio_state_st* radio,
         .gain_control_word = control_gain_val,
     };
 
+    at86rf215_batch_begin(&radio->sys->modem);
     at86rf215_radio_setup_agc(&radio->sys->modem, GET_MODEM_CH(radio->type), &rx_gain_control);
+    at86rf215_batch_commit(&radio->sys->modem);
     radio->rx_agc_on = rx_agc_on;
     radio->rx_gain_value_db = rx_gain_value_db;
     return 0;
@@ -200,7 +205,9 @@ int cariboulite_radio_set_rx_bandwidth(cariboulite_radio_state_st* radio,
         .fcut = (at86rf215_radio_f_cut_en)radio->rx_fcut,             // keep the same
         .fs = (at86rf215_radio_sample_rate_en)radio->rx_fs,           // keep the same
     };
+    at86rf215_batch_begin(&radio->sys->modem);
     at86rf215_radio_set_rx_bandwidth_sampling(&radio->sys->modem, GET_MODEM_CH(radio->type), &cfg);
+    at86rf215_batch_commit(&radio->sys->modem);
     radio->rx_bw = rx_bw;
     return 0;
 }
@@ -282,7 +289,9 @@ int cariboulite_radio_set_rx_samp_cutoff(cariboulite_radio_state_st* radio,
         .fcut = (at86rf215_radio_f_cut_en)rx_cutoff,
         .fs = (at86rf215_radio_sample_rate_en)rx_sample_rate,
     };
+    at86rf215_batch_begin(&radio->sys->modem);
     at86rf215_radio_set_rx_bandwidth_sampling(&radio->sys->modem, GET_MODEM_CH(radio->type), &cfg);
+    at86rf215_batch_commit(&radio->sys->modem);
     radio->rx_fs = rx_sample_rate;
     radio->rx_fcut = rx_cutoff;
     
@@ -412,7 +421,9 @@ int cariboulite_radio_set_tx_power(cariboulite_radio_state_st* radio, int tx_pow
         .direct_modulation = 0,
     };
 
+    at86rf215_batch_begin(&radio->sys->modem);
     at86rf215_radio_setup_tx_ctrl(&radio->sys->modem, GET_MODEM_CH(radio->type), &cfg);
+    at86rf215_batch_commit(&radio->sys->modem);
     radio->tx_power = tx_power_dbm;
 	
     return 0;
@@ -461,7 +472,9 @@ int cariboulite_radio_set_tx_bandwidth(cariboulite_radio_state_st* radio,
         .direct_modulation = 0,
     };
 
+    at86rf215_batch_begin(&radio->sys->modem);
     at86rf215_radio_setup_tx_ctrl(&radio->sys->modem, GET_MODEM_CH(radio->type), &cfg);
+    at86rf215_batch_commit(&radio->sys->modem);
     radio->tx_bw = tx_bw;
 
     return 0;
@@ -542,7 +555,9 @@ int cariboulite_radio_set_tx_samp_cutoff(cariboulite_radio_state_st* radio,
         .direct_modulation = 0,
     };
 
+    at86rf215_batch_begin(&radio->sys->modem);
     at86rf215_radio_setup_tx_ctrl(&radio->sys->modem, GET_MODEM_CH(radio->type), &cfg);
+    at86rf215_batch_commit(&radio->sys->modem);
     radio->tx_fcut = (cariboulite_radio_f_cut_en)tx_cutoff;
     radio->tx_fs = tx_sample_rate;
     
@@ -702,6 +717,14 @@ int cariboulite_radio_get_rand_val(cariboulite_radio_state_st* radio, uint8_t *r
 // FREQUENCY CONVERSION LOGIC
 //=================================================
 
+//=================================================
+static uint64_t cariboulite_radio_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 //=================================================
 bool cariboulite_radio_wait_mixer_lock(cariboulite_radio_state_st* radio, int retries)
 {
@@ -720,14 +743,31 @@ bool cariboulite_radio_wait_mixer_lock(cariboulite_radio_state_st* radio, int re
 		return false;
 	}
 
+	// poll the lock status with a growing delay, re-lock if it doesn't come
+	uint64_t start = cariboulite_radio_now_ns();
 	int relock_retries = retries;
-	do
+	while (1)
 	{
-		rffc507x_readback_status(&radio->sys->mixer, NULL, &stat);
-		rffc507x_print_stat(&stat);
-		if (!stat.pll_lock) rffc507x_relock(&radio->sys->mixer);
-	} while (!stat.pll_lock && relock_retries--);
+		int delay_us = 50;
+		for (int poll = 0; poll < CARIBOULITE_MIXER_LOCK_POLLS; poll++)
+		{
+			rffc507x_readback_status(&radio->sys->mixer, NULL, &stat);
+			if (stat.pll_lock) break;
+			io_utils_usleep(delay_us);
+			delay_us *= 2;
+		}
+		if (stat.pll_lock || relock_retries-- <= 0) break;
+		rffc507x_relock(&radio->sys->mixer);
+	}
 
+	if (stat.pll_lock)
+	{
+		cariboulite_latency_hist_add(&radio->tune_stats.mixer_lock_time, cariboulite_radio_now_ns() - start);
+	}
+	else
+	{
+		rffc507x_print_stat(&stat);
+	}
 	return stat.pll_lock;
 }
 
@@ -756,14 +796,33 @@ int cariboulite_radio_set_modem_state(cariboulite_radio_state_st* radio, caribou
 //=================================================
 bool cariboulite_radio_wait_modem_lock(cariboulite_radio_state_st* radio, int retries)
 {
-	at86rf215_radio_pll_ctrl_st cfg = {0};
-	int relock_retries = retries;
-	do
+	// woken up by the modem's trx_ready interrupt
+	uint64_t start = cariboulite_radio_now_ns();
+	if (at86rf215_wait_pll_lock(&radio->sys->modem, GET_MODEM_CH(radio->type),
+								(retries + 1) * CARIBOULITE_MODEM_LOCK_RETRY_USEC) != 0)
 	{
-		at86rf215_radio_get_pll_ctrl(&radio->sys->modem, GET_MODEM_CH(radio->type), &cfg);
-	} while (!cfg.pll_locked && relock_retries--);
+		return false;
+	}
+
+	cariboulite_latency_hist_add(&radio->tune_stats.modem_lock_time, cariboulite_radio_now_ns() - start);
+	return true;
+}
 
-	return cfg.pll_locked;
+//=================================================
+// account a frequency switch that started at 'start_ns'
+static void cariboulite_radio_account_tune(cariboulite_radio_state_st* radio, uint64_t start_ns, bool locked)
+{
+    cariboulite_radio_tune_stats_st* stats = &radio->tune_stats;
+    if (!locked)
+    {
+        __atomic_fetch_add(&stats->lock_failures, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint64_t duration = cariboulite_radio_now_ns() - start_ns;
+    __atomic_fetch_add(&stats->tunes, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&stats->last_tune_time_ns, duration, __ATOMIC_RELAXED);
+    cariboulite_latency_hist_add(&stats->tune_time, duration);
 }
 
 //=================================================
@@ -800,6 +859,47 @@ cariboulite_ext_ref_freq_en cariboulite_radio_find_best_ref_freq(double f)
     return f_rf_mod_32 > f_rf_mod_26 ? cariboulite_ext_ref_32mhz : cariboulite_ext_ref_26mhz;
 }
 
+//=========================================================================
+// The RF front-end path of a conversion direction for the current direction of
+// communication (full version only)
+static caribou_fpga_io_ctrl_rfm_en cariboulite_radio_conversion_fe_mode(cariboulite_radio_state_st* radio,
+                                                                    cariboulite_conversion_dir_en conversion_direction)
+{
+    bool tx = (radio->channel_direction == cariboulite_channel_dir_tx);
+    switch (conversion_direction)
+    {
+        case conversion_dir_up: return tx ? caribou_fpga_io_ctrl_rfm_tx_lowpass : caribou_fpga_io_ctrl_rfm_rx_lowpass;
+        case conversion_dir_down: return tx ? caribou_fpga_io_ctrl_rfm_tx_hipass : caribou_fpga_io_ctrl_rfm_rx_hipass;
+        case conversion_dir_none:
+        default: return caribou_fpga_io_ctrl_rfm_bypass;
+    }
+}
+
+//=========================================================================
+// Frequency hopping - every entry holds the outcome of the decisions taken by
+// 'cariboulite_radio_set_frequency', the table remembers which entry the hardware
+// was last tuned to so that a hop writes only what differs
+typedef struct
+{
+    double requested_freq;
+    double actual_freq;
+    double modem_freq;
+    double lo_freq;
+    bool mixer_chain;                           // full version HiF - reference / mixer / front-end
+    cariboulite_ext_ref_freq_en ext_ref;
+    cariboulite_conversion_dir_en conversion_dir;
+    at86rf215_radio_channel_plan_st modem_plan;
+    rffc507x_freq_plan_st mixer_plan;
+} cariboulite_hop_entry_st;
+
+struct cariboulite_hop_table_st
+{
+    cariboulite_hop_entry_st* entries;
+    size_t num_entries;
+    int last;                                   // the entry last hopped to (-1 = unknown)
+    caribou_fpga_io_ctrl_rfm_en fe_mode;        // the front-end mode it left
+};
+
 #define FREQ_IN_ISM_S1G_RANGE(f)  (((f)>=CARIBOULITE_S1G_MIN1&&(f)<=CARIBOULITE_S1G_MAX1)||((f)>=CARIBOULITE_S1G_MIN2&&(f)<=CARIBOULITE_S1G_MAX2))
 #define FREQ_IN_ISM_24G_RANGE(f)  ((f)>=CARIBOULITE_2G4_MIN&&(f)<=CARIBOULITE_2G4_MAX)
 
@@ -808,6 +908,7 @@ int cariboulite_radio_set_frequency(cariboulite_radio_state_st* radio,
 									bool break_before_make,
 									double *freq)
 {
+    uint64_t tune_start = cariboulite_radio_now_ns();
     double f_rf = *freq;
     double modem_act_freq = 0.0;
     double lo_act_freq = 0.0;
@@ -815,6 +916,9 @@ int cariboulite_radio_set_frequency(cariboulite_radio_state_st* radio,
     cariboulite_ext_ref_freq_en ext_ref_choice = cariboulite_radio_find_best_ref_freq(f_rf);
     cariboulite_conversion_dir_en conversion_direction = conversion_dir_none;
 
+    // the hardware no longer matches the last hop
+    if (radio->hop_table) radio->hop_table->last = -1;
+
     //--------------------------------------------------------------------------------
     // SUB 1GHZ CONFIGURATION
     //--------------------------------------------------------------------------------
@@ -965,39 +1069,15 @@ int cariboulite_radio_set_frequency(cariboulite_radio_state_st* radio,
         // Setup the frontend
         // This step takes the current radio direction of communication
         // and the down/up conversion decision made before to setup the RF front-end
-        switch (conversion_direction)
-        {
-            case conversion_dir_up: 
-                if (radio->channel_direction == cariboulite_channel_dir_rx) 
-                {
-                    caribou_fpga_set_io_ctrl_mode (&radio->sys->fpga, 0, caribou_fpga_io_ctrl_rfm_rx_lowpass);
-                }
-                else if (radio->channel_direction == cariboulite_channel_dir_tx)
-                {
-                    caribou_fpga_set_io_ctrl_mode (&radio->sys->fpga, 0, caribou_fpga_io_ctrl_rfm_tx_lowpass);
-                }
-                break;
-            case conversion_dir_none: 
-                caribou_fpga_set_io_ctrl_mode (&radio->sys->fpga, 0, caribou_fpga_io_ctrl_rfm_bypass);
-                break;
-            case conversion_dir_down:
-                if (radio->channel_direction == cariboulite_channel_dir_rx)
-                {
-                    caribou_fpga_set_io_ctrl_mode (&radio->sys->fpga, 0, caribou_fpga_io_ctrl_rfm_rx_hipass);
-                }
-                else if (radio->channel_direction == cariboulite_channel_dir_tx)
-                {
-                    caribou_fpga_set_io_ctrl_mode (&radio->sys->fpga, 0, caribou_fpga_io_ctrl_rfm_tx_hipass);
-                }
-                break;
-            default: break;
-        }
+        caribou_fpga_set_io_ctrl_mode (&radio->sys->fpga, 0, cariboulite_radio_conversion_fe_mode(radio, conversion_direction));
 
         // Make sure the LO and the IF PLLs are locked
         cariboulite_radio_set_modem_state(radio, cariboulite_radio_state_cmd_tx_prep);
-        if (!cariboulite_radio_wait_for_lock(radio, &radio->modem_pll_locked, 
+        bool locked = cariboulite_radio_wait_for_lock(radio, &radio->modem_pll_locked, 
                                             lo_act_freq > CARIBOULITE_MIN_LO ? &radio->lo_pll_locked : NULL, 
-                                            100))
+                                            100);
+        cariboulite_radio_account_tune(radio, tune_start, locked);
+        if (!locked)
         {
             if (!radio->lo_pll_locked) ZF_LOGE("PLL MIXER failed to lock LO frequency (%.2f Hz), deactivating", lo_act_freq);
             if (!radio->modem_pll_locked) ZF_LOGE("PLL MODEM failed to lock IF frequency (%.2f Hz), deactivating", modem_act_freq);
@@ -1021,6 +1101,215 @@ int cariboulite_radio_set_frequency(cariboulite_radio_state_st* radio,
     return cariboulite_radio_activate_channel(radio, radio->channel_direction, radio->active);
 }
 
+//=========================================================================
+static int cariboulite_radio_plan_hop(cariboulite_radio_state_st* radio, double f_rf, cariboulite_hop_entry_st* entry)
+{
+    memset(entry, 0, sizeof(cariboulite_hop_entry_st));
+    entry->requested_freq = f_rf;
+    entry->conversion_dir = conversion_dir_none;
+    entry->ext_ref = cariboulite_ext_ref_off;
+
+    if (radio->type == cariboulite_channel_s1g)
+    {
+        if (!FREQ_IN_ISM_S1G_RANGE(f_rf) || 
+            at86rf215_radio_plan_channel(at86rf215_rf_channel_900mhz, (uint64_t)f_rf, &entry->modem_plan) != 0)
+        {
+            return -1;
+        }
+        entry->modem_freq = entry->modem_plan.actual_freq_hz;
+        entry->actual_freq = entry->modem_freq;
+        return 0;
+    }
+
+    if (radio->type == cariboulite_channel_hif && 
+        radio->sys->board_info.numeric_product_id == system_type_cariboulite_ism)
+    {
+        if (!FREQ_IN_ISM_24G_RANGE(f_rf) || 
+            at86rf215_radio_plan_channel(at86rf215_rf_channel_2400mhz, (uint64_t)f_rf, &entry->modem_plan) != 0)
+        {
+            return -1;
+        }
+        entry->modem_freq = entry->modem_plan.actual_freq_hz;
+        entry->actual_freq = entry->modem_freq;
+        return 0;
+    }
+
+    if (radio->type != cariboulite_channel_hif || 
+        radio->sys->board_info.numeric_product_id != system_type_cariboulite_full)
+    {
+        return -1;
+    }
+
+    // the same regions as 'cariboulite_radio_set_frequency'
+    entry->mixer_chain = true;
+    double modem_freq = 0.0;
+    if (f_rf >= CARIBOULITE_6G_MIN && f_rf < CARIBOULITE_2G4_MIN)
+    {
+        entry->conversion_dir = conversion_dir_up;
+        modem_freq = CARIBOULITE_2G4_MAX;
+    }
+    else if (f_rf >= CARIBOULITE_2G4_MIN && f_rf < CARIBOULITE_2G4_MAX)
+    {
+        entry->conversion_dir = conversion_dir_none;
+        modem_freq = f_rf;
+    }
+    else if (f_rf >= CARIBOULITE_2G4_MAX && f_rf < CARIBOULITE_6G_MAX)
+    {
+        entry->conversion_dir = conversion_dir_down;
+        modem_freq = CARIBOULITE_2G4_MIN;
+    }
+    else
+    {
+        return -1;
+    }
+
+    if (at86rf215_radio_plan_channel(at86rf215_rf_channel_2400mhz, (uint64_t)modem_freq, &entry->modem_plan) != 0)
+    {
+        return -1;
+    }
+    entry->modem_freq = entry->modem_plan.actual_freq_hz;
+
+    if (entry->conversion_dir == conversion_dir_none)
+    {
+        entry->actual_freq = entry->modem_freq;
+        return 0;
+    }
+
+    entry->ext_ref = cariboulite_radio_find_best_ref_freq(f_rf);
+    double ref_hz = (entry->ext_ref == cariboulite_ext_ref_26mhz) ? 26e6 : 32e6;
+    if (entry->conversion_dir == conversion_dir_up)
+    {
+        rffc507x_plan_frequency(ref_hz, entry->modem_freq + f_rf, &entry->mixer_plan);
+        entry->lo_freq = entry->mixer_plan.act_freq_hz;
+        entry->actual_freq = entry->lo_freq - entry->modem_freq;
+    }
+    else
+    {
+        rffc507x_plan_frequency(ref_hz, f_rf - entry->modem_freq, &entry->mixer_plan);
+        entry->lo_freq = entry->mixer_plan.act_freq_hz;
+        entry->actual_freq = entry->lo_freq + entry->modem_freq;
+    }
+    return 0;
+}
+
+//=========================================================================
+int cariboulite_radio_prepare_hop_table(cariboulite_radio_state_st* radio, 
+                                    const double* freqs, size_t num_freqs)
+{
+    cariboulite_radio_clear_hop_table(radio);
+    if (freqs == NULL || num_freqs == 0)
+    {
+        ZF_LOGE("empty hop table");
+        return -1;
+    }
+
+    struct cariboulite_hop_table_st* table = malloc(sizeof(struct cariboulite_hop_table_st));
+    cariboulite_hop_entry_st* entries = malloc(num_freqs * sizeof(cariboulite_hop_entry_st));
+    if (table == NULL || entries == NULL)
+    {
+        ZF_LOGE("hop table allocation failed");
+        free(table);
+        free(entries);
+        return -1;
+    }
+
+    for (size_t i = 0; i < num_freqs; i++)
+    {
+        if (cariboulite_radio_plan_hop(radio, freqs[i], &entries[i]) != 0)
+        {
+            ZF_LOGE("Unsupported hop frequency for channel %d - #%d: %.2f Hz", radio->type, (int)i, freqs[i]);
+            free(table);
+            free(entries);
+            return -1;
+        }
+    }
+
+    table->entries = entries;
+    table->num_entries = num_freqs;
+    table->last = -1;
+    table->fe_mode = caribou_fpga_io_ctrl_rfm_low_power;
+    radio->hop_table = table;
+    return 0;
+}
+
+//=========================================================================
+int cariboulite_radio_hop(cariboulite_radio_state_st* radio, size_t index, bool wait_lock)
+{
+    uint64_t hop_start = cariboulite_radio_now_ns();
+    struct cariboulite_hop_table_st* table = radio->hop_table;
+    if (table == NULL || index >= table->num_entries)
+    {
+        ZF_LOGE("no hop table entry %d", (int)index);
+        return -1;
+    }
+
+    cariboulite_hop_entry_st* entry = &table->entries[index];
+    cariboulite_hop_entry_st* prev = (table->last >= 0) ? &table->entries[table->last] : NULL;
+
+    // the whole chain is set up only when the reference / conversion direction change
+    bool region_change = (prev == NULL || prev->ext_ref != entry->ext_ref || prev->conversion_dir != entry->conversion_dir);
+    if (entry->mixer_chain && region_change)
+    {
+        cariboulite_radio_ext_ref (radio->sys, entry->ext_ref);
+        if (entry->conversion_dir != conversion_dir_none) rffc507x_calibrate(&radio->sys->mixer);
+        caribou_smi_invert_iq(&radio->sys->smi, true);
+    }
+
+    // modem channel - a single burst, skipped when the modem stays put (the mixer
+    // regions use a fixed IF)
+    if (prev == NULL || memcmp(prev->modem_plan.regs, entry->modem_plan.regs, sizeof(entry->modem_plan.regs)) != 0)
+    {
+        at86rf215_radio_apply_channel_plan(&radio->sys->modem, &entry->modem_plan);
+    }
+
+    if (entry->mixer_chain)
+    {
+        if (entry->conversion_dir != conversion_dir_none)
+        {
+            rffc507x_apply_frequency_plan(&radio->sys->mixer, &entry->mixer_plan);
+        }
+
+        caribou_fpga_io_ctrl_rfm_en fe_mode = cariboulite_radio_conversion_fe_mode(radio, entry->conversion_dir);
+        if (region_change || fe_mode != table->fe_mode)
+        {
+            caribou_fpga_set_io_ctrl_mode (&radio->sys->fpga, 0, fe_mode);
+            table->fe_mode = fe_mode;
+        }
+    }
+    table->last = index;
+
+    radio->lo_frequency = entry->lo_freq;
+    radio->if_frequency = entry->modem_freq;
+    radio->actual_rf_frequency = entry->actual_freq;
+    radio->requested_rf_frequency = entry->requested_freq;
+    radio->rf_frequency_error = radio->actual_rf_frequency - radio->requested_rf_frequency;
+    if (!entry->mixer_chain || entry->conversion_dir == conversion_dir_none) radio->lo_pll_locked = true;
+
+    // the PLLs run only while the channel is active
+    if (wait_lock && radio->active)
+    {
+        bool locked = cariboulite_radio_wait_for_lock(radio, &radio->modem_pll_locked, 
+                                            entry->lo_freq > CARIBOULITE_MIN_LO ? &radio->lo_pll_locked : NULL, 
+                                            100);
+        cariboulite_radio_account_tune(radio, hop_start, locked);
+        if (!locked)
+        {
+            ZF_LOGE("PLLs failed to lock on hop #%d (%.2f Hz)", (int)index, entry->requested_freq);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+//=========================================================================
+void cariboulite_radio_clear_hop_table(cariboulite_radio_state_st* radio)
+{
+    if (radio->hop_table == NULL) return;
+    free(radio->hop_table->entries);
+    free(radio->hop_table);
+    radio->hop_table = NULL;
+}
+
 //=========================================================================
 int cariboulite_radio_get_frequency(cariboulite_radio_state_st* radio, 
                                 	double *freq, double *lo, double* i_f)
@@ -1097,6 +1386,8 @@ int cariboulite_radio_activate_channel(cariboulite_radio_state_st* radio,
             .radio24_mode = at86rf215_iq_if_mode,
             .clock_skew = at86rf215_iq_clock_data_skew_4_906ns,
         };
+        // the interface setup and the RX command go out in one spi transfer
+        at86rf215_batch_begin(&radio->sys->modem);
         at86rf215_setup_iq_if(&radio->sys->modem, &modem_iq_config);	
                 
         // configure FPGA with the correct rx channel
@@ -1105,6 +1396,7 @@ int cariboulite_radio_activate_channel(cariboulite_radio_state_st* radio,
         
         // turn on the modem RX
         cariboulite_radio_set_modem_state(radio, cariboulite_radio_state_cmd_rx);
+        at86rf215_batch_commit(&radio->sys->modem);
         
         // turn on the SMI stream
         if (caribou_smi_set_driver_streaming_state(&radio->sys->smi, smi_state) != 0)
@@ -1152,6 +1444,7 @@ int cariboulite_radio_activate_channel(cariboulite_radio_state_st* radio,
 				rffc507x_output_lo(&radio->sys->mixer, 0);
 			}
 
+            at86rf215_batch_begin(&radio->sys->modem);
             cariboulite_radio_set_tx_bandwidth(radio, cariboulite_radio_tx_cut_off_80khz);
 
             // CW output - constant I/Q values override
@@ -1162,12 +1455,14 @@ int cariboulite_radio_activate_channel(cariboulite_radio_state_st* radio,
 
             // transition to state TX
             cariboulite_radio_set_modem_state(radio, cariboulite_radio_state_cmd_tx); 
+            at86rf215_batch_commit(&radio->sys->modem);
         }
 		else
         {
             ZF_LOGD("Transmitting with iq");
             cariboulite_radio_set_modem_state(radio, cariboulite_radio_state_cmd_tx_prep); 
             
+            at86rf215_batch_begin(&radio->sys->modem);
             cariboulite_radio_set_tx_bandwidth(radio, radio->tx_bw);
             
             // CW output - disable
@@ -1175,6 +1470,7 @@ int cariboulite_radio_activate_channel(cariboulite_radio_state_st* radio,
                                                 GET_MODEM_CH(radio->type), 
                                                 0, 0x7E, 
                                                 0, 0x3F);
+            at86rf215_batch_commit(&radio->sys->modem);
             
             // apply the state
             caribou_smi_set_driver_streaming_state(&radio->sys->smi, smi_stream_tx_channel);            
@@ -1185,6 +1481,50 @@ int cariboulite_radio_activate_channel(cariboulite_radio_state_st* radio,
     return 0;
 }
 
+//=========================================================================
+int cariboulite_radio_activate_rx_dual(cariboulite_radio_state_st* radio_s1g,
+                                        cariboulite_radio_state_st* radio_hif,
+                                        bool activate)
+{
+    sys_st* sys = radio_s1g->sys;
+    
+    // DEACTIVATION
+    if (!activate)
+    {
+        caribou_fpga_set_smi_rx_dual(&sys->fpga, false);
+        cariboulite_radio_activate_channel(radio_hif, cariboulite_channel_dir_rx, false);
+        return cariboulite_radio_activate_channel(radio_s1g, cariboulite_channel_dir_rx, false);
+    }
+    
+    // bring up both modems in RX - the smi stream is reconfigured below
+    if (cariboulite_radio_activate_channel(radio_s1g, cariboulite_channel_dir_rx, true) != 0 ||
+        cariboulite_radio_activate_channel(radio_hif, cariboulite_channel_dir_rx, true) != 0)
+    {
+        ZF_LOGE("failed activating the rx channels for dual rx");
+        cariboulite_radio_activate_rx_dual(radio_s1g, radio_hif, false);
+        return -1;
+    }
+    
+    // older firmware ignores the request and keeps reporting a single channel
+    caribou_fpga_smi_fifo_status_st status = {0};
+    caribou_fpga_set_smi_rx_dual(&sys->fpga, true);
+    caribou_fpga_get_smi_ctrl_fifo_status(&sys->fpga, &status);
+    if (!status.rx_dual)
+    {
+        ZF_LOGE("the loaded firmware doesn't support dual rx");
+        cariboulite_radio_activate_rx_dual(radio_s1g, radio_hif, false);
+        return -1;
+    }
+    
+    if (caribou_smi_set_driver_streaming_state(&sys->smi, smi_stream_rx_dual) != 0)
+    {
+        ZF_LOGE("the smi driver doesn't support dual rx");
+        cariboulite_radio_activate_rx_dual(radio_s1g, radio_hif, false);
+        return -1;
+    }
+    return 0;
+}
+
 //=========================================================================
 int cariboulite_radio_set_cw_outputs(cariboulite_radio_state_st* radio, bool lo_out, bool cw_out)
 {
@@ -1213,19 +1553,8 @@ int cariboulite_radio_get_cw_outputs(cariboulite_radio_state_st* radio, bool *lo
 //=========================================================================
 // I/O Functions
 //=========================================================================
-int cariboulite_radio_read_samples(cariboulite_radio_state_st* radio,
-                            cariboulite_sample_complex_int16* buffer,
-                            cariboulite_sample_meta* metadata,
-                            size_t length)
+static int cariboulite_radio_check_read_result(int ret)
 {
-    int ret = 0;
-      
-    // CaribouSMI read   
-    ret = caribou_smi_read( &radio->sys->smi, 
-                            radio->smi_channel_id, 
-                            (caribou_smi_sample_complex_int16*)buffer, 
-                            (caribou_smi_sample_meta*)metadata, 
-                            length);
     if (ret < 0)
     {
         // -2 reserved for debug mode
@@ -1235,10 +1564,69 @@ int cariboulite_radio_read_samples(cariboulite_radio_state_st* radio,
     {
         ZF_LOGD("SMI reading operation returned timeout");
     }
-    
     return ret;
 }
 
+//=========================================================================
+int cariboulite_radio_read_samples(cariboulite_radio_state_st* radio,
+                            cariboulite_sample_complex_int16* buffer,
+                            cariboulite_sample_meta* metadata,
+                            size_t length)
+{
+    // CaribouSMI read   
+    int ret = caribou_smi_read( &radio->sys->smi, 
+                                radio->smi_channel_id, 
+                                (caribou_smi_sample_complex_int16*)buffer, 
+                                (caribou_smi_sample_meta*)metadata, 
+                                length);
+    return cariboulite_radio_check_read_result(ret);
+}
+
+//=========================================================================
+int cariboulite_radio_read_samples_cf32(cariboulite_radio_state_st* radio,
+                            cariboulite_sample_complex_float* buffer,
+                            cariboulite_sample_meta* metadata,
+                            size_t length)
+{
+    int ret = caribou_smi_read_cf32(&radio->sys->smi, 
+                                    radio->smi_channel_id, 
+                                    (caribou_smi_sample_complex_float*)buffer, 
+                                    (caribou_smi_sample_meta*)metadata, 
+                                    length);
+    return cariboulite_radio_check_read_result(ret);
+}
+
+//=========================================================================
+int cariboulite_radio_read_samples_cf64(cariboulite_radio_state_st* radio,
+                            cariboulite_sample_complex_double* buffer,
+                            cariboulite_sample_meta* metadata,
+                            size_t length)
+{
+    int ret = caribou_smi_read_cf64(&radio->sys->smi, 
+                                    radio->smi_channel_id, 
+                                    (caribou_smi_sample_complex_double*)buffer, 
+                                    (caribou_smi_sample_meta*)metadata, 
+                                    length);
+    return cariboulite_radio_check_read_result(ret);
+}
+
+//=========================================================================
+int cariboulite_radio_read_samples_dual(cariboulite_radio_state_st* radio,
+                            cariboulite_sample_format_en format,
+                            void* buffers[2],
+                            cariboulite_sample_meta* metadata[2],
+                            size_t length,
+                            size_t counts[2])
+{
+    int ret = caribou_smi_read_dual(&radio->sys->smi, 
+                                    (caribou_smi_sample_format_en)format, 
+                                    buffers, 
+                                    (caribou_smi_sample_meta**)metadata, 
+                                    length, 
+                                    counts);
+    return cariboulite_radio_check_read_result(ret);
+}
+
 //=========================================================================
 int cariboulite_radio_write_samples(cariboulite_radio_state_st* radio,
                             cariboulite_sample_complex_int16* buffer,
@@ -1261,6 +1649,117 @@ int cariboulite_radio_write_samples(cariboulite_radio_state_st* radio,
     return ret;
 }
 
+//=========================================================================
+void cariboulite_radio_pack_samples(cariboulite_radio_state_st* radio,
+                            const cariboulite_sample_complex_int16* buffer,
+                            uint32_t* packed,
+                            size_t length)
+{
+    caribou_smi_pack_tx(&radio->sys->smi, packed, (const caribou_smi_sample_complex_int16*)buffer, length);
+}
+
+//=========================================================================
+void cariboulite_radio_pack_samples_cf32(cariboulite_radio_state_st* radio,
+                            const cariboulite_sample_complex_float* buffer,
+                            uint32_t* packed,
+                            size_t length)
+{
+    (void)radio;
+    caribou_smi_pack_cf32((const caribou_smi_sample_complex_float*)buffer, length, packed);
+}
+
+//=========================================================================
+void cariboulite_radio_pack_samples_cf64(cariboulite_radio_state_st* radio,
+                            const cariboulite_sample_complex_double* buffer,
+                            uint32_t* packed,
+                            size_t length)
+{
+    (void)radio;
+    caribou_smi_pack_cf64((const caribou_smi_sample_complex_double*)buffer, length, packed);
+}
+
+//=========================================================================
+int cariboulite_radio_write_packed_samples(cariboulite_radio_state_st* radio,
+                            const uint32_t* packed,
+                            size_t length)
+{
+    int ret = caribou_smi_write_packed(&radio->sys->smi, packed, length);
+    if (ret < 0)
+    {
+        ZF_LOGE("SMI writing operation failed");
+    }
+    else if (ret == 0)
+    {
+        ZF_LOGD("SMI writing operation returned timeout");
+    }
+    return ret;
+}
+
+//=========================================================================
+int cariboulite_radio_get_rx_info(cariboulite_radio_state_st* radio, cariboulite_radio_rx_info_st* info)
+{
+    caribou_smi_rx_info_st smi_info;
+    info->sample_rate = radio->sys->smi.sample_rate;
+    if (caribou_smi_get_rx_info(&radio->sys->smi, &smi_info) != 0)
+    {
+        return -1;
+    }
+
+    info->timestamp_ns = smi_info.timestamp_ns;
+    info->sample_index = smi_info.sample_index;
+    info->lost_samples = smi_info.lost_samples;
+    return 0;
+}
+
+//=========================================================================
+static void cariboulite_radio_copy_hist(cariboulite_latency_hist_st* dst, const caribou_smi_latency_hist_st* src)
+{
+    for (int i = 0; i < CARIBOULITE_LATENCY_BINS; i++) dst->bins[i] = src->bins[i];
+    dst->count = src->count;
+    dst->total_ns = src->total_ns;
+    dst->max_ns = src->max_ns;
+}
+
+//=========================================================================
+int cariboulite_radio_get_stream_stats(cariboulite_radio_state_st* radio, cariboulite_radio_stream_stats_st* stats)
+{
+    caribou_smi_stream_stats_st smi_stats;
+    caribou_smi_get_stream_stats(&radio->sys->smi, &smi_stats);
+
+    stats->read_calls = smi_stats.read_calls;
+    stats->samples_delivered = smi_stats.samples_delivered;
+    stats->resyncs = smi_stats.resyncs;
+    stats->resync_dropped_samples = smi_stats.resync_dropped_bytes / CARIBOU_SMI_BYTES_PER_SAMPLE;
+    stats->read_timeouts = smi_stats.read_timeouts;
+    stats->kernel_dropped_samples = smi_stats.kernel_dropped_bytes / CARIBOU_SMI_BYTES_PER_SAMPLE;
+    stats->ring_dropped_samples = smi_stats.ring_dropped_bytes / CARIBOU_SMI_BYTES_PER_SAMPLE;
+    cariboulite_radio_copy_hist(&stats->read_latency, &smi_stats.read_latency);
+    return 0;
+}
+
+//=========================================================================
+int cariboulite_radio_get_tune_stats(cariboulite_radio_state_st* radio, cariboulite_radio_tune_stats_st* stats)
+{
+    // member by member - the tuning thread may be updating it
+    const uint64_t* src = (const uint64_t*)&radio->tune_stats;
+    uint64_t* dst = (uint64_t*)stats;
+    for (size_t i = 0; i < sizeof(cariboulite_radio_tune_stats_st) / sizeof(uint64_t); i++)
+    {
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+//=========================================================================
+_Static_assert(sizeof(cariboulite_latency_hist_st) == sizeof(caribou_smi_latency_hist_st),
+                "the radio and smi latency histograms must share their layout");
+
+void cariboulite_latency_hist_add(cariboulite_latency_hist_st* hist, uint64_t duration_ns)
+{
+    // same layout as the smi histogram
+    caribou_smi_latency_hist_add((caribou_smi_latency_hist_st*)hist, duration_ns);
+}
+
 //=========================================================================
 size_t cariboulite_radio_get_native_mtu_size_samples(cariboulite_radio_state_st* radio)
 {
@@ -15,6 +15,7 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @brief Radio channel direction
@@ -122,11 +123,91 @@ typedef struct __attribute__((__packed__))
 	int16_t q;                      // MSB
 } cariboulite_sample_complex_int16;
 
+typedef struct __attribute__((__packed__))
+{
+    float i;                        // LSB
+    float q;                        // MSB
+} cariboulite_sample_complex_float;
+
+typedef struct __attribute__((__packed__))
+{
+    double i;                       // LSB
+    double q;                       // MSB
+} cariboulite_sample_complex_double;
+
 typedef struct __attribute__((__packed__))
 {
     uint8_t sync;
 } cariboulite_sample_meta;
 
+// Output format of "cariboulite_radio_read_samples_dual" (matches caribou_smi_sample_format_en)
+typedef enum
+{
+    cariboulite_sample_format_ci16 = 0,     // cariboulite_sample_complex_int16
+    cariboulite_sample_format_cf32 = 1,     // cariboulite_sample_complex_float
+    cariboulite_sample_format_cf64 = 2,     // cariboulite_sample_complex_double
+} cariboulite_sample_format_en;
+
+// Timing of the first sample returned by the last read (see "cariboulite_radio_get_rx_info")
+typedef struct
+{
+    uint64_t timestamp_ns;          // CLOCK_MONOTONIC
+    uint64_t sample_index;          // position in the stream, lost samples included
+    uint64_t lost_samples;          // total lost - driver overflows and resynchronization
+    uint32_t sample_rate;           // the rate used to derive the timestamp
+} cariboulite_radio_rx_info_st;
+
+// The stats structures are made of 64 bit words only - the snapshots copy them
+// a word at a time with atomic loads
+#ifdef __cplusplus
+    #define CARIBOULITE_STATS_WORDS(T)      static_assert(sizeof(T) % sizeof(uint64_t) == 0, #T " must be made of 64 bit words")
+#else
+    #define CARIBOULITE_STATS_WORDS(T)      _Static_assert(sizeof(T) % sizeof(uint64_t) == 0, #T " must be made of 64 bit words")
+#endif
+
+// Duration histogram - bin 'n' counts the durations in [2^n, 2^(n+1)) usec, the
+// first bin also takes the shorter ones and the last bin the longer ones
+#define CARIBOULITE_LATENCY_BINS        (16)
+
+typedef struct
+{
+    uint64_t bins[CARIBOULITE_LATENCY_BINS];
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} cariboulite_latency_hist_st;
+CARIBOULITE_STATS_WORDS(cariboulite_latency_hist_st);
+
+// RX stream accounting since the device was opened (see "cariboulite_radio_get_stream_stats")
+typedef struct
+{
+    uint64_t read_calls;
+    uint64_t samples_delivered;
+    uint64_t resyncs;                       // word (re)synchronizations of the SMI stream
+    uint64_t resync_dropped_samples;        // discarded while out of word sync
+    uint64_t read_timeouts;
+    uint64_t kernel_dropped_samples;        // lost in the driver (fifo / ring full)
+    uint64_t ring_dropped_samples;          // overwritten in the rx ring before consumed
+    cariboulite_latency_hist_st read_latency;   // time spent waiting for the driver
+} cariboulite_radio_stream_stats_st;
+CARIBOULITE_STATS_WORDS(cariboulite_radio_stream_stats_st);
+
+// Frequency switching accounting per radio (see "cariboulite_radio_get_tune_stats")
+typedef struct
+{
+    uint64_t tunes;                                 // frequency changes / hops that waited for lock
+    uint64_t lock_failures;
+    uint64_t last_tune_time_ns;
+    cariboulite_latency_hist_st tune_time;          // frequency request => all the PLLs locked
+    cariboulite_latency_hist_st modem_lock_time;    // waiting for the modem PLL
+    cariboulite_latency_hist_st mixer_lock_time;    // waiting for the mixer LO PLL
+} cariboulite_radio_tune_stats_st;
+CARIBOULITE_STATS_WORDS(cariboulite_radio_tune_stats_st);
+
+// PLL lock waiting
+#define CARIBOULITE_MODEM_LOCK_RETRY_USEC   (100)   // modem lock timeout per retry
+#define CARIBOULITE_MIXER_LOCK_POLLS        (5)     // mixer status polls (50usec doubling) per relock
+
 
 // Frequency Ranges
 #define CARIBOULITE_6G_MIN      (1.0e6)
@@ -147,6 +228,9 @@ typedef enum
     conversion_dir_down = 2,
 } cariboulite_conversion_dir_en;
 
+// Precomputed frequency hop plan (see "cariboulite_radio_prepare_hop_table")
+struct cariboulite_hop_table_st;
+
 // Radio Struct
 typedef struct
 {
@@ -187,6 +271,8 @@ typedef struct
     double                              actual_rf_frequency;
     double                              requested_rf_frequency;
     double                              rf_frequency_error;
+    struct cariboulite_hop_table_st*    hop_table;
+    cariboulite_radio_tune_stats_st     tune_stats;
 
     // SMI STREAMS
     int                                 smi_channel_id;
@@ -489,6 +575,9 @@ int cariboulite_radio_get_rand_val(cariboulite_radio_state_st* radio, uint8_t *r
  * In the modem this function waits for a safe completion of frequency switch. Until
  * the modem indicates that the frequency was correctly set, the frequency switch should
  * not be takes as granted.
+ * The modem wait is woken up by its "transceiver ready" interrupt and gives up after
+ * retries x CARIBOULITE_MODEM_LOCK_RETRY_USEC. The mixer status is polled with a
+ * growing delay and the PLL is re-locked up to 'retries' times.
  *
  * @param radio a pre-allocated radio state structure
  * @param retries number of retries (typically up ot 5)
@@ -516,6 +605,45 @@ int cariboulite_radio_set_frequency(cariboulite_radio_state_st* radio,
 									bool break_before_make,
 									double *freq);
 
+/**
+ * @brief Prepare a frequency hop table
+ *
+ * Works out everything "cariboulite_radio_set_frequency" would for each of the given
+ * frequencies - the reference, the conversion direction and front-end mode, the modem
+ * channel registers and the mixer synthesizer words - so that hopping between them
+ * with "cariboulite_radio_hop" is only the register writes that differ. Replaces the
+ * previous table of the radio.
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param freqs the frequencies in Hz
+ * @param num_freqs the number of frequencies (table indices 0..num_freqs-1)
+ * @return 0 = success, -1 = failure (a frequency is out of the channel's range)
+ */
+int cariboulite_radio_prepare_hop_table(cariboulite_radio_state_st* radio, 
+                                    const double* freqs, size_t num_freqs);
+
+/**
+ * @brief Hop to a prepared frequency
+ *
+ * Retunes to an entry of the hop table without breaking the current activity. Only
+ * the first hop and hops that change the reference / conversion direction set up the
+ * whole chain, otherwise only the modem channel burst or the mixer synthesizer words
+ * are written. The radio's frequency information is updated as by a frequency set.
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param index the table index
+ * @param wait_lock poll the PLLs until locked (otherwise returns right after the writes)
+ * @return 0 = success, -1 = failure (no such entry or the PLLs didn't lock)
+ */
+int cariboulite_radio_hop(cariboulite_radio_state_st* radio, size_t index, bool wait_lock);
+
+/**
+ * @brief Release the hop table
+ *
+ * @param radio a pre-allocated radio state structure
+ */
+void cariboulite_radio_clear_hop_table(cariboulite_radio_state_st* radio);
+
 /**
  * @brief Get current actual frequency
  *
@@ -546,6 +674,24 @@ int cariboulite_radio_activate_channel(cariboulite_radio_state_st* radio,
                                             cariboulite_channel_dir_en dir,
                                 			bool active);
 
+/**
+ * @brief Activate both channels for simultaneous reception
+ *
+ * Activates the S1G and HiF channels in Rx and switches the FPGA and the SMI stream
+ * to the dual rx mode, in which the samples of both channels are interleaved in a
+ * single stream (tagged by channel) and read by "cariboulite_radio_read_samples_dual".
+ * Requires a firmware and a driver that support the dual mode. While active, the
+ * single channel read functions fail.
+ *
+ * @param radio_s1g the S1G radio state structure
+ * @param radio_hif the HiF radio state structure
+ * @param activate either true for activation or false for deactivation (of both)
+ * @return 0 = success, -1 = failure (not supported or channel activation failed)
+ */
+int cariboulite_radio_activate_rx_dual(cariboulite_radio_state_st* radio_s1g,
+                                        cariboulite_radio_state_st* radio_hif,
+                                        bool activate);
+
 /**
  * @brief Set up a CW output upon activation
  *
@@ -593,7 +739,66 @@ int cariboulite_radio_read_samples(cariboulite_radio_state_st* radio,
                             cariboulite_sample_complex_int16* buffer,
                             cariboulite_sample_meta* metadata,
                             size_t length);
+
+/**
+ * @brief Read samples as floating point
+ *
+ * Same as "cariboulite_radio_read_samples" but the raw SMI words are decoded directly
+ * into scaled (sample / 4096.0) interleaved I/Q floats in a single pass, without
+ * an intermediate native buffer. The layout of "cariboulite_sample_complex_float"
+ * is compatible with std::complex<float> / CF32.
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param buffer a pre-allocated buffer of complex float samples
+ * @param metadata a pre-allocated metadata buffer
+ * @param length the number of I/Q samples to read
+ * @return the number of samples read
+ */
+int cariboulite_radio_read_samples_cf32(cariboulite_radio_state_st* radio,
+                            cariboulite_sample_complex_float* buffer,
+                            cariboulite_sample_meta* metadata,
+                            size_t length);
+
+/**
+ * @brief Read samples as double precision floating point
+ *
+ * The double precision (CF64) variant of "cariboulite_radio_read_samples_cf32"
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param buffer a pre-allocated buffer of complex double samples
+ * @param metadata a pre-allocated metadata buffer
+ * @param length the number of I/Q samples to read
+ * @return the number of samples read
+ */
+int cariboulite_radio_read_samples_cf64(cariboulite_radio_state_st* radio,
+                            cariboulite_sample_complex_double* buffer,
+                            cariboulite_sample_meta* metadata,
+                            size_t length);
                             
+/**
+ * @brief Read samples of both channels (dual rx)
+ *
+ * Reads up to "length" samples in total from the dual rx stream (see
+ * "cariboulite_radio_activate_rx_dual") and demultiplexes them, in a single pass,
+ * into per-channel buffers indexed by cariboulite_channel_en (S1G = 0, HiF = 1).
+ * Each buffer (and metadata buffer) must hold "length" samples as the split between
+ * the channels isn't known in advance - at equal sample rates it is about half each.
+ *
+ * @param radio either of the radio state structures
+ * @param format the sample format of both buffers
+ * @param buffers two pre-allocated sample buffers (either may be NULL to drop the channel)
+ * @param metadata two pre-allocated metadata buffers (either may be NULL)
+ * @param length the total number of samples to read
+ * @param counts the number of samples written to each buffer
+ * @return the total number of samples read
+ */
+int cariboulite_radio_read_samples_dual(cariboulite_radio_state_st* radio,
+                            cariboulite_sample_format_en format,
+                            void* buffers[2],
+                            cariboulite_sample_meta* metadata[2],
+                            size_t length,
+                            size_t counts[2]);
+
 /**
  * @brief Write samples
  *
@@ -608,6 +813,124 @@ int cariboulite_radio_write_samples(cariboulite_radio_state_st* radio,
                             cariboulite_sample_complex_int16* buffer,
                             size_t length);  
 
+/**
+ * @brief Pack samples for transmission
+ *
+ * The first half of "cariboulite_radio_write_samples" - converts native samples into
+ * the SMI wire format (one 32 bit word per sample) without writing them, so that the
+ * next buffer can be prepared while the previous one is being written by
+ * "cariboulite_radio_write_packed_samples".
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param buffer the native samples (complex i/q int16)
+ * @param packed a pre-allocated buffer of "length" words
+ * @param length the number of I/Q samples to pack
+ */
+void cariboulite_radio_pack_samples(cariboulite_radio_state_st* radio,
+                            const cariboulite_sample_complex_int16* buffer,
+                            uint32_t* packed,
+                            size_t length);
+
+/**
+ * @brief Pack floating point samples for transmission
+ *
+ * Same as "cariboulite_radio_pack_samples" but the scaling (sample * 4096.0), the
+ * saturation to the 13 bit native range and the packing are fused into a single pass,
+ * without an intermediate native buffer. Out of range samples are clipped.
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param buffer the complex float samples (CF32, full scale = 1.0)
+ * @param packed a pre-allocated buffer of "length" words
+ * @param length the number of I/Q samples to pack
+ */
+void cariboulite_radio_pack_samples_cf32(cariboulite_radio_state_st* radio,
+                            const cariboulite_sample_complex_float* buffer,
+                            uint32_t* packed,
+                            size_t length);
+
+/**
+ * @brief Pack double precision floating point samples for transmission
+ *
+ * The double precision (CF64) variant of "cariboulite_radio_pack_samples_cf32"
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param buffer the complex double samples (CF64, full scale = 1.0)
+ * @param packed a pre-allocated buffer of "length" words
+ * @param length the number of I/Q samples to pack
+ */
+void cariboulite_radio_pack_samples_cf64(cariboulite_radio_state_st* radio,
+                            const cariboulite_sample_complex_double* buffer,
+                            uint32_t* packed,
+                            size_t length);
+
+/**
+ * @brief Write packed samples
+ *
+ * Writes samples packed by "cariboulite_radio_pack_samples"
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param packed the packed samples
+ * @param length the number of I/Q samples to write
+ * @return the number of samples written
+ */
+int cariboulite_radio_write_packed_samples(cariboulite_radio_state_st* radio,
+                            const uint32_t* packed,
+                            size_t length);
+
+/**
+ * @brief Get the timing of the last read
+ *
+ * Gets the stream position and the estimated capture time (CLOCK_MONOTONIC, from the
+ * completion time of the driver's DMA chunk it arrived in) of the first sample
+ * returned by the last read.
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param info the timing info (pre-allocated)
+ * @return 0 = success, -1 = not available (the loaded driver doesn't provide rx accounting) -
+ *         only "sample_rate" is filled in that case
+ */
+int cariboulite_radio_get_rx_info(cariboulite_radio_state_st* radio, cariboulite_radio_rx_info_st* info);
+
+/**
+ * @brief Get the RX stream statistics
+ *
+ * Always-on counters of the SMI RX stream - samples delivered, resynchronizations,
+ * timeouts and drops (driver / ring) and a histogram of the time the reads spend
+ * waiting for the driver. Shared by both channels (they use the same SMI stream) and
+ * safe to call from any thread while another one reads.
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param stats the statistics snapshot (pre-allocated)
+ * @return always 0
+ */
+int cariboulite_radio_get_stream_stats(cariboulite_radio_state_st* radio, cariboulite_radio_stream_stats_st* stats);
+
+/**
+ * @brief Add a duration to a histogram
+ *
+ * The histogram should have a single writer, it may be read by other threads
+ * (member by member) while updated.
+ *
+ * @param hist the histogram
+ * @param duration_ns the duration to add in nanoseconds
+ */
+void cariboulite_latency_hist_add(cariboulite_latency_hist_st* hist, uint64_t duration_ns);
+
+/**
+ * @brief Get the frequency switching statistics
+ *
+ * Measured PLL lock times of the radio - the whole frequency switch (from the
+ * "cariboulite_radio_set_frequency" / "cariboulite_radio_hop" call until all the
+ * PLLs locked) and the time spent waiting for each of the PLLs, along with the
+ * number of switches and lock failures. Useful for choosing a hop dwell time.
+ * Safe to call from any thread while another one tunes.
+ *
+ * @param radio a pre-allocated radio state structure
+ * @param stats the statistics snapshot (pre-allocated)
+ * @return always 0
+ */
+int cariboulite_radio_get_tune_stats(cariboulite_radio_state_st* radio, cariboulite_radio_tune_stats_st* stats);
+
 /**
  * @brief Get Native Chunk (MTU)
  *
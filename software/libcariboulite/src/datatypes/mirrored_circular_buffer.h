@@ -0,0 +1,189 @@
+#ifndef __MIRRORED_CIRC_BUFFER_H__
+#define __MIRRORED_CIRC_BUFFER_H__
+
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <stdexcept>
+#include <type_traits>
+#include "spsc_circular_buffer.h"
+
+// Single-producer / single-consumer circular buffer whose storage is mapped twice,
+// back to back (one memfd mapped at 'base' and at 'base + capacity'). Any window
+// of up to 'capacity' items is therefore contiguous in memory, wherever it starts:
+// put / get never split their copy at the wrap point, and 'peek' / 'consume' (and
+// 'reserve' / 'commit' on the producer side) let DSP run on the ring in place.
+// The capacity is rounded up so the storage is a whole number of pages. Like
+// 'spsc_circular_buffer', a full buffer drops the newest items ('overflows').
+// Throws std::runtime_error when the mapping can't be created.
+template <class T>
+class mirrored_circular_buffer {
+	static_assert(std::is_trivially_copyable<T>::value, "mirrored_circular_buffer holds raw memory");
+
+public:
+	mirrored_circular_buffer(size_t size, bool block_read = true)
+		: max_size_(round_to_pages(size)), idx_(max_size_, block_read)
+	{
+		size_t bytes = max_size_ * sizeof(T);
+
+		int fd = memfd_create("mirrored_circular_buffer", MFD_CLOEXEC);
+		if (fd < 0)
+		{
+			throw std::runtime_error("mirrored_circular_buffer: memfd_create failed");
+		}
+
+		if (ftruncate(fd, bytes) != 0)
+		{
+			close(fd);
+			throw std::runtime_error("mirrored_circular_buffer: ftruncate failed");
+		}
+
+		// reserve the whole window first, then map the same pages twice into it
+		uint8_t* base = (uint8_t*)mmap(NULL, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (base == MAP_FAILED)
+		{
+			close(fd);
+			throw std::runtime_error("mirrored_circular_buffer: address space reservation failed");
+		}
+
+		if (mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+			mmap(base + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+		{
+			munmap(base, 2 * bytes);
+			close(fd);
+			throw std::runtime_error("mirrored_circular_buffer: mirror mapping failed");
+		}
+
+		// the mappings keep the memory alive
+		close(fd);
+		buf_ = (T*)base;
+	}
+
+	~mirrored_circular_buffer()
+	{
+		munmap(buf_, 2 * max_size_ * sizeof(T));
+	}
+
+	// producer side
+	size_t put(const T *data, size_t length)
+	{
+		T* ptr = NULL;
+		size_t len = reserve(&ptr, length);
+		if (len < length)
+		{
+			overflows_.fetch_add(length - len, std::memory_order_relaxed);
+		}
+		memcpy(ptr, data, len * sizeof(T));
+		commit(len);
+		return len;
+	}
+
+	// producer side - contiguous room for up to 'length' items, filled in place
+	// and published by 'commit'
+	size_t reserve(T** ptr, size_t length)
+	{
+		size_t head = 0;
+		size_t len = idx_.writable(length, &head);
+		*ptr = buf_ + (head % max_size_);
+		return len;
+	}
+
+	void commit(size_t n)
+	{
+		idx_.publish(idx_.head() + n);
+	}
+
+	// consumer side - like 'spsc_circular_buffer::get', a blocking get returns once
+	// 'min_length' items (by default all of 'length') are available
+	size_t get(T *data, size_t length, int timeout_us = 100000, size_t min_length = (size_t)-1)
+	{
+		const T* ptr = NULL;
+		size_t len = peek(&ptr, length, timeout_us, min_length);
+		if (data != NULL)
+		{
+			memcpy(data, ptr, len * sizeof(T));
+		}
+		consume(len);
+		return len;
+	}
+
+	// consumer side - a contiguous window of up to 'length' stored items (with
+	// blocking reads - waits like 'get'). The items stay in the buffer until
+	// they are released by 'consume'
+	size_t peek(const T** ptr, size_t length, int timeout_us = 100000, size_t min_length = (size_t)-1)
+	{
+		size_t tail = 0;
+		size_t len = idx_.readable(SPSC_MIN(length, max_size_), &tail, timeout_us, min_length);
+		*ptr = buf_ + (tail % max_size_);
+		return len;
+	}
+
+	void consume(size_t n)
+	{
+		idx_.release(idx_.tail() + n);
+	}
+
+	// consumer side - drops everything currently stored
+	void reset()
+	{
+		idx_.release_all();
+	}
+
+	// touches the whole storage so that the stream doesn't page fault on its first
+	// pass - only while neither side is using the buffer (the contents are lost)
+	void prefault()
+	{
+		memset((void*)buf_, 0, max_size_ * sizeof(T));
+	}
+
+	inline bool empty()
+	{
+		return size() == 0;
+	}
+
+	inline bool full()
+	{
+		return size() == capacity();
+	}
+
+	inline size_t capacity() const
+	{
+		return max_size_;
+	}
+
+	size_t size()
+	{
+		return idx_.size();
+	}
+
+	uint64_t overflows()
+	{
+		return overflows_.load(std::memory_order_relaxed);
+	}
+
+private:
+	// the smallest capacity >= size for which the storage is a whole number of pages
+	static size_t round_to_pages(size_t size)
+	{
+		size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		size_t a = page, b = sizeof(T);
+		while (b != 0)
+		{
+			size_t t = a % b;
+			a = b;
+			b = t;
+		}
+		size_t unit = page / a;             // items per page-multiple
+		if (size == 0) size = 1;
+		return ((size + unit - 1) / unit) * unit;
+	}
+
+private:
+	size_t max_size_;
+	spsc_indices idx_;
+	std::atomic<uint64_t> overflows_{0};
+	T* buf_;
+};
+
+#endif
@@ -0,0 +1,361 @@
+#ifndef __SPSC_CIRC_BUFFER_H__
+#define __SPSC_CIRC_BUFFER_H__
+
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <chrono>
+#include <atomic>
+#include <thread>
+
+#define SPSC_CACHE_LINE		(64)
+#define SPSC_SPIN_COUNT		(1000)
+#define SPSC_MIN(x,y)		((x)>(y)?(y):(x))
+
+static inline void spsc_cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+// Lock-free single-producer / single-consumer index pair with an optional
+// blocking wait for the consumer, shared by the SPSC buffers:
+//  - head is written only by the producer and tail only by the consumer, each on
+//    its own cache line, and each side caches the other's index so the shared
+//    line is touched only when the cached value doesn't suffice
+//  - a blocking reader spins briefly, then sleeps on a futex and is woken by the
+//    producer only once the amount it asked for is available (no syscall when
+//    nobody waits)
+// Indices are free running item counts.
+class spsc_indices {
+public:
+	spsc_indices(size_t capacity, bool block_read)
+	{
+		capacity_ = capacity;
+		block_read_ = block_read;
+		// spinning only makes sense when the producer can run meanwhile
+		spin_count_ = (std::thread::hardware_concurrency() > 1) ? SPSC_SPIN_COUNT : 0;
+	}
+
+	// producer side - room for up to 'length' items starting at 'head'
+	size_t writable(size_t length, size_t* head)
+	{
+		*head = head_.load(std::memory_order_relaxed);
+		if (capacity_ - (*head - tail_cache_) < length)
+		{
+			tail_cache_ = tail_.load(std::memory_order_acquire);
+		}
+		return SPSC_MIN(length, capacity_ - (*head - tail_cache_));
+	}
+
+	// producer side - makes everything up to 'head' visible with a single store
+	void publish(size_t head)
+	{
+		head_.store(head, std::memory_order_release);
+
+		if (block_read_)
+		{
+			// pairs with the fence in 'wait_for'
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (waiting_.load(std::memory_order_relaxed) &&
+				head - tail_.load(std::memory_order_relaxed) >= wanted_.load(std::memory_order_relaxed) &&
+				waiting_.exchange(false, std::memory_order_relaxed))
+			{
+				// a single wake per sleep, however many puts happen until the reader runs
+				seq_.fetch_add(1, std::memory_order_release);
+				futex(FUTEX_WAKE_PRIVATE, 1, NULL);
+			}
+		}
+	}
+
+	// consumer side - up to 'length' items starting at 'tail'. When blocking reads
+	// are enabled, waits up to 'timeout_us' for at least 'min_length' of them
+	// (all of them by default) and returns 0 otherwise
+	size_t readable(size_t length, size_t* tail, int timeout_us, size_t min_length = (size_t)-1)
+	{
+		*tail = tail_.load(std::memory_order_relaxed);
+		if (block_read_)
+		{
+			if (!wait_for(SPSC_MIN(length, min_length), timeout_us))
+			{
+				return 0;
+			}
+		}
+		else if (head_cache_ - *tail < length)
+		{
+			head_cache_ = head_.load(std::memory_order_acquire);
+		}
+		return SPSC_MIN(length, head_cache_ - *tail);
+	}
+
+	// consumer side - hands everything before 'tail' back to the producer
+	void release(size_t tail)
+	{
+		tail_.store(tail, std::memory_order_release);
+	}
+
+	// own side's index (producer: head, consumer: tail)
+	size_t head() { return head_.load(std::memory_order_relaxed); }
+	size_t tail() { return tail_.load(std::memory_order_relaxed); }
+
+	// consumer side - drops everything published so far, returns the number of
+	// items dropped
+	size_t release_all()
+	{
+		size_t head = head_.load(std::memory_order_acquire);
+		size_t dropped = head - tail_.load(std::memory_order_relaxed);
+		tail_.store(head, std::memory_order_release);
+		return dropped;
+	}
+
+	size_t size()
+	{
+		return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+	}
+
+private:
+	bool wait_for(size_t length, int timeout_us)
+	{
+		head_cache_ = head_.load(std::memory_order_acquire);
+		if (head_cache_ - tail_.load(std::memory_order_relaxed) >= length)
+		{
+			return true;
+		}
+
+		// a short spin first - at high rates the data is usually just a put away
+		for (int i = 0; i < spin_count_; i++)
+		{
+			head_cache_ = head_.load(std::memory_order_acquire);
+			if (head_cache_ - tail_.load(std::memory_order_relaxed) >= length)
+			{
+				return true;
+			}
+			spsc_cpu_relax();
+		}
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us);
+		wanted_.store(length, std::memory_order_relaxed);
+		while (true)
+		{
+			uint32_t seq = seq_.load(std::memory_order_acquire);
+			waiting_.store(true, std::memory_order_relaxed);
+			// pairs with the fence in 'publish' - either the producer sees 'waiting_'
+			// or we see its new head
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			head_cache_ = head_.load(std::memory_order_acquire);
+			if (head_cache_ - tail_.load(std::memory_order_relaxed) >= length)
+			{
+				break;
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			if (now >= deadline)
+			{
+				break;
+			}
+
+			auto left_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count();
+			struct timespec ts = {(time_t)(left_ns / 1000000000LL), (long)(left_ns % 1000000000LL)};
+			futex(FUTEX_WAIT_PRIVATE, seq, &ts);
+		}
+		waiting_.store(false, std::memory_order_relaxed);
+
+		return head_cache_ - tail_.load(std::memory_order_relaxed) >= length;
+	}
+
+	long futex(int op, uint32_t val, const struct timespec* timeout)
+	{
+		return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&seq_), op, val, timeout, NULL, 0);
+	}
+
+private:
+	// producer owned
+	alignas(SPSC_CACHE_LINE) std::atomic<size_t> head_{0};
+	size_t tail_cache_ = 0;
+
+	// consumer owned
+	alignas(SPSC_CACHE_LINE) std::atomic<size_t> tail_{0};
+	size_t head_cache_ = 0;
+
+	// blocking reader state - written by the consumer only before it sleeps and
+	// the futex word bumped by the producer to wake it
+	alignas(SPSC_CACHE_LINE) std::atomic<bool> waiting_{false};
+	std::atomic<size_t> wanted_{0};
+	std::atomic<uint32_t> seq_{0};
+
+	// read only after construction
+	alignas(SPSC_CACHE_LINE) size_t capacity_;
+	int spin_count_;
+	bool block_read_;
+};
+
+// A single-producer / single-consumer variant of 'circular_buffer' with the same
+// put / get interface, built on 'spsc_indices' - 'put' and 'get' don't take any
+// lock and a put of 'length' items is published with a single store.
+// Differences from 'circular_buffer': the producer can't move the tail, so when
+// the buffer is full the newest items are dropped (and counted by 'overflows')
+// instead of the oldest ones - 'override_write' is kept for interface
+// compatibility. Only one thread may put and only one thread may get.
+template <class T>
+class spsc_circular_buffer {
+public:
+	spsc_circular_buffer(size_t size, bool override_write = true, bool block_read = true)
+		: max_size_(next_power_of_2(size)), idx_(max_size_, block_read)
+	{
+		buf_ = new T[max_size_];
+		override_write_ = override_write;
+	}
+
+	~spsc_circular_buffer()
+	{
+		delete []buf_;
+	}
+
+	// producer side
+	size_t put(const T *data, size_t length)
+	{
+		size_t head = 0;
+		size_t len = idx_.writable(length, &head);
+		if (len < length)
+		{
+			overflows_.fetch_add(length - len, std::memory_order_relaxed);
+		}
+
+		size_t l = SPSC_MIN(len, max_size_ - (head & (max_size_ - 1)));
+		memcpy(buf_ + (head & (max_size_ - 1)), data, l * sizeof(T));
+		memcpy(buf_, data + l, (len - l) * sizeof(T));
+
+		// publish the whole batch at once
+		idx_.publish(head + len);
+		return len;
+	}
+
+	// consumer side - a blocking get returns once 'min_length' items (by default
+	// all of 'length') are available, taking whatever is there up to 'length'
+	size_t get(T *data, size_t length, int timeout_us = 100000, size_t min_length = (size_t)-1)
+	{
+		size_t tail = 0;
+		size_t len = idx_.readable(length, &tail, timeout_us, min_length);
+		size_t l = SPSC_MIN(len, max_size_ - (tail & (max_size_ - 1)));
+
+		if (data != NULL)
+		{
+			memcpy(data, buf_ + (tail & (max_size_ - 1)), l * sizeof(T));
+			memcpy(data + l, buf_, (len - l) * sizeof(T));
+		}
+		idx_.release(tail + len);
+		return len;
+	}
+
+	// consumer side - a contiguous window of up to 'length' stored items, cut at
+	// the wrap point of the storage (waits like 'get'). The items stay in the
+	// buffer until they are released by 'consume' - a second 'peek' returns the
+	// rest of a wrapped range
+	size_t peek(const T** ptr, size_t length, int timeout_us = 100000, size_t min_length = (size_t)-1)
+	{
+		size_t tail = 0;
+		size_t len = idx_.readable(length, &tail, timeout_us, min_length);
+		*ptr = buf_ + (tail & (max_size_ - 1));
+		return SPSC_MIN(len, max_size_ - (tail & (max_size_ - 1)));
+	}
+
+	// consumer side - like 'peek', but the window starts 'offset' items past the
+	// tail, after items peeked earlier and not consumed yet. Waits for at least
+	// 'min_length' items past the offset.
+	size_t peek_at(const T** ptr, size_t offset, size_t length, int timeout_us, size_t min_length)
+	{
+		size_t tail = 0;
+		size_t len = idx_.readable(offset + length, &tail, timeout_us, offset + SPSC_MIN(length, min_length));
+		if (len <= offset)
+		{
+			return 0;
+		}
+		size_t pos = (tail + offset) & (max_size_ - 1);
+		*ptr = buf_ + pos;
+		return SPSC_MIN(len - offset, max_size_ - pos);
+	}
+
+	void consume(size_t n)
+	{
+		idx_.release(idx_.tail() + n);
+	}
+
+	void put(T item)
+	{
+		put(&item, 1);
+	}
+
+	T get()
+	{
+		T item;
+		get(&item, 1);
+		return item;
+	}
+
+	// consumer side - drops everything currently stored, returns the number of
+	// items dropped
+	size_t reset()
+	{
+		return idx_.release_all();
+	}
+
+	// touches the whole storage so that the stream doesn't page fault on its first
+	// pass - only while neither side is using the buffer (the contents are lost)
+	void prefault()
+	{
+		memset((void*)buf_, 0, max_size_ * sizeof(T));
+	}
+
+	inline bool empty()
+	{
+		return size() == 0;
+	}
+
+	inline bool full()
+	{
+		return size() == capacity();
+	}
+
+	inline size_t capacity() const
+	{
+		return max_size_;
+	}
+
+	size_t size()
+	{
+		return idx_.size();
+	}
+
+	// number of items dropped by 'put' because the buffer was full
+	uint64_t overflows()
+	{
+		return overflows_.load(std::memory_order_relaxed);
+	}
+
+private:
+	static size_t next_power_of_2(size_t x)
+	{
+		size_t power = 1;
+		while (power < x)
+		{
+			power <<= 1;
+		}
+		return power;
+	}
+
+private:
+	size_t max_size_;
+	spsc_indices idx_;
+	std::atomic<uint64_t> overflows_{0};
+	T* buf_;
+	bool override_write_;
+};
+
+#endif
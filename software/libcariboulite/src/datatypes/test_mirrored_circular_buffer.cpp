@@ -0,0 +1,122 @@
+#include "mirrored_circular_buffer.h"
+#include <stdio.h>
+#include <vector>
+#include <complex>
+
+// Checks the mirror (windows spanning the wrap point are contiguous and
+// consistent) and streams through peek / consume from a second thread
+
+#define TOTAL_ITEMS		(1 << 26)
+
+static int test_mirror(void)
+{
+	int errors = 0;
+	mirrored_circular_buffer<std::complex<float>> buf(1000, false);
+	size_t cap = buf.capacity();
+	std::vector<std::complex<float>> in(cap), out(cap);
+
+	printf("    requested 1000 items, capacity %lu\n", cap);
+
+	// move the indices close to the end, then write across the wrap point
+	buf.put(in.data(), cap - 3);
+	buf.consume(cap - 3);
+	for (size_t i = 0; i < cap; i++) in[i] = std::complex<float>(i, -(float)i);
+	if (buf.put(in.data(), cap) != cap) errors ++;
+
+	const std::complex<float>* window = NULL;
+	if (buf.peek(&window, cap) != cap) errors ++;
+	for (size_t i = 0; i < cap; i++)
+	{
+		if (window[i] != in[i]) errors ++;
+	}
+	buf.consume(cap);
+
+	if (!buf.empty() || buf.put(in.data(), cap + 1) != cap || buf.overflows() != 1) errors ++;
+	return errors;
+}
+
+static int test_min_length(void)
+{
+	int errors = 0;
+	mirrored_circular_buffer<uint32_t> buf(1024, true);
+	std::vector<uint32_t> in(100);
+	const uint32_t* window = NULL;
+
+	buf.put(in.data(), 100);
+
+	// not enough for the whole request - times out empty unless partial windows are allowed
+	if (buf.peek(&window, 200, 1000) != 0) errors ++;
+	if (buf.peek(&window, 200, 1000, 50) != 100) errors ++;
+	if (buf.get(NULL, 200, 0, 1) != 100 || !buf.empty()) errors ++;
+	if (buf.get(NULL, 200, 1000, 1) != 0) errors ++;
+	return errors;
+}
+
+static int test_stream(size_t window)
+{
+	mirrored_circular_buffer<uint32_t> buf(65536, true);
+	std::atomic<bool> done{false};
+	uint64_t received = 0, errors = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	std::thread producer([&]()
+	{
+		uint32_t seq = 0;
+		while (seq < TOTAL_ITEMS)
+		{
+			// generate straight into the ring
+			uint32_t* ptr = NULL;
+			size_t len = buf.reserve(&ptr, SPSC_MIN(window, (size_t)(TOTAL_ITEMS - seq)));
+			if (len == 0)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			for (size_t i = 0; i < len; i++) ptr[i] = seq++;
+			buf.commit(len);
+		}
+		done = true;
+	});
+
+	uint32_t expected = 0;
+	while (true)
+	{
+		const uint32_t* ptr = NULL;
+		size_t len = buf.peek(&ptr, window, 10000);
+		if (len == 0)
+		{
+			if (done && buf.size() == 0) break;
+			if (done) len = buf.peek(&ptr, buf.size(), 0);
+			if (len == 0) continue;
+		}
+
+		for (size_t i = 0; i < len; i++)
+		{
+			if (ptr[i] != expected++) errors ++;
+		}
+		buf.consume(len);
+		received += len;
+	}
+	producer.join();
+
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("    window %5lu: %8.1f Mitems/s in place, received %5.1f%%, errors %lu\n",
+			window, received / secs / 1e6, 100.0 * received / TOTAL_ITEMS, errors);
+	return errors ? 1 : 0;
+}
+
+int main ()
+{
+	int errors = 0;
+
+	printf("Mirror test:\n");
+	errors += test_mirror();
+	errors += test_min_length();
+	printf("    %s\n", errors ? "FAILED" : "OK");
+
+	printf("Streaming through peek / consume (%d items):\n", TOTAL_ITEMS);
+	errors += test_stream(256);
+	errors += test_stream(4096);
+	errors += test_stream(40000);
+	return errors ? 1 : 0;
+}
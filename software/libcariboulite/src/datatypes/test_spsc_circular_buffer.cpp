@@ -0,0 +1,78 @@
+#include "circular_buffer.h"
+#include "spsc_circular_buffer.h"
+#include <unistd.h>
+#include <stdio.h>
+#include <vector>
+
+// Producer / consumer contention benchmark - circular_buffer (mutex + condvar)
+// against spsc_circular_buffer (lock-free, futex wait). The producer retries
+// until every item is accepted, so the stream must arrive complete and in order.
+
+#define TOTAL_ITEMS		(1 << 26)
+
+template <class BUF>
+int benchmark(const char* name, size_t capacity, size_t batch)
+{
+	BUF *buf = new BUF(capacity, false, true);
+	std::atomic<bool> done{false};
+	std::vector<uint32_t> in(batch), out(batch);
+	uint64_t received = 0, errors = 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread producer([&]()
+	{
+		uint32_t seq = 0;
+		for (size_t n = 0; n < TOTAL_ITEMS; n += batch)
+		{
+			for (size_t i = 0; i < batch; i++) in[i] = seq++;
+			size_t put = 0;
+			while (put < batch)
+			{
+				size_t len = buf->put(in.data() + put, batch - put);
+				if (len == 0) std::this_thread::yield();
+				put += len;
+			}
+		}
+		done = true;
+	});
+
+	uint32_t expected = 0;
+	while (true)
+	{
+		size_t len = buf->get(out.data(), batch, 10000);
+		if (len == 0)
+		{
+			if (done && buf->size() == 0) break;
+			continue;
+		}
+
+		for (size_t i = 0; i < len; i++)
+		{
+			if (out[i] != expected) errors ++;
+			expected = out[i] + 1;
+		}
+		received += len;
+	}
+	producer.join();
+
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("    %-22s batch %5lu: %8.1f Mitems/s, received %5.1f%%, errors %lu\n",
+			name, batch, received / secs / 1e6, 100.0 * received / TOTAL_ITEMS, errors);
+	delete buf;
+	return (errors || received != TOTAL_ITEMS) ? 1 : 0;
+}
+
+int main ()
+{
+	size_t batches[] = {16, 256, 4096};
+	int errors = 0;
+
+	printf("Contention benchmark (%d items, capacity 65536):\n", TOTAL_ITEMS);
+	for (size_t b : batches)
+	{
+		errors += benchmark<circular_buffer<uint32_t>>("circular_buffer", 65536, b);
+		errors += benchmark<spsc_circular_buffer<uint32_t>>("spsc_circular_buffer", 65536, b);
+	}
+	return errors ? 1 : 0;
+}
@@ -616,6 +616,103 @@ io_utils_spi_transmit_error:
     return -1;
 }
 
+//=====================================================================================
+// Sends several chip-select framed messages to a chip. On hard-spi chips all of them
+// go down in a single SPI_IOC_MESSAGE ioctl.
+int io_utils_spi_transmit_multi(io_utils_spi_st* dev, int chip_handle,
+							const io_utils_spi_segment_st* segments,
+							int num_segments)
+{
+    if (dev == NULL || !dev->initialized)
+    {
+        ZF_LOGE("uninitialized device");
+        return -1;
+    }
+    if (dev->chips[chip_handle].initialized == 0)
+    {
+        ZF_LOGE("uninitialized spi chip handle %d", chip_handle);
+        return -1;
+    }
+    if (num_segments <= 0 || num_segments > SPI_MAX_MESSAGES)
+    {
+        ZF_LOGE("illegal number of segments %d", num_segments);
+        return -1;
+    }
+
+    // lock the resource
+    pthread_mutex_lock(&dev->mtx);
+
+    if (io_utils_spi_setup_chip(dev, chip_handle) < 0)
+    {
+        ZF_LOGE("chip setup failed %d", chip_handle);
+        goto io_utils_spi_transmit_multi_error;
+    }
+
+    dev->current_chip = &dev->chips[chip_handle];
+
+    switch (dev->current_chip->chip_type)
+    {
+        // --------------------------------------------------
+        case io_utils_spi_chip_type_fpga_comm:
+        case io_utils_spi_chip_type_modem:
+        {
+            const void* tx_bufs[SPI_MAX_MESSAGES];
+            void* rx_bufs[SPI_MAX_MESSAGES];
+            int lens[SPI_MAX_MESSAGES];
+            for (int i = 0; i < num_segments; i++)
+            {
+                tx_bufs[i] = segments[i].tx_buf;
+                rx_bufs[i] = segments[i].rx_buf;
+                lens[i] = (int)segments[i].length;
+            }
+
+            int ret = spi_exchange_multi(&dev->current_chip->hard_dev.spidev, rx_bufs, tx_bufs, lens, num_segments);
+            if (ret < 0)
+            {
+                ZF_LOGE("spi multi transfer failed (%d)", ret);
+                goto io_utils_spi_transmit_multi_error;
+            }
+        }
+        break;
+
+        // --------------------------------------------------
+        case io_utils_spi_chip_type_modem_bitbang:
+        {
+            uint8_t dummy_rx[258];
+            for (int i = 0; i < num_segments; i++)
+            {
+                uint8_t* rx = segments[i].rx_buf;
+                if (rx == NULL)
+                {
+                    if (segments[i].length > sizeof(dummy_rx))
+                    {
+                        ZF_LOGE("segment too long for a write-only bitbang transfer (%zu)", segments[i].length);
+                        goto io_utils_spi_transmit_multi_error;
+                    }
+                    rx = dummy_rx;
+                }
+                io_utils_modem_bitbang_transfer_spi(dev, dev->current_chip, segments[i].tx_buf, rx, segments[i].length);
+            }
+        }
+        break;
+
+        // --------------------------------------------------
+	    default:
+        {
+            ZF_LOGE("multi-message transfers are not supported by chip type %d", dev->current_chip->chip_type);
+            goto io_utils_spi_transmit_multi_error;
+        }
+        break;
+    }
+
+    pthread_mutex_unlock(&dev->mtx);
+    return 0;
+
+io_utils_spi_transmit_multi_error:
+    pthread_mutex_unlock(&dev->mtx);
+    return -1;
+}
+
 //=====================================================================================
 void io_utils_spi_print_setup(io_utils_spi_st* dev)
 {
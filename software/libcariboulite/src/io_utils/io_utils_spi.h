@@ -31,6 +31,14 @@ typedef enum
 	io_utils_spi_write = 2,
 } io_utils_spi_dir_en;
 
+// a single chip-select framed message of a multi-message transfer
+typedef struct
+{
+	const unsigned char* tx_buf;
+	unsigned char* rx_buf;		// may be NULL (write only)
+	size_t length;
+} io_utils_spi_segment_st;
+
 typedef struct
 {
 	int spi_dev_id;			// either spidev0 or spidev1
@@ -76,6 +84,9 @@ int io_utils_spi_transmit(io_utils_spi_st* dev, int chip_handle,
 							unsigned char* rx_buf,
 							size_t length,
                             io_utils_spi_dir_en dir);
+int io_utils_spi_transmit_multi(io_utils_spi_st* dev, int chip_handle,
+							const io_utils_spi_segment_st* segments,
+							int num_segments);
 void io_utils_spi_print_setup(io_utils_spi_st* dev);
 
 #ifdef __cplusplus
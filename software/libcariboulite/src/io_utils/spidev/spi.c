@@ -208,6 +208,39 @@ int spi_exchange(spi_t *self, void *rx_buf, const void *tx_buf, int len)
   return retv;
 }
 //----------------------------------------------------------------------------
+// exchange `count` messages in one ioctl call, chip select is
+// released between the messages
+int spi_exchange_multi(spi_t *self, void* const* rx_bufs, const void* const* tx_bufs,
+                       const int* lens, int count)
+{
+  int i, retv;
+
+  struct spi_ioc_transfer xfer[SPI_MAX_MESSAGES];
+  if (count <= 0 || count > SPI_MAX_MESSAGES)
+  {
+    SPI_DBG("error in spi_exchange_multi(): illegal message count %d", count);
+    return SPI_ERR_EXCHANGE;
+  }
+  memset(xfer, 0, sizeof(xfer[0]) * count);
+
+  for (i = 0; i < count; i++)
+  {
+    xfer[i].tx_buf = (__u64)tx_bufs[i];                 // output buffer
+    xfer[i].rx_buf = (__u64)(rx_bufs ? rx_bufs[i] : 0); // input buffer
+    xfer[i].len = (__u32)lens[i];                       // length of data to write
+    xfer[i].cs_change = (i < count - 1);                // release CS before the next message
+  }
+
+  retv = ioctl(self->fd, SPI_IOC_MESSAGE(count), xfer);
+  if (retv < 0)
+  {
+    SPI_DBG("error in spi_exchange_multi(): ioctl(SPI_IOC_MESSAGE(%d)) return %d", count, retv);
+    return SPI_ERR_EXCHANGE;
+  }
+
+  return retv;
+}
+//----------------------------------------------------------------------------
 // read data from SPIdev from specific register address
 int spi_read_reg8(spi_t *self, uint8_t reg_addr, void *rx_buf, int len)
 {
@@ -24,6 +24,9 @@
 #define SPI_ERR_WRITE     -10 // can't write
 #define SPI_ERR_EXCHANGE  -11 // can't read/write
 
+// maximal number of messages in a single spi_exchange_multi() call
+#define SPI_MAX_MESSAGES    64
+
 //----------------------------------------------------------------------------
 #ifdef SPI_DEBUG
 #  include <stdio.h>  // fprintf()
@@ -74,6 +77,10 @@ int spi_write(spi_t *self, const void* tx_buf, int len);
 // read and write `len` bytes from/to SPIdev
 int spi_exchange(spi_t *self, void* rx_buf, const void* tx_buf, int len);
 //----------------------------------------------------------------------------
+// exchange `count` messages in one ioctl call (CS released between them)
+int spi_exchange_multi(spi_t *self, void* const* rx_bufs, const void* const* tx_bufs,
+                       const int* lens, int count);
+//----------------------------------------------------------------------------
 // read data from SPIdev from specific register address
 int spi_read_reg8(spi_t *self, uint8_t reg_addr, void* rx_buf, int len);
 //----------------------------------------------------------------------------
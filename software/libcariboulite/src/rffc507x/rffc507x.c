@@ -115,6 +115,7 @@ int rffc507x_init(  rffc507x_st* dev,
 	ZF_LOGD("Initializing RFFC507x driver");
 	memcpy(dev->rffc507x_regs, rffc507x_regs_default, sizeof(dev->rffc507x_regs));
 	dev->rffc507x_regs_dirty = 0x7fffffff;
+	dev->spi_transactions = 0;
 
 	ZF_LOGD("Setting up device GPIOs");
 
@@ -185,6 +186,15 @@ void rffc507x_reset(rffc507x_st* dev)
 	io_utils_usleep(10000);
 	io_utils_write_gpio(dev->reset_pin, 1);
 	io_utils_usleep(20000);
+
+	// the device is back at its defaults - rewrite everything on the next commit
+	dev->rffc507x_regs_dirty = 0x7fffffff;
+}
+
+//===========================================================================
+uint64_t rffc507x_get_spi_transactions(rffc507x_st* dev)
+{
+	return dev->spi_transactions;
 }
 
 //===========================================================================
@@ -220,6 +230,8 @@ uint16_t rffc507x_reg_read(rffc507x_st* dev, uint8_t r)
 	uint8_t vout = r;
 	uint16_t vin = 0;
 
+	dev->spi_transactions ++;
+
 	// Readback register is not cached.
 	if (r == RFFC507X_READBACK_REG)
 	{
@@ -247,6 +259,7 @@ void rffc507x_reg_write(rffc507x_st* dev, uint8_t r, uint16_t v)
 	*((uint16_t*)&vout[1]) = v;
 
 	io_utils_spi_transmit(dev->io_spi, dev->io_spi_handle, vout, NULL, 3, io_utils_spi_write);
+	dev->spi_transactions ++;
 	RFFC507X_REG_SET_CLEAN(dev, r);
 }
 
@@ -296,49 +309,41 @@ int rffc507x_setup_reference_freq(rffc507x_st* dev, double ref_freq_hz)
 }
 
 //===========================================================================
-double rffc507x_set_frequency(rffc507x_st* dev, double lo_hz)
+void rffc507x_plan_frequency(double ref_freq_hz, double lo_hz, rffc507x_freq_plan_st* plan)
 {
-	uint8_t lodiv;
-	double fvco;
-	uint8_t fbkdiv;
-	uint16_t n;
-	double tune_freq_hz;
-	uint16_t p1nmsb;
-	uint8_t p1nlsb;
-
-	rffc507x_disable(dev);
-
 	// Calculate n_lo
 	uint8_t n_lo = (uint8_t)log2(LO_MAX_HZ / lo_hz);
-	lodiv = 1 << n_lo;							// lodiv = 2^(n_lo)
-	fvco = lodiv * lo_hz;						// in Hz!
+	uint8_t lodiv = 1 << n_lo;					// lodiv = 2^(n_lo)
+	double fvco = lodiv * lo_hz;				// in Hz!
+	uint8_t fbkdiv = (fvco > 3200000000.0f) ? 4 : 2;
 
-	if (fvco > 3200000000.0f)
-	{
-		fbkdiv = 4;
-		set_RFFC507X_PLLCPL(dev, 3);
-	}
-	else
-	{
-		fbkdiv = 2;
-		set_RFFC507X_PLLCPL(dev, 2);
-	}
-
-	rffc507x_calculate_freq_params(dev->ref_freq_hz, lodiv, fvco, fbkdiv, &n, &p1nmsb, &p1nlsb, &tune_freq_hz);
+	plan->ref_freq_hz = ref_freq_hz;
+	plan->n_lo = n_lo;
+	plan->presc = fbkdiv >> 1;
+	plan->pllcpl = (fbkdiv == 4) ? 3 : 2;
+	rffc507x_calculate_freq_params(ref_freq_hz, lodiv, fvco, fbkdiv, &plan->n, &plan->nmsb, &plan->nlsb, &plan->act_freq_hz);
 
 	//ZF_LOGD("----------------------------------------------------------");
 	//ZF_LOGD("LO_HZ=%.2f n_lo=%d lodiv=%d", lo_hz, n_lo, lodiv);
-	//ZF_LOGD("fvco=%.2f fbkdiv=%d n=%d", fvco, fbkdiv, n);
-	//ZF_LOGD("frac=%d, p1nmsb=%d, p1nlsb=%d, tune_freq_hz=%.2f", p1nmsb<<8 | p1nlsb, p1nmsb, p1nlsb, tune_freq_hz);
+	//ZF_LOGD("fvco=%.2f fbkdiv=%d n=%d", fvco, fbkdiv, plan->n);
+	//ZF_LOGD("frac=%d, p1nmsb=%d, p1nlsb=%d, tune_freq_hz=%.2f", plan->nmsb<<8 | plan->nlsb, plan->nmsb, plan->nlsb, plan->act_freq_hz);
+}
+
+//===========================================================================
+double rffc507x_apply_frequency_plan(rffc507x_st* dev, const rffc507x_freq_plan_st* plan)
+{
+	rffc507x_disable(dev);
+
+	set_RFFC507X_PLLCPL(dev, plan->pllcpl);
 
 	// Path 2
-	set_RFFC507X_P2LODIV(dev, n_lo);
-	set_RFFC507X_P2N(dev, n);
-	set_RFFC507X_P2PRESC(dev, fbkdiv >> 1);
+	set_RFFC507X_P2LODIV(dev, plan->n_lo);
+	set_RFFC507X_P2N(dev, plan->n);
+	set_RFFC507X_P2PRESC(dev, plan->presc);
 	//set_RFFC507X_P2VCOSEL(dev, 0);
     //set_RFFC507X_AUTO(dev, 1);
-	set_RFFC507X_P2NMSB(dev, p1nmsb);
-	set_RFFC507X_P2NLSB(dev, p1nlsb);
+	set_RFFC507X_P2NMSB(dev, plan->nmsb);
+	set_RFFC507X_P2NLSB(dev, plan->nlsb);
 
 	rffc507x_regs_commit(dev);
 
@@ -347,27 +352,20 @@ double rffc507x_set_frequency(rffc507x_st* dev, double lo_hz)
 		// For optimum VCO phase noise the prescaler divider should be set to divide by 2. If the VCO frequency is 
 		// greater than 3.2GHz, it is necessary to set the ratio to 4 to allow the CT_cal algorithm to work. 
 		// After the device is enabled, the divider values can be reprogrammed with the prescaler divider ratio of 2 
-		// and the new n, nummsb, and numlsb values. Taking the previous example of an LO of 314.159265MHz:
-		fbkdiv = 2;
-		rffc507x_calculate_freq_params(dev->ref_freq_hz, lodiv, fvco, fbkdiv, &n, &p1nmsb, &p1nlsb, &tune_freq_hz);
-
-		//ZF_LOGD("LO_HZ=%.2f n_lo=%d lodiv=%d", lo_hz, n_lo, lodiv);
-		//ZF_LOGD("fvco=%.2f fbkdiv=%d n=%d", fvco, fbkdiv, n);
-		//ZF_LOGD("frac=%d, p1nmsb=%d, p1nlsb=%d, tune_freq_hz=%.2f", p1nmsb<<8 | p1nlsb, p1nmsb, p1nlsb, tune_freq_hz);
-		//ZF_LOGD("----------------------------------------------------------");
-
-		// Path 2
-		set_RFFC507X_P2LODIV(dev, n_lo);
-		set_RFFC507X_P2N(dev, n);
-		set_RFFC507X_P2PRESC(dev, fbkdiv >> 1);
-		set_RFFC507X_P2NMSB(dev, p1nmsb);
-		set_RFFC507X_P2NLSB(dev, p1nlsb);
-		rffc507x_regs_commit(dev);
+		// and the new n, nummsb, and numlsb values.
 	}*/
     
     rffc507x_enable(dev);
 
-	return tune_freq_hz;
+	return plan->act_freq_hz;
+}
+
+//===========================================================================
+double rffc507x_set_frequency(rffc507x_st* dev, double lo_hz)
+{
+	rffc507x_freq_plan_st plan;
+	rffc507x_plan_frequency(dev->ref_freq_hz, lo_hz, &plan);
+	return rffc507x_apply_frequency_plan(dev, &plan);
 }
 
 //===========================================================================
@@ -469,7 +467,12 @@ void rffc507x_calibrate(rffc507x_st* dev)
 void rffc507x_relock(rffc507x_st* dev)
 {
 	set_RFFC507X_RELOK(dev, 1);
+	RFFC507X_REG_SET_DIRTY(dev, 9);		// write even if the cached bit is still set
 	rffc507x_regs_commit(dev);
+
+	// self clearing on the device
+	set_RFFC507X_RELOK(dev, 0);
+	RFFC507X_REG_SET_CLEAN(dev, 9);
 }
 
 //===========================================================================
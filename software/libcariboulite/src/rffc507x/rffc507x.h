@@ -69,6 +69,8 @@ typedef struct
     int initialized;
     uint16_t rffc507x_regs[RFFC507X_NUM_REGS];
     uint32_t rffc507x_regs_dirty;
+
+    uint64_t spi_transactions;      // bit-banged register reads / writes
 } rffc507x_st;
 
 // Initialize chip
@@ -92,7 +94,25 @@ int rffc507x_regs_commit(rffc507x_st* dev);
 // Set frequency (MHz)
 double rffc507x_set_frequency(rffc507x_st* dev, double lo_hz);
 
+// Path 2 synthesizer settings of an LO frequency, worked out ahead of time so
+// that retuning is only the register writes (rffc507x_apply_frequency_plan)
+typedef struct
+{
+    double ref_freq_hz;             // the reference the plan was made for
+    uint8_t n_lo;                   // lodiv = 2^n_lo
+    uint8_t presc;
+    uint8_t pllcpl;
+    uint16_t n;
+    uint16_t nmsb;
+    uint8_t nlsb;
+    double act_freq_hz;
+} rffc507x_freq_plan_st;
+
+void rffc507x_plan_frequency(double ref_freq_hz, double lo_hz, rffc507x_freq_plan_st* plan);
+double rffc507x_apply_frequency_plan(rffc507x_st* dev, const rffc507x_freq_plan_st* plan);
+
 void rffc507x_reset(rffc507x_st* dev);
+uint64_t rffc507x_get_spi_transactions(rffc507x_st* dev);
 void rffc507x_enable(rffc507x_st* dev);
 void rffc507x_disable(rffc507x_st* dev);
 void rffc507x_set_gpo(rffc507x_st* dev, uint8_t gpo);
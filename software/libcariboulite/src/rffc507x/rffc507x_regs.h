@@ -38,9 +38,11 @@ extern "C" {
  * (structs). This may be used in firmware, or on host predefined
  * register loads. */
 
-/* On set_, register is always set dirty, even if nothing
- * changed. This makes sure that writes that have side effects,
- * e.g. frequency setting, are not skipped. */
+/* On set_, register is set dirty only if its value changed, so a
+ * commit sends just the registers that differ from the device.
+ * Writes with side effects (self clearing bits like RELOK) must
+ * mark the register dirty explicitly. The ENBL toggle that latches
+ * a new frequency always changes the value. */
 
 /* n=name, r=regnum, o=offset (bits from LSB) of LSB of field,
  * l=length (bits) */
@@ -49,8 +51,11 @@ static inline uint16_t get_##n(rffc507x_st* dev) { \
         return (dev->rffc507x_regs[(r)] >> (o)) & ((1L<<(l))-1); \
 } \
 static inline void set_##n(rffc507x_st* dev, uint16_t v) {      \
-	dev->rffc507x_regs[(r)] &= (uint16_t)(~(((1L<<(l))-1)<<(o)));	\
-	dev->rffc507x_regs[(r)] |= (uint16_t)((((v)&((1L<<(l))-1))<<(o)));	\
+	uint16_t reg = dev->rffc507x_regs[(r)];				\
+	reg &= (uint16_t)(~(((1L<<(l))-1)<<(o)));			\
+	reg |= (uint16_t)((((v)&((1L<<(l))-1))<<(o)));			\
+	if (reg == dev->rffc507x_regs[(r)]) return;			\
+	dev->rffc507x_regs[(r)] = reg;					\
 	RFFC507X_REG_SET_DIRTY((dev),(r));				\
 }
 
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <time.h>
 #include "rffc507x.h"
 #include "io_utils/io_utils.h"
 #include "io_utils/io_utils_spi.h"
@@ -26,9 +27,33 @@ rffc507x_st dev =
 	.ref_freq_hz = 32e6,
 };
 
+// Tune sweep as done by the HiF channel (calibrate + set frequency). With
+// 'full_rewrite' all registers are marked dirty before every tune - the
+// behaviour before the dirty tracking.
+static void tune_benchmark(rffc507x_st* dev, double start_hz, double step_hz, int count, int full_rewrite)
+{
+	struct timespec t0, t1;
+	uint64_t spi_start = rffc507x_get_spi_transactions(dev);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (int i = 0; i < count; i++)
+	{
+		if (full_rewrite) dev->rffc507x_regs_dirty = 0x7fffffff;
+		rffc507x_calibrate(dev);
+		rffc507x_set_frequency(dev, start_hz + i * step_hz);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+
+	double usec = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3;
+	uint64_t spi = rffc507x_get_spi_transactions(dev) - spi_start;
+	printf("Tune benchmark (%s): %d tunes from %.1f MHz, step %.3f MHz: %.2f spi transactions / tune, %.1f usec / tune\n",
+			full_rewrite ? "full rewrite" : "dirty registers", count, start_hz / 1e6, step_hz / 1e6,
+			(double)spi / count, usec / count);
+}
+
 int main ()
 {
-	io_utils_setup(NULL);
+	io_utils_setup();
 	io_utils_set_gpio_mode(FPGA_RESET, io_utils_alt_gpio_out);
     io_utils_set_gpio_mode(ICE40_CS, io_utils_alt_gpio_out);
 	io_utils_setup_gpio(CARIBOULITE_MXR_RESET, io_utils_dir_output, io_utils_pull_up);
@@ -118,6 +143,12 @@ int main ()
 		rffc507x_print_stat(&stat);
 	}
 
+	// small steps stay in one vco band, large ones cross bands
+	tune_benchmark(&dev, 2500e6, 100e3, 200, 1);
+	tune_benchmark(&dev, 2500e6, 100e3, 200, 0);
+	tune_benchmark(&dev, 100e6, 25e6, 200, 1);
+	tune_benchmark(&dev, 100e6, 25e6, 200, 0);
+
 	rffc507x_release(&dev);
 	io_utils_spi_close(&io_spi_dev);
     io_utils_cleanup();
@@ -56,7 +56,9 @@ public:
         /*******************************************************************
          * Channels API
          ******************************************************************/
-        size_t getNumChannels(const int direction) const { return 1; }
+        // RX channel 0 is this device's radio and channel 1 the other one, so that
+        // both can be received by a single (dual) stream
+        size_t getNumChannels(const int direction) const { return (direction == SOAPY_SDR_RX) ? 2 : 1; }
         bool getFullDuplex(const int direction, const size_t channel) const { return (false); }
 
         /*******************************************************************
@@ -70,6 +72,7 @@ public:
                                         const std::vector<size_t> &channels = std::vector<size_t>(), 
                                         const SoapySDR::Kwargs &args = SoapySDR::Kwargs());
         void closeStream(SoapySDR::Stream *stream);
+        static cariboulite_thread_config_st parseThreadConfig(const SoapySDR::Kwargs &args);
         size_t getStreamMTU(SoapySDR::Stream *stream) const;
         int activateStream(     SoapySDR::Stream *stream,
                                 const int flags = 0,
@@ -92,6 +95,35 @@ public:
                         const long long timeNs = 0, // const first, don't pass as reference !
                         const long timeoutUs = 100000); // default value ?
 
+        /*******************************************************************
+         * Direct buffer access API
+         ******************************************************************/
+        size_t getNumDirectAccessBuffers(SoapySDR::Stream *stream);
+        int getDirectAccessBufferAddrs(SoapySDR::Stream *stream, const size_t handle, void **buffs);
+        int acquireReadBuffer(  SoapySDR::Stream *stream,
+                                size_t &handle,
+                                const void **buffs,
+                                int &flags,
+                                long long &timeNs,
+                                const long timeoutUs = 100000);
+        void releaseReadBuffer(SoapySDR::Stream *stream, const size_t handle);
+        int acquireWriteBuffer( SoapySDR::Stream *stream,
+                                size_t &handle,
+                                void **buffs,
+                                const long timeoutUs = 100000);
+        void releaseWriteBuffer(SoapySDR::Stream *stream,
+                                const size_t handle,
+                                const size_t numElems,
+                                int &flags,
+                                const long long timeNs = 0);
+
+        /*******************************************************************
+         * Time API
+         ******************************************************************/
+        bool hasHardwareTime(const std::string &what = "") const;
+        long long getHardwareTime(const std::string &what = "") const;
+        void setHardwareTime(const long long timeNs, const std::string &what = "");
+
         /*******************************************************************
          * Antenna API
          ******************************************************************/
@@ -145,6 +177,9 @@ public:
         template <typename Type>
         Type readSensor(const int direction, const size_t channel, const std::string &key) const;
 
+public:
+        cariboulite_radio_state_st *getRadio(const size_t channel) const;
+
 public:
         cariboulite_radio_state_st *radio;
 		SoapySDR::Stream* stream;
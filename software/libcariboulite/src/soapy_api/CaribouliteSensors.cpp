@@ -1,4 +1,78 @@
 #include "Cariboulite.hpp"
+#include <sstream>
+
+// RX stream statistics (see cariboulite_radio_stream_stats_st) - shared by both channels
+static const struct
+{
+    const char* key;
+    const char* name;
+    const char* description;
+} stream_stats_sensors[] = 
+{
+    {"RX_SAMPLES", "RX Samples", "Samples delivered by the SMI stream since startup"},
+    {"RX_RESYNCS", "RX Resyncs", "Word (re)synchronizations of the SMI stream"},
+    {"RX_RESYNC_DROPPED", "RX Resync Drops", "Samples discarded while the SMI stream was out of sync"},
+    {"RX_TIMEOUTS", "RX Timeouts", "SMI reads that timed out"},
+    {"RX_KERNEL_DROPPED", "RX Kernel Drops", "Samples dropped by the SMI driver (fifo / ring full)"},
+    {"RX_RING_DROPPED", "RX Ring Drops", "Samples overwritten in the SMI rx ring before they were consumed"},
+    {"RX_READ_LATENCY", "RX Read Latency", "Histogram of the time SMI reads wait for the driver - "
+                                          "comma separated counts, bin n = [2^n, 2^(n+1)) usec"},
+    {"RX_READ_LATENCY_MAX", "RX Max Read Latency", "Longest time an SMI read waited for the driver (usec)"},
+};
+
+// Frequency switching statistics (see cariboulite_radio_tune_stats_st) - per channel
+static const struct
+{
+    const char* key;
+    const char* name;
+    const char* description;
+} tune_stats_sensors[] = 
+{
+    {"TUNE_COUNT", "Tunes", "Frequency switches that waited for the PLLs to lock"},
+    {"TUNE_LOCK_FAILURES", "Lock Failures", "Frequency switches whose PLLs didn't lock"},
+    {"TUNE_TIME", "Tune Time", "Histogram of the frequency switch time until the PLLs locked - "
+                               "comma separated counts, bin n = [2^n, 2^(n+1)) usec"},
+    {"TUNE_TIME_LAST", "Last Tune Time", "Time until the PLLs locked on the last frequency switch (usec)"},
+    {"TUNE_TIME_MAX", "Max Tune Time", "Longest frequency switch until the PLLs locked (usec)"},
+};
+
+//========================================================
+static std::string histToString(const cariboulite_latency_hist_st &hist)
+{
+    std::stringstream ss;
+    for (int i = 0; i < CARIBOULITE_LATENCY_BINS; i++)
+    {
+        ss << (i ? "," : "") << hist.bins[i];
+    }
+    return ss.str();
+}
+
+//========================================================
+static bool readTuneStatsSensor(const cariboulite_radio_tune_stats_st &stats, const std::string &key, std::string &value)
+{
+    if (key == "TUNE_COUNT") value = std::to_string(stats.tunes);
+    else if (key == "TUNE_LOCK_FAILURES") value = std::to_string(stats.lock_failures);
+    else if (key == "TUNE_TIME") value = histToString(stats.tune_time);
+    else if (key == "TUNE_TIME_LAST") value = std::to_string(stats.last_tune_time_ns / 1000.0);
+    else if (key == "TUNE_TIME_MAX") value = std::to_string(stats.tune_time.max_ns / 1000.0);
+    else return false;
+    return true;
+}
+
+//========================================================
+static bool readStreamStatsSensor(const cariboulite_radio_stream_stats_st &stats, const std::string &key, std::string &value)
+{
+    if (key == "RX_SAMPLES") value = std::to_string(stats.samples_delivered);
+    else if (key == "RX_RESYNCS") value = std::to_string(stats.resyncs);
+    else if (key == "RX_RESYNC_DROPPED") value = std::to_string(stats.resync_dropped_samples);
+    else if (key == "RX_TIMEOUTS") value = std::to_string(stats.read_timeouts);
+    else if (key == "RX_KERNEL_DROPPED") value = std::to_string(stats.kernel_dropped_samples);
+    else if (key == "RX_RING_DROPPED") value = std::to_string(stats.ring_dropped_samples);
+    else if (key == "RX_READ_LATENCY_MAX") value = std::to_string(stats.read_latency.max_ns / 1000.0);
+    else if (key == "RX_READ_LATENCY") value = histToString(stats.read_latency);
+    else return false;
+    return true;
+}
 
 //========================================================
 std::vector<std::string> Cariboulite::listSensors(const int direction, const size_t channel) const
@@ -7,8 +81,17 @@ std::vector<std::string> Cariboulite::listSensors(const int direction, const siz
 
 	if (direction == SOAPY_SDR_RX) lst.push_back( "RSSI" );
     if (direction == SOAPY_SDR_RX) lst.push_back( "ENERGY" );
+    if (direction == SOAPY_SDR_RX) lst.push_back( "RX_DROPPED" );
+    if (direction == SOAPY_SDR_RX) lst.push_back( "RX_ANCHORS_DROPPED" );
+    if (direction == SOAPY_SDR_RX)
+    {
+        for (auto &sensor : stream_stats_sensors) lst.push_back( sensor.key );
+    }
     lst.push_back( "PLL_LOCK_MODEM" );
-    if (channel == cariboulite_channel_hif)
+    for (auto &sensor : tune_stats_sensors) lst.push_back( sensor.key );
+    lst.push_back( "MODEM_SPI_TRANSACTIONS" );
+    lst.push_back( "MODEM_SPI_CACHED_READS" );
+    if (getRadio(channel)->type == cariboulite_channel_hif)
     {
         lst.push_back( "PLL_LOCK_MIXER" );
     }
@@ -40,6 +123,32 @@ SoapySDR::ArgInfo Cariboulite::getSensorInfo(const int direction, const size_t c
             info.range = SoapySDR::Range(-127, 4);
             return info;
         }
+        if (key == "RX_DROPPED")
+        {
+            info.name = "RX Dropped Samples";
+            info.key = "RX_DROPPED";
+            info.type = info.INT;
+            info.description = "Samples dropped by the RX reader queue since startup";
+            return info;
+        }
+        if (key == "RX_ANCHORS_DROPPED")
+        {
+            info.name = "RX Dropped Time Anchors";
+            info.key = "RX_ANCHORS_DROPPED";
+            info.type = info.INT;
+            info.description = "Hardware time anchors the RX reader found no room for since startup";
+            return info;
+        }
+        for (auto &sensor : stream_stats_sensors)
+        {
+            if (key != sensor.key) continue;
+            info.name = sensor.name;
+            info.key = sensor.key;
+            info.type = (key == "RX_READ_LATENCY") ? info.STRING : 
+                        (key == "RX_READ_LATENCY_MAX") ? info.FLOAT : info.INT;
+            info.description = sensor.description;
+            return info;
+        }
     }
 
     if (key == "PLL_LOCK_MODEM")
@@ -51,7 +160,29 @@ SoapySDR::ArgInfo Cariboulite::getSensorInfo(const int direction, const size_t c
         return info;
     }
 
-    if (channel == cariboulite_channel_hif && key == "PLL_LOCK_MIXER")
+    for (auto &sensor : tune_stats_sensors)
+    {
+        if (key != sensor.key) continue;
+        info.name = sensor.name;
+        info.key = sensor.key;
+        info.type = (key == "TUNE_TIME") ? info.STRING : 
+                    (key == "TUNE_TIME_LAST" || key == "TUNE_TIME_MAX") ? info.FLOAT : info.INT;
+        info.description = sensor.description;
+        return info;
+    }
+
+    if (key == "MODEM_SPI_TRANSACTIONS" || key == "MODEM_SPI_CACHED_READS")
+    {
+        bool cached = key == "MODEM_SPI_CACHED_READS";
+        info.name = cached ? "Modem Cached Reads" : "Modem SPI Transactions";
+        info.key = key;
+        info.type = info.INT;
+        info.description = cached ? "Modem register reads served from the driver's register shadow" :
+                                    "SPI transactions issued to the modem since startup (both channels)";
+        return info;
+    }
+
+    if (getRadio(channel)->type == cariboulite_channel_hif && key == "PLL_LOCK_MIXER")
     {
         info.name = "PLL Lock Mixer";
         info.key = "PLL_MIXER";
@@ -65,6 +196,33 @@ SoapySDR::ArgInfo Cariboulite::getSensorInfo(const int direction, const size_t c
 //========================================================
 std::string Cariboulite::readSensor(const int direction, const size_t channel, const std::string &key) const
 {
+    if (direction == SOAPY_SDR_RX && key == "RX_DROPPED")
+    {
+        return std::to_string(stream->getRxDroppedSamples());
+    }
+    if (direction == SOAPY_SDR_RX && key == "RX_ANCHORS_DROPPED")
+    {
+        return std::to_string(stream->getRxDroppedAnchors());
+    }
+    if (direction == SOAPY_SDR_RX)
+    {
+        cariboulite_radio_stream_stats_st stats;
+        std::string value;
+        cariboulite_radio_get_stream_stats((cariboulite_radio_state_st*)getRadio(channel), &stats);
+        if (readStreamStatsSensor(stats, key, value)) return value;
+    }
+    {
+        cariboulite_radio_tune_stats_st stats;
+        std::string value;
+        cariboulite_radio_get_tune_stats((cariboulite_radio_state_st*)getRadio(channel), &stats);
+        if (readTuneStatsSensor(stats, key, value)) return value;
+    }
+    if (key == "MODEM_SPI_TRANSACTIONS" || key == "MODEM_SPI_CACHED_READS")
+    {
+        uint64_t transactions = 0, cached_reads = 0;
+        at86rf215_get_spi_stats(&sess.sys.modem, &transactions, &cached_reads);
+        return std::to_string(key == "MODEM_SPI_CACHED_READS" ? cached_reads : transactions);
+    }
     return std::to_string(readSensor<float>(direction, channel, key));
 }
 
@@ -77,25 +235,25 @@ Type Cariboulite::readSensor(const int direction, const size_t channel, const st
         if (key == "RSSI")
         {
             float rssi = 0.0f;
-            cariboulite_radio_get_rssi((cariboulite_radio_state_st*)radio, &rssi);
+            cariboulite_radio_get_rssi((cariboulite_radio_state_st*)getRadio(channel), &rssi);
             return rssi;
         }
         if (key == "ENERGY")
         {
             float energy = 0.0f;
-            cariboulite_radio_get_energy_det((cariboulite_radio_state_st*)radio, &energy);
+            cariboulite_radio_get_energy_det((cariboulite_radio_state_st*)getRadio(channel), &energy);
             return energy;
         }
     }
 
     if (key == "PLL_LOCK_MODEM")
     {
-        return radio->modem_pll_locked;
+        return getRadio(channel)->modem_pll_locked;
     }
 
-    if (channel == cariboulite_channel_hif && key == "PLL_LOCK_MIXER")
+    if (getRadio(channel)->type == cariboulite_channel_hif && key == "PLL_LOCK_MIXER")
     {
-        return radio->lo_pll_locked;
+        return getRadio(channel)->lo_pll_locked;
     }
     return 0;
 }
\ No newline at end of file
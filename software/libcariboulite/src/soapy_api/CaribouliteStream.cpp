@@ -2,34 +2,96 @@
 #include <Iir.h>
 #include <byteswap.h>
 #include <chrono>
+#include <time.h>
 
 
 #define NUM_BYTES_PER_CPLX_ELEM         ( sizeof(cariboulite_sample_complex_int16) )
-#define NUM_NATIVE_MTUS_PER_QUEUE		( 10 )
 
-// Undefine to also use TX
-//#define USE_ASYNC                       ( 1 )
+// Comment out to read the SMI synchronously on the caller's thread
+#define USE_ASYNC                       ( 1 )
 #define USE_ASYNC_OVERRIDE_WRITES       ( true )
 #define USE_ASYNC_BLOCK_READS           ( true )
+#define NUM_ANCHORS_PER_CHUNK           ( 4 )
+
+//=================================================================
+static uint64_t monotonicTimeNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 
 //=================================================================
 void ReaderThread(SoapySDR::Stream* stream)
 {
 #if USE_ASYNC
     SoapySDR_logf(SOAPY_SDR_INFO, "Entering Reader Thread");
+    cariboulite_thread_state_st prev;
+    bool cfg_applied = false;
     
     while (stream->readerThreadRunning())
     {
-        if (!stream->stream_active)
+        if (!stream->stream_active || stream->native_dir != cariboulite_channel_dir_rx)
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            // parked until an RX stream is activated (or the thread stopped) - with
+            // the thread's own scheduling, the stream's is applied while it runs
+            if (cfg_applied)
+            {
+                cariboulite_restore_thread_config(&prev);
+                cfg_applied = false;
+            }
+            std::unique_lock<std::mutex> lock(stream->reader_mutex);
+            stream->reader_cv.wait(lock, [stream]{return (stream->stream_active && stream->native_dir == cariboulite_channel_dir_rx) || 
+                                                         !stream->reader_thread_running;});
+            continue;
+        }
+        
+        if (!cfg_applied)
+        {
+            cariboulite_apply_thread_config(&stream->thread_cfg, &prev);
+            cfg_applied = true;
+        }
+        
+        if (stream->dual_radio)
+        {
+            // both channels arrive in one stream - the words are split into the
+            // per channel queues (indexed by the radio type) in a single pass
+            size_t own = stream->radio->type;
+            void* buffers[2];
+            cariboulite_sample_meta* meta[2] = {NULL, NULL};
+            size_t counts[2] = {0, 0};
+            buffers[own] = stream->interm_native_buffer1;
+            buffers[1 - own] = stream->interm_dual_buffer;
+            
+            int ret = cariboulite_radio_read_samples_dual(stream->radio, 
+                                                        cariboulite_sample_format_ci16, 
+                                                        buffers, meta, 
+                                                        stream->rx_chunk_len, 
+                                                        counts);
+            if (ret <= 0) continue;
+            
+            rx_time_anchor_st anchor;
+            stream->makeRxTimeAnchor(&anchor, stream->rx_queued, counts[own]);
+            
+            // a chunk goes into both queues or into neither - dropping it from one
+            // of them only would leave the two channels out of step for good
+            if (stream->rx_queue->capacity() - stream->rx_queue->size() < counts[own] ||
+                stream->rx_dual_queue->capacity() - stream->rx_dual_queue->size() < counts[1 - own])
+            {
+                stream->rx_dual_dropped += counts[own];
+                continue;
+            }
+            stream->queueRxTimeAnchor(anchor);
+            
+            stream->rx_queued += stream->rx_queue->put(stream->interm_native_buffer1, counts[own]);
+            stream->rx_dual_queue->put(stream->interm_dual_buffer, counts[1 - own]);
             continue;
         }
         
         int ret = cariboulite_radio_read_samples(stream->radio, 
                                                     stream->interm_native_buffer1, 
                                                     stream->interm_native_meta, 
-                                                    stream->mtu_size);
+                                                    stream->rx_chunk_len);
         if (ret < 0)
         {
             if (ret == -1)
@@ -41,9 +103,21 @@ void ReaderThread(SoapySDR::Stream* stream)
             ret = 0;
         }
         
-        if (ret) stream->rx_queue->put(stream->interm_native_buffer1, ret);
+        if (ret == 0) continue;
+
+        // the anchor goes first so that it is always there by the time
+        // its samples are read out
+        rx_time_anchor_st anchor;
+        stream->makeRxTimeAnchor(&anchor, stream->rx_queued, ret);
+        stream->queueRxTimeAnchor(anchor);
+
+        // when the application falls behind the newest samples are dropped
+        // and counted by the queue - reported by 'ReadSamplesGen'. The next
+        // anchor carries the stream position past the gap.
+        stream->rx_queued += stream->rx_queue->put(stream->interm_native_buffer1, ret);
     }
     
+    if (cfg_applied) cariboulite_restore_thread_config(&prev);
     SoapySDR_logf(SOAPY_SDR_INFO, "Leaving Reader Thread");
 #endif //USE_ASYNC
 }
@@ -54,32 +128,61 @@ SoapySDR::Stream::Stream(cariboulite_radio_state_st *radio)
     // init pointers
     reader_thread = NULL;
     rx_queue = NULL;
+    rx_dual_queue = NULL;
     interm_native_buffer1 = NULL;
+    interm_dual_buffer = NULL;
     interm_native_buffer2 = NULL;
+    interm_packed_buffer = NULL;
     interm_native_meta = NULL;
+    direct_buffer_pool = NULL;
     filter_i = NULL;
 	filter_q = NULL;
     
     // stream init
     this->radio = radio;
+    dual_radio = NULL;
+    native_dir = cariboulite_channel_dir_rx;
+    memset(&thread_cfg, 0, sizeof(thread_cfg));
     mtu_size = getMTUSizeElements();
     
     SoapySDR_logf(SOAPY_SDR_INFO, "Creating SampleQueue MTU: %d I/Q samples (%d bytes)", 
 				mtu_size, mtu_size * sizeof(cariboulite_sample_complex_int16));
 
-    #if USE_ASYNC
-        rx_queue = new circular_buffer<cariboulite_sample_complex_int16>(mtu_size * NUM_NATIVE_MTUS_PER_QUEUE, 
-                                                                         USE_ASYNC_OVERRIDE_WRITES, 
-                                                                         USE_ASYNC_BLOCK_READS);
-        interm_native_buffer1 = new cariboulite_sample_complex_int16[mtu_size];
-    #endif //USE_ASYNC
+    rx_chunk_len = mtu_size;
+    rx_num_chunks = NUM_NATIVE_MTUS_PER_QUEUE;
+    rx_reported_overflows = 0;
+    rx_dropped_samples = 0;
+    rx_dual_dropped = 0;
+    rx_anchors = NULL;
+    rx_anchor_pending_valid = false;
+    rx_anchors_dropped = 0;
+    rx_queued = 0;
+    rx_reader_samples = 0;
+    rx_consumed = 0;
+    rx_read_pos = 0;
+    rx_anchor_valid = false;
+    rx_anchor_next_valid = false;
+    rx_time_base_valid = false;
+    hw_time_offset_ns = 0;
+
+    createRxQueues();
 
 	format = CARIBOULITE_FORMAT_INT16;
 
 	// Init the internal IIR filters
     // a buffer for conversion between native and emulated formats
     interm_native_buffer2 = new cariboulite_sample_complex_int16[mtu_size];
+    interm_packed_buffer = new uint32_t[mtu_size];
     interm_native_meta = new cariboulite_sample_meta[mtu_size];
+
+    // the direct access buffers are handed to the application as is
+    direct_buffer_pool = new cariboulite_sample_complex_int16[mtu_size * NUM_DIRECT_ACCESS_BUFFERS];
+    for (size_t i = 0; i < NUM_DIRECT_ACCESS_BUFFERS; i++) direct_buffer_acquired[i] = false;
+    direct_buffer_next = 0;
+    rx_direct_first = 0;
+    rx_direct_held = 0;
+    rx_direct_peeked = 0;
+    tx_error = 0;
     
 	filterType = DigitalFilter_None;
 	filt20_i.setup(4e6, 20e3/2);
@@ -90,11 +193,9 @@ SoapySDR::Stream::Stream(cariboulite_radio_state_st *radio)
 	filt50_q.setup(4e6, 50e3/2);
 	filt100_q.setup(4e6, 100e3/2);
     
-    #if USE_ASYNC
-        reader_thread_running = 1;
-        stream_active = 0;
-        reader_thread = new std::thread(ReaderThread, this);
-    #endif //USE_ASYNC
+    // the reader thread is created when an RX stream is first activated
+    stream_active = 0;
+    reader_thread_running = 0;
 }
 
 //=================================================================
@@ -104,17 +205,357 @@ SoapySDR::Stream::~Stream()
 	filter_i = NULL;
 	filter_q = NULL;
     
+    stream_active = 0;
+    stopReaderThread();
+
+    destroyRxQueues();
+    
+    if (interm_native_buffer2) delete[] interm_native_buffer2;
+    if (interm_packed_buffer) delete[] interm_packed_buffer;
+    if (interm_native_meta) delete[] interm_native_meta;
+    if (direct_buffer_pool) delete[] direct_buffer_pool;
+}
+
+//=================================================================
+void SoapySDR::Stream::startReaderThread(void)
+{
     #if USE_ASYNC
-        stream_active = 0;
-        reader_thread_running = 0;
+        if (reader_thread || native_dir != cariboulite_channel_dir_rx) return;
+        reader_thread_running = 1;
+        reader_thread = new std::thread(ReaderThread, this);
+    #endif //USE_ASYNC
+}
+
+//=================================================================
+void SoapySDR::Stream::activateStream(int active)
+{
+    if (active) startReaderThread();
+    {
+        std::lock_guard<std::mutex> lock(reader_mutex);
+        stream_active = active;
+    }
+    reader_cv.notify_one();
+}
+
+//=================================================================
+void SoapySDR::Stream::stopReaderThread(void)
+{
+    #if USE_ASYNC
+        if (!reader_thread) return;
+        {
+            std::lock_guard<std::mutex> lock(reader_mutex);
+            reader_thread_running = 0;
+        }
+        reader_cv.notify_one();
         reader_thread->join();
-        if (reader_thread) delete reader_thread;
+        delete reader_thread;
+        reader_thread = NULL;
+    #endif //USE_ASYNC
+}
+
+//=================================================================
+// Takes effect on the reader thread and the rx buffers right away - the thread is
+// restarted and the buffers touched while it is stopped
+void SoapySDR::Stream::setThreadConfig(const cariboulite_thread_config_st& cfg)
+{
+    bool reader_running = (reader_thread != NULL);
+    stopReaderThread();
+    thread_cfg = cfg;
+    
+    #if USE_ASYNC
+        if (thread_cfg.prefault_buffers && rx_queue)
+        {
+            resetRxQueue();
+            rx_queue->prefault();
+            if (rx_dual_queue) rx_dual_queue->prefault();
+        }
+    #endif //USE_ASYNC
+    
+    if (reader_running) startReaderThread();
+}
+
+//=================================================================
+void SoapySDR::Stream::createRxQueues(void)
+{
+    #if USE_ASYNC
+        rx_queue = new spsc_circular_buffer<cariboulite_sample_complex_int16>(rx_chunk_len * rx_num_chunks, 
+                                                                         USE_ASYNC_OVERRIDE_WRITES, 
+                                                                         USE_ASYNC_BLOCK_READS);
+        interm_native_buffer1 = new cariboulite_sample_complex_int16[rx_chunk_len];
+        rx_anchors = new spsc_circular_buffer<rx_time_anchor_st>(rx_num_chunks * NUM_ANCHORS_PER_CHUNK, false, false);
+        
+        if (dual_radio)
+        {
+            rx_dual_queue = new spsc_circular_buffer<cariboulite_sample_complex_int16>(rx_chunk_len * rx_num_chunks, 
+                                                                                  USE_ASYNC_OVERRIDE_WRITES, 
+                                                                                  USE_ASYNC_BLOCK_READS);
+            interm_dual_buffer = new cariboulite_sample_complex_int16[rx_chunk_len];
+        }
+        
+        if (thread_cfg.prefault_buffers)
+        {
+            rx_queue->prefault();
+            if (rx_dual_queue) rx_dual_queue->prefault();
+            cariboulite_prefault_buffer(&thread_cfg, interm_native_buffer1, rx_chunk_len * sizeof(cariboulite_sample_complex_int16));
+            cariboulite_prefault_buffer(&thread_cfg, interm_dual_buffer, rx_chunk_len * sizeof(cariboulite_sample_complex_int16));
+        }
+    #endif //USE_ASYNC
+}
+
+//=================================================================
+void SoapySDR::Stream::destroyRxQueues(void)
+{
+    #if USE_ASYNC
         if (interm_native_buffer1) delete[] interm_native_buffer1;
+        if (interm_dual_buffer) delete[] interm_dual_buffer;
         if (rx_queue) delete rx_queue;
+        if (rx_dual_queue) delete rx_dual_queue;
+        if (rx_anchors) delete rx_anchors;
+        interm_native_buffer1 = NULL;
+        interm_dual_buffer = NULL;
+        rx_queue = NULL;
+        rx_dual_queue = NULL;
+        rx_anchors = NULL;
     #endif //USE_ASYNC
+}
+
+//=================================================================
+int SoapySDR::Stream::setRxQueueSize(size_t num_buffers, size_t buffer_len)
+{
+    if (num_buffers < 2 || buffer_len == 0)
+    {
+        return -1;
+    }
     
-    if (interm_native_buffer2) delete[] interm_native_buffer2;
-    if (interm_native_meta) delete[] interm_native_meta;
+    #if USE_ASYNC
+        if (num_buffers == rx_num_chunks && buffer_len == rx_chunk_len)
+        {
+            return 0;
+        }
+        
+        // the reader thread owns 'interm_native_buffer1' and the producer side
+        // of the queue - hold it while both are replaced
+        bool reader_running = (reader_thread != NULL);
+        stopReaderThread();
+        dropRxDirectSpans();
+        destroyRxQueues();
+
+        rx_chunk_len = buffer_len;
+        rx_num_chunks = num_buffers;
+        createRxQueues();
+        rx_reported_overflows = 0;
+        rx_dual_dropped = 0;
+        rx_dual_pending.clear();
+        rx_queued = 0;
+        rx_consumed = 0;
+        rx_anchor_valid = false;
+        rx_anchor_next_valid = false;
+        rx_anchor_pending_valid = false;
+        
+        SoapySDR_logf(SOAPY_SDR_INFO, "RX queue: %d buffers x %d I/Q samples", rx_num_chunks, rx_chunk_len);
+        if (reader_running) startReaderThread();
+    #endif //USE_ASYNC
+    return 0;
+}
+
+//=================================================================
+// Switches the RX stream between a single channel (other_radio = NULL) and both
+// channels, where 'other_radio' becomes the second channel of the stream
+int SoapySDR::Stream::setRxDual(cariboulite_radio_state_st *other_radio)
+{
+    #if USE_ASYNC
+        if (other_radio == dual_radio)
+        {
+            return 0;
+        }
+        
+        bool reader_running = (reader_thread != NULL);
+        stopReaderThread();
+        dropRxDirectSpans();
+        destroyRxQueues();
+        dual_radio = other_radio;
+        createRxQueues();
+        rx_reported_overflows = 0;
+        rx_dual_dropped = 0;
+        rx_dual_pending.clear();
+        rx_queued = 0;
+        rx_consumed = 0;
+        rx_anchor_valid = false;
+        rx_anchor_next_valid = false;
+        rx_anchor_pending_valid = false;
+        if (reader_running) startReaderThread();
+        return 0;
+    #else
+        // the dual stream is demultiplexed by the reader thread
+        return (other_radio == NULL) ? 0 : -1;
+    #endif //USE_ASYNC
+}
+
+//=================================================================
+void SoapySDR::Stream::resetRxQueue(void)
+{
+    #if USE_ASYNC
+        // samples queued before (re)activation are stale - drop them without
+        // reporting them as an overflow
+        dropRxDirectSpans();
+        rx_consumed += rx_queue->reset();
+        rx_reported_overflows = rx_queue->overflows() + rx_dual_dropped;
+        if (rx_dual_queue)
+        {
+            rx_dual_queue->reset();
+            rx_reported_overflows += rx_dual_queue->overflows();
+        }
+        rx_dual_pending.clear();
+    #endif //USE_ASYNC
+    
+    // the sample clock is re-based on the first chunk after (re)activation
+    rx_time_base_valid = false;
+}
+
+//=================================================================
+int SoapySDR::Stream::checkRxOverflow(void)
+{
+    #if USE_ASYNC
+        uint64_t overflows = rx_queue->overflows() + rx_dual_dropped + (rx_dual_queue ? rx_dual_queue->overflows() : 0);
+        if (overflows != rx_reported_overflows)
+        {
+            uint64_t dropped = overflows - rx_reported_overflows;
+            rx_reported_overflows = overflows;
+            rx_dropped_samples += dropped;
+            SoapySDR_logf(SOAPY_SDR_DEBUG, "RX overflow: %llu samples dropped", (unsigned long long)dropped);
+            SoapySDR_log(SOAPY_SDR_SSI, "O");
+            return SOAPY_SDR_OVERFLOW;
+        }
+    #endif //USE_ASYNC
+    return 0;
+}
+
+//=================================================================
+void SoapySDR::Stream::makeRxTimeAnchor(rx_time_anchor_st* anchor, uint64_t queue_pos, size_t num_samples)
+{
+    cariboulite_radio_rx_info_st info;
+    anchor->queue_pos = queue_pos;
+
+    // the driver's stream position counts the words of both channels of a dual
+    // stream - the channel's own sample count is used instead
+    int ret = cariboulite_radio_get_rx_info(radio, &info);
+    if (ret == 0 && dual_radio == NULL)
+    {
+        anchor->sample_index = info.sample_index;
+        anchor->timestamp_ns = info.timestamp_ns;
+    }
+    else
+    {
+        // no accounting from the driver - count the samples read here and
+        // back-date the chunk from the time its last sample arrived
+        anchor->sample_index = rx_reader_samples;
+        anchor->timestamp_ns = monotonicTimeNs() - (uint64_t)num_samples * 1000000000ULL / info.sample_rate;
+    }
+    anchor->sample_rate = info.sample_rate;
+    rx_reader_samples += num_samples;
+}
+
+//=================================================================
+// Anchors that find the queue full are counted and not lost for good - the
+// latest of them is retried ahead of the next one. Its sample index counts
+// every sample lost before it, so a newer anchor at the same queue position
+// (or one replacing it when the queue is still full) folds in the lost
+// samples of the anchors dropped before it, and the clock stays continuous.
+void SoapySDR::Stream::queueRxTimeAnchor(const rx_time_anchor_st& anchor)
+{
+    if (rx_anchor_pending_valid)
+    {
+        if (rx_anchor_pending.queue_pos == anchor.queue_pos ||
+            rx_anchors->put(&rx_anchor_pending, 1) == 1)
+        {
+            rx_anchor_pending_valid = false;
+        }
+    }
+
+    // queued in order - not ahead of a pending one
+    if (rx_anchor_pending_valid || rx_anchors->put(&anchor, 1) != 1)
+    {
+        rx_anchor_pending = anchor;
+        rx_anchor_pending_valid = true;
+        rx_anchors_dropped++;
+    }
+}
+
+//=================================================================
+void SoapySDR::Stream::syncRxTimeAnchor(size_t num_samples)
+{
+    // synchronous reads - the radio reports the timing of exactly this read,
+    // only the first one of a converted multi-MTU read is kept
+    if (rx_consumed == rx_read_pos)
+    {
+        makeRxTimeAnchor(&rx_anchor, rx_consumed, num_samples);
+        rx_anchor_valid = true;
+    }
+    else
+    {
+        rx_reader_samples += num_samples;
+    }
+    rx_consumed += num_samples;
+}
+
+//=================================================================
+bool SoapySDR::Stream::getRxReadTime(long long &time_ns)
+{
+    #if USE_ASYNC
+        // move to the latest anchor at or before the read position
+        while (true)
+        {
+            if (!rx_anchor_next_valid)
+            {
+                rx_anchor_next_valid = rx_anchors->get(&rx_anchor_next, 1, 0) == 1;
+                if (!rx_anchor_next_valid) break;
+            }
+            if (rx_anchor_next.queue_pos > rx_read_pos) break;
+            
+            rx_anchor = rx_anchor_next;
+            rx_anchor_valid = true;
+            rx_anchor_next_valid = false;
+        }
+    #endif //USE_ASYNC
+    
+    if (!rx_anchor_valid || rx_anchor.sample_rate == 0 || rx_read_pos < rx_anchor.queue_pos)
+    {
+        return false;
+    }
+    
+    // the clock counts samples from the base anchor, so it only jumps when
+    // samples were actually lost. Re-based when the sample rate changes.
+    if (!rx_time_base_valid || rx_time_base.sample_rate != rx_anchor.sample_rate)
+    {
+        rx_time_base = rx_anchor;
+        rx_time_base_valid = true;
+    }
+    
+    uint64_t sample_index = rx_anchor.sample_index + (rx_read_pos - rx_anchor.queue_pos);
+    if (sample_index < rx_time_base.sample_index)
+    {
+        return false;
+    }
+
+    uint64_t since_base = sample_index - rx_time_base.sample_index;
+    time_ns = (long long)(rx_time_base.timestamp_ns + 
+                    (since_base / rx_time_base.sample_rate) * 1000000000ULL +
+                    (since_base % rx_time_base.sample_rate) * 1000000000ULL / rx_time_base.sample_rate) + 
+              hw_time_offset_ns.load();
+    return true;
+}
+
+//=================================================================
+long long SoapySDR::Stream::getHardwareTime(void)
+{
+    // the sample clock is based on CLOCK_MONOTONIC - 'now' in its terms
+    return (long long)monotonicTimeNs() + hw_time_offset_ns.load();
+}
+
+//=================================================================
+void SoapySDR::Stream::setHardwareTime(long long time_ns)
+{
+    hw_time_offset_ns = time_ns - (long long)monotonicTimeNs();
 }
 
 //=================================================================
@@ -157,6 +598,9 @@ void SoapySDR::Stream::setInnerStreamType(cariboulite_channel_dir_en direction)
 //=================================================================
 int SoapySDR::Stream::setFormat(const std::string &fmt)
 {
+    // held back samples are stored in the previous format
+    rx_dual_pending.clear();
+
 	if (!fmt.compare(SOAPY_SDR_CS16))
 		format = CARIBOULITE_FORMAT_INT16;
 	else if (!fmt.compare(SOAPY_SDR_CS8))
@@ -196,38 +640,40 @@ int SoapySDR::Stream::WriteSamples(cariboulite_sample_complex_int16* buffer, siz
 }
 
 //=================================================================
-int SoapySDR::Stream::WriteSamples(sample_complex_float* buffer, size_t num_elements, long timeout_us)
+int SoapySDR::Stream::WritePacked(const uint32_t* packed, size_t num_elements, long timeout_us)
 {
-    num_elements = num_elements > mtu_size ? mtu_size : num_elements;
-    float max_val = 4096.0;
-
-    for (size_t i = 0; i < num_elements; i++)
+    int ret = cariboulite_radio_write_packed_samples(radio, packed, num_elements);
+    if (ret < 0)
     {
-        interm_native_buffer2[i].i = (int16_t)(buffer[i].i * max_val);
-        interm_native_buffer2[i].q = (int16_t)(buffer[i].q * max_val);
-
+        if (ret == -1)
+        {
+            printf("Failed to write\n");
+        }
+        ret = 0;
     }
-
-    return WriteSamples(interm_native_buffer2, num_elements, timeout_us);
+    return ret;
 }
 
 //=================================================================
-int SoapySDR::Stream::WriteSamples(sample_complex_double* buffer, size_t num_elements, long timeout_us)
+int SoapySDR::Stream::WriteSamples(sample_complex_float* buffer, size_t num_elements, long timeout_us)
 {
     num_elements = num_elements > mtu_size ? mtu_size : num_elements;
-    double max_val = 4096.0;
 
-    for (size_t i = 0; i < num_elements; i++)
-    {
-        interm_native_buffer2[i].i = (int16_t)(buffer[i].i * max_val);
-        interm_native_buffer2[i].q = (int16_t)(buffer[i].q * max_val);
+    // scaling, saturation and packing in a single pass
+    cariboulite_radio_pack_samples_cf32(radio, (const cariboulite_sample_complex_float*)buffer, interm_packed_buffer, num_elements);
+    return WritePacked(interm_packed_buffer, num_elements, timeout_us);
+}
 
-    }
+//=================================================================
+int SoapySDR::Stream::WriteSamples(sample_complex_double* buffer, size_t num_elements, long timeout_us)
+{
+    num_elements = num_elements > mtu_size ? mtu_size : num_elements;
 
-    return WriteSamples(interm_native_buffer2, num_elements, timeout_us);
+    // scaling, saturation and packing in a single pass
+    cariboulite_radio_pack_samples_cf64(radio, (const cariboulite_sample_complex_double*)buffer, interm_packed_buffer, num_elements);
+    return WritePacked(interm_packed_buffer, num_elements, timeout_us);
 }
 
-
 //=================================================================
 int SoapySDR::Stream::WriteSamples(sample_complex_int8* buffer, size_t num_elements, long timeout_us)
 {
@@ -257,12 +703,23 @@ int SoapySDR::Stream::WriteSamplesGen(void* buffer, size_t num_elements, long ti
 	return 0;
 }
 //=================================================================
-int SoapySDR::Stream::Read(cariboulite_sample_complex_int16 *buffer, size_t num_samples, uint8_t *meta, long timeout_us)
+int SoapySDR::Stream::Read(cariboulite_sample_complex_int16 *buffer, size_t num_samples, uint8_t *meta, long timeout_us, size_t channel)
 {
     #if USE_ASYNC
-        return rx_queue->get(buffer, num_samples, timeout_us);
+        if (channel != 0)
+        {
+            // the second channel follows the first one read by 'ReadSamplesDual'
+            return rx_dual_queue ? rx_dual_queue->get(buffer, num_samples, timeout_us) : 0;
+        }
+        
+        // wait for at most one reader chunk, then take whatever is queued up
+        // to 'num_samples' so that a read may span several chunks
+        size_t ret = rx_queue->get(buffer, num_samples, timeout_us, std::min(num_samples, rx_chunk_len));
+        rx_consumed += ret;
+        return ret;
     #else                                                        // caribou_smi_sample_meta not defined...
         int ret = cariboulite_radio_read_samples(radio, buffer, (cariboulite_sample_meta*)meta, num_samples);
+        if (ret > 0) syncRxTimeAnchor(ret);
         if (ret < 0)
         {
             if (ret == -1)
@@ -279,16 +736,17 @@ int SoapySDR::Stream::Read(cariboulite_sample_complex_int16 *buffer, size_t num_
 }
 
 //=================================================================
-int SoapySDR::Stream::ReadSamples(cariboulite_sample_complex_int16* buffer, size_t num_elements, long timeout_us)
+int SoapySDR::Stream::ReadSamples(cariboulite_sample_complex_int16* buffer, size_t num_elements, long timeout_us, size_t channel)
 {
-    int res = Read(buffer, num_elements, NULL, timeout_us);
+    int res = Read(buffer, num_elements, NULL, timeout_us, channel);
     if (res < 0)
     {
         //SoapySDR_logf(SOAPY_SDR_ERROR, "Reading %d elements failed from queue", num_elements); 
         return res;
     }
     
-	if (filterType != DigitalFilter_None && filter_i != NULL && filter_q != NULL)
+	// the filters keep state - they are applied to the first channel only
+	if (channel == 0 && filterType != DigitalFilter_None && filter_i != NULL && filter_q != NULL)
 	{
 		for (int i = 0; i < res; i++)
 		{
@@ -301,82 +759,472 @@ int SoapySDR::Stream::ReadSamples(cariboulite_sample_complex_int16* buffer, size
 }
 
 //=================================================================
-int SoapySDR::Stream::ReadSamples(sample_complex_float* buffer, size_t num_elements, long timeout_us)
+// Unfiltered async reads - the samples are scaled straight out of the queue
+// into the user's buffer, a single pass without the intermediate native buffer.
+// Waits like 'Read' for at most one reader chunk, then takes what is queued.
+template <class S>
+int SoapySDR::Stream::ReadQueueConverted(S* buffer, size_t num_elements, long timeout_us, size_t channel)
 {
-    num_elements = num_elements > mtu_size ? mtu_size : num_elements;
+    spsc_circular_buffer<cariboulite_sample_complex_int16>* queue = channel ? rx_dual_queue : rx_queue;
+    const decltype(buffer->i) max_val = 4096;
+    size_t total = 0;
 
-    // read out the native data type
-    int res = ReadSamples(interm_native_buffer2, num_elements, timeout_us);
-    if (res < 0)
+    if (queue == NULL) return 0;
+
+    // the window ends at the wrap point of the queue - the second round takes
+    // the rest without waiting
+    while (total < num_elements)
     {
-        return res;
+        const cariboulite_sample_complex_int16* src = NULL;
+        size_t left = num_elements - total;
+        size_t len = queue->peek(&src, left, total ? 0 : timeout_us, total ? 1 : std::min(left, rx_chunk_len));
+        if (len == 0) break;
+
+        for (size_t i = 0; i < len; i++)
+        {
+            buffer[total + i].i = src[i].i / max_val;
+            buffer[total + i].q = src[i].q / max_val;
+        }
+        queue->consume(len);
+        total += len;
     }
 
+    if (channel == 0) rx_consumed += total;
+    return total;
+}
+
+//=================================================================
+int SoapySDR::Stream::ReadSamples(sample_complex_float* buffer, size_t num_elements, long timeout_us, size_t channel)
+{
+    // unfiltered reads are converted in a single pass - out of the async queue,
+    // or decoded by the driver directly into the user's buffer when synchronous
+    #if USE_ASYNC
+        if (filterType == DigitalFilter_None || channel != 0)
+        {
+            return ReadQueueConverted(buffer, num_elements, timeout_us, channel);
+        }
+    #else
+        if (filterType == DigitalFilter_None && channel == 0)
+        {
+            int ret = cariboulite_radio_read_samples_cf32(radio, (cariboulite_sample_complex_float*)buffer, NULL, num_elements);
+            if (ret > 0) syncRxTimeAnchor(ret);
+            return (ret < 0) ? 0 : ret;
+        }
+    #endif //USE_ASYNC
+
     float max_val = 4096.0f;
+    size_t total = 0;
 
-    for (int i = 0; i < res; i++)
+    // converted an MTU at a time - only the first chunk waits for data
+    while (total < num_elements)
     {
-        buffer[i].i = (float)(interm_native_buffer2[i].i) / max_val;
-        buffer[i].q = (float)(interm_native_buffer2[i].q) / max_val;
+        size_t len = std::min(num_elements - total, mtu_size);
+        int res = ReadSamples(interm_native_buffer2, len, total ? 0 : timeout_us, channel);
+        if (res <= 0)
+        {
+            return total ? total : res;
+        }
+
+        for (int i = 0; i < res; i++)
+        {
+            buffer[total + i].i = (float)(interm_native_buffer2[i].i) / max_val;
+            buffer[total + i].q = (float)(interm_native_buffer2[i].q) / max_val;
+        }
+        total += res;
+        if ((size_t)res < len) break;
     }
-    return res;
+    return total;
 }
 
 //=================================================================
-int SoapySDR::Stream::ReadSamples(sample_complex_double* buffer, size_t num_elements, long timeout_us)
+int SoapySDR::Stream::ReadSamples(sample_complex_double* buffer, size_t num_elements, long timeout_us, size_t channel)
 {
-    num_elements = num_elements > mtu_size ? mtu_size : num_elements;
+    #if USE_ASYNC
+        if (filterType == DigitalFilter_None || channel != 0)
+        {
+            return ReadQueueConverted(buffer, num_elements, timeout_us, channel);
+        }
+    #else
+        if (filterType == DigitalFilter_None && channel == 0)
+        {
+            int ret = cariboulite_radio_read_samples_cf64(radio, (cariboulite_sample_complex_double*)buffer, NULL, num_elements);
+            if (ret > 0) syncRxTimeAnchor(ret);
+            return (ret < 0) ? 0 : ret;
+        }
+    #endif //USE_ASYNC
 
-    // read out the native data type
-    int res = ReadSamples(interm_native_buffer2, num_elements, timeout_us);
-    if (res < 0)
+    double max_val = 4096.0;
+    size_t total = 0;
+
+    while (total < num_elements)
     {
-        return res;
+        size_t len = std::min(num_elements - total, mtu_size);
+        int res = ReadSamples(interm_native_buffer2, len, total ? 0 : timeout_us, channel);
+        if (res <= 0)
+        {
+            return total ? total : res;
+        }
+
+        for (int i = 0; i < res; i++)
+        {
+            buffer[total + i].i = (double)(interm_native_buffer2[i].i) / max_val;
+            buffer[total + i].q = (double)(interm_native_buffer2[i].q) / max_val;
+        }
+        total += res;
+        if ((size_t)res < len) break;
     }
+    return total;
+}
 
-    double max_val = 4096.0;
+//=================================================================
+int SoapySDR::Stream::ReadSamples(sample_complex_int8* buffer, size_t num_elements, long timeout_us, size_t channel)
+{
+    size_t total = 0;
 
-    for (int i = 0; i < res; i++)
+    while (total < num_elements)
     {
-        buffer[i].i = (double)(interm_native_buffer2[i].i) / max_val;
-        buffer[i].q = (double)(interm_native_buffer2[i].q) / max_val;
+        size_t len = std::min(num_elements - total, mtu_size);
+        int res = ReadSamples(interm_native_buffer2, len, total ? 0 : timeout_us, channel);
+        if (res <= 0)
+        {
+            return total ? total : res;
+        }
+
+        for (int i = 0; i < res; i++)
+        {
+            buffer[total + i].i = (int8_t)((interm_native_buffer2[i].i >> 5)&0x00FF);
+            buffer[total + i].q = (int8_t)((interm_native_buffer2[i].q >> 5)&0x00FF);
+        }
+        total += res;
+        if ((size_t)res < len) break;
     }
+    return total;
+}
 
-    return res;
+//=================================================================
+int SoapySDR::Stream::ReadSamplesGen(void* buffer, size_t num_elements, long timeout_us, size_t channel)
+{
+    //printf("reading ne=%d\n", num_elements);
+    if (channel == 0)
+    {
+        int overflow = checkRxOverflow();
+        if (overflow != 0)
+        {
+            return overflow;
+        }
+
+        if (rx_direct_peeked != 0)
+        {
+            // the queue's head is held by direct access buffers
+            SoapySDR_logf(SOAPY_SDR_ERROR, "readStream: %d direct access buffers are not released", (int)rx_direct_held);
+            return SOAPY_SDR_STREAM_ERROR;
+        }
+        rx_read_pos = rx_consumed;
+    }
+	switch (format)
+	{
+		case CARIBOULITE_FORMAT_FLOAT32: return ReadSamples((sample_complex_float*)buffer, num_elements, timeout_us, channel); break;
+	    case CARIBOULITE_FORMAT_INT16: return ReadSamples((cariboulite_sample_complex_int16*)buffer, num_elements, timeout_us, channel); break;
+	    case CARIBOULITE_FORMAT_INT8: return ReadSamples((sample_complex_int8*)buffer, num_elements, timeout_us, channel); break;
+	    case CARIBOULITE_FORMAT_FLOAT64: return ReadSamples((sample_complex_double*)buffer, num_elements, timeout_us, channel); break;
+		default: return ReadSamples((cariboulite_sample_complex_int16*)buffer, num_elements, timeout_us, channel); break;
+	}
+	return 0;
 }
 
 //=================================================================
-int SoapySDR::Stream::ReadSamples(sample_complex_int8* buffer, size_t num_elements, long timeout_us)
+size_t SoapySDR::Stream::getFormatSize(void)
 {
-    num_elements = num_elements > mtu_size ? mtu_size : num_elements;
+	switch (format)
+	{
+		case CARIBOULITE_FORMAT_FLOAT32: return sizeof(sample_complex_float);
+	    case CARIBOULITE_FORMAT_INT8: return sizeof(sample_complex_int8);
+	    case CARIBOULITE_FORMAT_FLOAT64: return sizeof(sample_complex_double);
+		default: return sizeof(cariboulite_sample_complex_int16);
+	}
+}
 
-    // read out the native data type
-    int res = ReadSamples(interm_native_buffer2, num_elements, timeout_us);
-    if (res < 0)
+//=================================================================
+// Reads both channels of a dual RX stream - the same number of elements is
+// returned on both. The second channel's chunk is queued right after the first
+// one's, so it may be a little behind - first channel samples it doesn't cover
+// yet are held back and returned first by the next call
+int SoapySDR::Stream::ReadSamplesDual(void* const* buffers, size_t num_elements, long timeout_us)
+{
+    if (dual_radio == NULL)
     {
-        return res;
+        return ReadSamplesGen(buffers[0], num_elements, timeout_us, 0);
+    }
+
+    // the reader thread drops chunks from both queues together, so an overflow
+    // doesn't break the pairing - the held back samples stay valid
+    int overflow = checkRxOverflow();
+    if (overflow != 0)
+    {
+        return overflow;
+    }
+
+    size_t elem_size = getFormatSize();
+    uint8_t* out0 = (uint8_t*)buffers[0];
+    size_t held = rx_dual_pending.size() / elem_size;
+    uint64_t read_pos = rx_consumed - held;
+    size_t total = std::min(held, num_elements);
+    
+    memcpy(out0, rx_dual_pending.data(), total * elem_size);
+    rx_dual_pending.erase(rx_dual_pending.begin(), rx_dual_pending.begin() + total * elem_size);
+    
+    if (total < num_elements)
+    {
+        int ret = ReadSamplesGen(out0 + total * elem_size, num_elements - total, total ? 0 : timeout_us, 0);
+        if (ret < 0)
+        {
+            rx_dual_pending.insert(rx_dual_pending.begin(), out0, out0 + total * elem_size);
+            return ret;
+        }
+        total += ret;
+    }
+    rx_read_pos = read_pos;
+    if (total == 0)
+    {
+        return 0;
+    }
+    
+    int ret_dual = ReadSamplesGen(buffers[1], total, timeout_us, 1);
+    size_t paired = (ret_dual > 0) ? ret_dual : 0;
+    if (paired < total)
+    {
+        SoapySDR_logf(SOAPY_SDR_DEBUG, "dual RX: second channel short by %d samples", (int)(total - paired));
+        rx_dual_pending.insert(rx_dual_pending.begin(), out0 + paired * elem_size, out0 + total * elem_size);
+    }
+    return (ret_dual < 0) ? ret_dual : (int)paired;
+}
+
+//=================================================================
+cariboulite_sample_complex_int16* SoapySDR::Stream::getDirectAccessBuffer(size_t handle)
+{
+    if (handle >= NUM_DIRECT_ACCESS_BUFFERS)
+    {
+        return NULL;
+    }
+    return direct_buffer_pool + handle * mtu_size;
+}
+
+//=================================================================
+int SoapySDR::Stream::AcquireBuffer(size_t &handle)
+{
+    // buffers are normally acquired and released in order, so the next one
+    // in line is usually free - the scan only matters for out-of-order releases
+    for (size_t i = 0; i < NUM_DIRECT_ACCESS_BUFFERS; i++)
+    {
+        size_t h = (direct_buffer_next + i) % NUM_DIRECT_ACCESS_BUFFERS;
+        if (!direct_buffer_acquired[h])
+        {
+            direct_buffer_acquired[h] = true;
+            direct_buffer_next = (h + 1) % NUM_DIRECT_ACCESS_BUFFERS;
+            handle = h;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+//=================================================================
+// Hands out the next samples of the RX queue in place - the span stays in the
+// queue until it is released. Filtered (and synchronous) streams have no
+// unfiltered samples to hand out, they are read into the pool buffer instead.
+int SoapySDR::Stream::AcquireReadBuffer(size_t &handle, const void **buffs, long timeout_us)
+{
+    int overflow = checkRxOverflow();
+    if (overflow != 0)
+    {
+        return overflow;
+    }
+
+    if (AcquireBuffer(handle) != 0)
+    {
+        SoapySDR_logf(SOAPY_SDR_ERROR, "AcquireReadBuffer: all %d direct access buffers are in use", NUM_DIRECT_ACCESS_BUFFERS);
+        return SOAPY_SDR_STREAM_ERROR;
     }
 
-    for (int i = 0; i < res; i++)
+    #if USE_ASYNC
+        if (filterType == DigitalFilter_None)
+        {
+            // the span starts after the ones still held - wait for at most one
+            // reader chunk, a span ends at the queue's wrap point
+            const cariboulite_sample_complex_int16* span = NULL;
+            rx_read_pos = rx_consumed + rx_direct_peeked;
+            size_t len = rx_queue->peek_at(&span, rx_direct_peeked, mtu_size, timeout_us, std::min(mtu_size, rx_chunk_len));
+            if (len == 0)
+            {
+                ReleaseBuffer(handle);
+                return SOAPY_SDR_TIMEOUT;
+            }
+
+            rx_direct_ptr[handle] = span;
+            rx_direct_len[handle] = len;
+            rx_direct_released[handle] = false;
+            rx_direct_order[(rx_direct_first + rx_direct_held) % NUM_DIRECT_ACCESS_BUFFERS] = handle;
+            rx_direct_held++;
+            rx_direct_peeked += len;
+            buffs[0] = span;
+            return len;
+        }
+
+        if (rx_direct_peeked != 0)
+        {
+            ReleaseBuffer(handle);
+            SoapySDR_logf(SOAPY_SDR_ERROR, "AcquireReadBuffer: %d direct access buffers are not released", (int)rx_direct_held);
+            return SOAPY_SDR_STREAM_ERROR;
+        }
+    #endif //USE_ASYNC
+
+    rx_read_pos = rx_consumed;
+    cariboulite_sample_complex_int16* buffer = getDirectAccessBuffer(handle);
+    int res = ReadSamples(buffer, mtu_size, timeout_us);
+    if (res <= 0)
     {
-        buffer[i].i = (int8_t)((interm_native_buffer2[i].i >> 5)&0x00FF);
-        buffer[i].q = (int8_t)((interm_native_buffer2[i].q >> 5)&0x00FF);
+        ReleaseBuffer(handle);
+        return (res < 0) ? res : SOAPY_SDR_TIMEOUT;
     }
 
+    rx_direct_ptr[handle] = buffer;
+    rx_direct_len[handle] = 0;
+    rx_direct_released[handle] = false;
+    rx_direct_order[(rx_direct_first + rx_direct_held) % NUM_DIRECT_ACCESS_BUFFERS] = handle;
+    rx_direct_held++;
+    buffs[0] = buffer;
     return res;
 }
 
 //=================================================================
-int SoapySDR::Stream::ReadSamplesGen(void* buffer, size_t num_elements, long timeout_us)
+// Spans are consumed from the queue in the order they were handed out - an out
+// of order release holds its buffer until the older ones are released too
+void SoapySDR::Stream::ReleaseReadBuffer(size_t handle)
 {
-    //printf("reading ne=%d\n", num_elements);
-	switch (format)
-	{
-		case CARIBOULITE_FORMAT_FLOAT32: return ReadSamples((sample_complex_float*)buffer, num_elements, timeout_us); break;
-	    case CARIBOULITE_FORMAT_INT16: return ReadSamples((cariboulite_sample_complex_int16*)buffer, num_elements, timeout_us); break;
-	    case CARIBOULITE_FORMAT_INT8: return ReadSamples((sample_complex_int8*)buffer, num_elements, timeout_us); break;
-	    case CARIBOULITE_FORMAT_FLOAT64: return ReadSamples((sample_complex_double*)buffer, num_elements, timeout_us); break;
-		default: return ReadSamples((cariboulite_sample_complex_int16*)buffer, num_elements, timeout_us); break;
-	}
-	return 0;
-}
\ No newline at end of file
+    if (handle >= NUM_DIRECT_ACCESS_BUFFERS || !direct_buffer_acquired[handle])
+    {
+        return;
+    }
+
+    rx_direct_released[handle] = true;
+    while (rx_direct_held > 0)
+    {
+        size_t h = rx_direct_order[rx_direct_first];
+        if (!rx_direct_released[h]) break;
+
+        if (rx_direct_len[h] != 0)
+        {
+            rx_queue->consume(rx_direct_len[h]);
+            rx_consumed += rx_direct_len[h];
+            rx_direct_peeked -= rx_direct_len[h];
+        }
+        rx_direct_ptr[h] = NULL;
+        rx_direct_first = (rx_direct_first + 1) % NUM_DIRECT_ACCESS_BUFFERS;
+        rx_direct_held--;
+        ReleaseBuffer(h);
+    }
+}
+
+//=================================================================
+const void* SoapySDR::Stream::getReadBufferAddr(size_t handle)
+{
+    if (handle >= NUM_DIRECT_ACCESS_BUFFERS || !direct_buffer_acquired[handle])
+    {
+        return NULL;
+    }
+    return rx_direct_ptr[handle];
+}
+
+//=================================================================
+// The queue is reset or replaced - the spans still held are dropped with it,
+// releasing them later consumes nothing
+void SoapySDR::Stream::dropRxDirectSpans(void)
+{
+    for (size_t i = 0; i < rx_direct_held; i++)
+    {
+        size_t h = rx_direct_order[(rx_direct_first + i) % NUM_DIRECT_ACCESS_BUFFERS];
+        if (rx_direct_len[h] != 0)
+        {
+            rx_direct_len[h] = 0;
+            rx_direct_ptr[h] = NULL;
+        }
+    }
+    rx_direct_peeked = 0;
+}
+
+//=================================================================
+int SoapySDR::Stream::AcquireWriteBuffer(size_t &handle, void **buffs, long timeout_us)
+{
+    int error = takeTxError();
+    if (error != 0)
+    {
+        return error;
+    }
+
+    if (AcquireBuffer(handle) != 0)
+    {
+        SoapySDR_logf(SOAPY_SDR_ERROR, "AcquireWriteBuffer: all %d direct access buffers are in use", NUM_DIRECT_ACCESS_BUFFERS);
+        return SOAPY_SDR_STREAM_ERROR;
+    }
+
+    // the release has no timeout of its own - it gets the acquire's
+    direct_buffer_timeout_us[handle] = timeout_us;
+    buffs[0] = getDirectAccessBuffer(handle);
+    return mtu_size;
+}
+
+//=================================================================
+// Transmits the buffer within the timeout given when it was acquired. A failure
+// can't be returned through releaseWriteBuffer - it is kept and returned by the
+// next writeStream / acquireWriteBuffer call
+int SoapySDR::Stream::ReleaseWriteBuffer(size_t handle, size_t num_elements)
+{
+    cariboulite_sample_complex_int16* buffer = getDirectAccessBuffer(handle);
+    if (buffer == NULL)
+    {
+        return SOAPY_SDR_STREAM_ERROR;
+    }
+
+    num_elements = num_elements > mtu_size ? mtu_size : num_elements;
+    uint64_t deadline = monotonicTimeNs() + (uint64_t)std::max(direct_buffer_timeout_us[handle], 0L) * 1000;
+    size_t written = 0;
+    int res = 0;
+    while (written < num_elements)
+    {
+        res = cariboulite_radio_write_samples(radio, buffer + written, num_elements - written);
+        if (res < 0)
+        {
+            // debug streams (-2) are not transmitted
+            if (res == -2) written = num_elements;
+            break;
+        }
+        written += res;
+        if (res == 0 && monotonicTimeNs() >= deadline) break;
+    }
+    ReleaseBuffer(handle);
+
+    if (written < num_elements)
+    {
+        SoapySDR_logf(SOAPY_SDR_ERROR, "ReleaseWriteBuffer: %d of %d samples transmitted", (int)written, (int)num_elements);
+        tx_error = (res < 0) ? SOAPY_SDR_STREAM_ERROR : SOAPY_SDR_TIMEOUT;
+        return tx_error;
+    }
+    return written;
+}
+
+//=================================================================
+int SoapySDR::Stream::takeTxError(void)
+{
+    int error = tx_error;
+    tx_error = 0;
+    return error;
+}
+
+//=================================================================
+void SoapySDR::Stream::ReleaseBuffer(size_t handle)
+{
+    if (handle < NUM_DIRECT_ACCESS_BUFFERS)
+    {
+        direct_buffer_acquired[handle] = false;
+    }
+}
@@ -12,16 +12,20 @@
 #include <cstring>
 #include <algorithm>
 #include <atomic>
+#include <vector>
 #include <Iir.h>
 
 //#define ZF_LOG_LEVEL ZF_LOG_ERROR
 #define ZF_LOG_LEVEL ZF_LOG_VERBOSE
 
-#include "datatypes/circular_buffer.h"
+#include "datatypes/spsc_circular_buffer.h"
 #include "cariboulite_setup.h"
 #include "cariboulite_radio.h"
+#include "cariboulite.h"
 
 #define DIG_FILT_ORDER		6
+#define NUM_DIRECT_ACCESS_BUFFERS	8
+#define NUM_NATIVE_MTUS_PER_QUEUE	10
 
 #pragma pack(1)
 // associated with CS8 - total 2 bytes / element
@@ -60,6 +64,16 @@ typedef struct
 } sample_complex_double;
 #pragma pack()
 
+// Ties a position in the RX queue to the hardware stream - pushed by the reader
+// thread ahead of every chunk it queues
+typedef struct
+{
+    uint64_t queue_pos;             // queue position of the chunk's first sample
+    uint64_t sample_index;          // its position in the hardware stream (lost samples included)
+    uint64_t timestamp_ns;          // its capture time (CLOCK_MONOTONIC)
+    uint32_t sample_rate;
+} rx_time_anchor_st;
+
 // The forward declared Stream Class
 class SoapySDR::Stream 
 {
@@ -86,39 +100,128 @@ public:
 	Stream(cariboulite_radio_state_st *radio);
 	~Stream();
 	int Write(cariboulite_sample_complex_int16 *buffer, size_t num_samples, uint8_t* meta, long timeout_us);
-	int Read(cariboulite_sample_complex_int16 *buffer, size_t num_samples, uint8_t *meta, long timeout_us);
+	int Read(cariboulite_sample_complex_int16 *buffer, size_t num_samples, uint8_t *meta, long timeout_us, size_t channel = 0);
 
-	int ReadSamples(cariboulite_sample_complex_int16* buffer, size_t num_elements, long timeout_us);
-	int ReadSamples(sample_complex_float* buffer, size_t num_elements, long timeout_us);
-	int ReadSamples(sample_complex_double* buffer, size_t num_elements, long timeout_us);
-	int ReadSamples(sample_complex_int8* buffer, size_t num_elements, long timeout_us);
-	int ReadSamplesGen(void* buffer, size_t num_elements, long timeout_us);
+	int ReadSamples(cariboulite_sample_complex_int16* buffer, size_t num_elements, long timeout_us, size_t channel = 0);
+	int ReadSamples(sample_complex_float* buffer, size_t num_elements, long timeout_us, size_t channel = 0);
+	int ReadSamples(sample_complex_double* buffer, size_t num_elements, long timeout_us, size_t channel = 0);
+	int ReadSamples(sample_complex_int8* buffer, size_t num_elements, long timeout_us, size_t channel = 0);
+	int ReadSamplesGen(void* buffer, size_t num_elements, long timeout_us, size_t channel = 0);
+	size_t getFormatSize(void);
+	int ReadSamplesDual(void* const* buffers, size_t num_elements, long timeout_us);
     
     int WriteSamples(cariboulite_sample_complex_int16* buffer, size_t num_elements, long timeout_us);
 	int WriteSamples(sample_complex_float* buffer, size_t num_elements, long timeout_us);
 	int WriteSamples(sample_complex_double* buffer, size_t num_elements, long timeout_us);
 	int WriteSamples(sample_complex_int8* buffer, size_t num_elements, long timeout_us);
 	int WriteSamplesGen(void* buffer, size_t num_elements, long timeout_us);
+	int WritePacked(const uint32_t* packed, size_t num_elements, long timeout_us);
+
+	// direct buffer access - a pool of native (CS16) buffers, one MTU each, only
+	// offered when the stream format is CS16
+	bool isDirectAccessSupported(void) {return format == CARIBOULITE_FORMAT_INT16;}
+	size_t getNumDirectAccessBuffers(void) {return isDirectAccessSupported() ? NUM_DIRECT_ACCESS_BUFFERS : 0;}
+	cariboulite_sample_complex_int16* getDirectAccessBuffer(size_t handle);
+	int AcquireReadBuffer(size_t &handle, const void **buffs, long timeout_us);
+	void ReleaseReadBuffer(size_t handle);
+	const void* getReadBufferAddr(size_t handle);
+	int AcquireWriteBuffer(size_t &handle, void **buffs, long timeout_us);
+	int ReleaseWriteBuffer(size_t handle, size_t num_elements);
+	int takeTxError(void);
+	int AcquireBuffer(size_t &handle);
+	void ReleaseBuffer(size_t handle);
 
 	cariboulite_channel_dir_en getInnerStreamType(void);
     void setInnerStreamType(cariboulite_channel_dir_en dir);
 	void setDigitalFilter(DigitalFilterType type);
 	int setFormat(const std::string &fmt);
 	inline int readerThreadRunning() {return reader_thread_running;}
-    void activateStream(int active) {stream_active = active;}
+    void activateStream(int active);
+
+	// async RX queue - 'num_buffers' reader chunks of 'buffer_len' samples each
+	int setRxQueueSize(size_t num_buffers, size_t buffer_len);
+	int setRxDual(cariboulite_radio_state_st *other_radio);
+	bool isRxDual(void) {return dual_radio != NULL;}
+	void resetRxQueue(void);
+	int checkRxOverflow(void);
+	uint64_t getRxDroppedSamples(void) {return rx_dropped_samples;}
+	uint64_t getRxDroppedAnchors(void) {return rx_anchors_dropped;}
+	void startReaderThread(void);
+	void stopReaderThread(void);
+	void setThreadConfig(const cariboulite_thread_config_st& cfg);
+
+	// sample-counter hardware clock
+	void makeRxTimeAnchor(rx_time_anchor_st* anchor, uint64_t queue_pos, size_t num_samples);
+	void queueRxTimeAnchor(const rx_time_anchor_st& anchor);
+	void syncRxTimeAnchor(size_t num_samples);
+	bool getRxReadTime(long long &time_ns);
+	long long getHardwareTime(void);
+	void setHardwareTime(long long time_ns);
     
+private:
+	void dropRxDirectSpans(void);
+	void createRxQueues(void);
+	void destroyRxQueues(void);
+	template <class S> int ReadQueueConverted(S* buffer, size_t num_elements, long timeout_us, size_t channel);
+
 public:
     cariboulite_radio_state_st *radio;
+    cariboulite_radio_state_st *dual_radio;     // the second channel of a dual RX stream (or NULL)
     cariboulite_channel_dir_en native_dir;
     size_t mtu_size;
     std::thread *reader_thread;
     int stream_active;
     int reader_thread_running;
-	circular_buffer<cariboulite_sample_complex_int16> *rx_queue;
+    std::mutex reader_mutex;                // guards the two flags above for 'reader_cv'
+    std::condition_variable reader_cv;      // wakes the parked reader thread
+    cariboulite_thread_config_st thread_cfg;    // applied by the reader thread when it starts
+	spsc_circular_buffer<cariboulite_sample_complex_int16> *rx_queue;
+	spsc_circular_buffer<cariboulite_sample_complex_int16> *rx_dual_queue;
+    size_t rx_chunk_len;
+    size_t rx_num_chunks;
+    uint64_t rx_reported_overflows;
+    uint64_t rx_dropped_samples;
+    std::atomic<uint64_t> rx_dual_dropped;  // dual stream - samples dropped from both queues together
+    std::vector<uint8_t> rx_dual_pending;   // dual stream - first channel samples (user format) not paired yet
+
+    // hardware time - the reader side produces anchors, the read side tracks its
+    // queue position and derives the time of the first sample of each read
+    spsc_circular_buffer<rx_time_anchor_st> *rx_anchors;
+    rx_time_anchor_st rx_anchor_pending;    // reader thread - an anchor 'rx_anchors' had no room for
+    bool rx_anchor_pending_valid;
+    std::atomic<uint64_t> rx_anchors_dropped;
+    uint64_t rx_queued;                     // reader thread - samples put in 'rx_queue'
+    uint64_t rx_reader_samples;             // reader thread - samples read from the radio
+    uint64_t rx_consumed;                   // read side - samples taken out of 'rx_queue'
+    uint64_t rx_read_pos;                   // read side - position of the last read
+    rx_time_anchor_st rx_anchor;            // latest anchor at or before 'rx_read_pos'
+    rx_time_anchor_st rx_anchor_next;
+    bool rx_anchor_valid;
+    bool rx_anchor_next_valid;
+    bool rx_time_base_valid;
+    rx_time_anchor_st rx_time_base;         // the anchor the sample clock counts from
+    std::atomic<long long> hw_time_offset_ns;
     
 	cariboulite_sample_complex_int16 *interm_native_buffer1;
+	cariboulite_sample_complex_int16 *interm_dual_buffer;
     cariboulite_sample_complex_int16 *interm_native_buffer2;
+    uint32_t *interm_packed_buffer;
     cariboulite_sample_meta* interm_native_meta;
+
+	cariboulite_sample_complex_int16 *direct_buffer_pool;
+	bool direct_buffer_acquired[NUM_DIRECT_ACCESS_BUFFERS];
+	size_t direct_buffer_next;
+	long direct_buffer_timeout_us[NUM_DIRECT_ACCESS_BUFFERS];	// given to AcquireWriteBuffer
+	// RX direct access - spans of 'rx_queue' handed out by AcquireReadBuffer, in
+	// queue order, consumed from the queue once released in that order
+	const cariboulite_sample_complex_int16* rx_direct_ptr[NUM_DIRECT_ACCESS_BUFFERS];
+	size_t rx_direct_len[NUM_DIRECT_ACCESS_BUFFERS];
+	bool rx_direct_released[NUM_DIRECT_ACCESS_BUFFERS];
+	size_t rx_direct_order[NUM_DIRECT_ACCESS_BUFFERS];	// held handles, oldest first
+	size_t rx_direct_first;
+	size_t rx_direct_held;
+	size_t rx_direct_peeked;                // samples handed out and not consumed yet
+	int tx_error;                           // a failed ReleaseWriteBuffer - reported by the next TX call
 	DigitalFilterType filterType;
 	Iir::Butterworth::LowPass<DIG_FILT_ORDER>* filter_i;
 	Iir::Butterworth::LowPass<DIG_FILT_ORDER>* filter_q;
@@ -1,4 +1,5 @@
 #include "Cariboulite.hpp"
+#include <sstream>
 #include "cariboulite_config_default.h"
 
 //========================================================
@@ -44,9 +45,119 @@ std::string Cariboulite::getNativeStreamFormat(const int direction, const size_t
 SoapySDR::ArgInfoList Cariboulite::getStreamArgsInfo(const int direction, const size_t channel) const
 {
 	SoapySDR::ArgInfoList streamArgs;
+    if (direction != SOAPY_SDR_RX)
+    {
+        return streamArgs;
+    }
+
+    size_t mtu = cariboulite_radio_get_native_mtu_size_samples((cariboulite_radio_state_st*)radio);
+
+    SoapySDR::ArgInfo buffersArg;
+    buffersArg.key = "buffers";
+    buffersArg.value = std::to_string(NUM_NATIVE_MTUS_PER_QUEUE);
+    buffersArg.name = "Buffer Count";
+    buffersArg.description = "Number of reader buffers queued between the hardware and readStream";
+    buffersArg.units = "buffers";
+    buffersArg.type = SoapySDR::ArgInfo::INT;
+    streamArgs.push_back(buffersArg);
+
+    SoapySDR::ArgInfo bufflenArg;
+    bufflenArg.key = "buffer_len";
+    bufflenArg.value = std::to_string(mtu);
+    bufflenArg.name = "Buffer Length";
+    bufflenArg.description = "Number of samples per reader buffer (one SMI read)";
+    bufflenArg.units = "samples";
+    bufflenArg.type = SoapySDR::ArgInfo::INT;
+    streamArgs.push_back(bufflenArg);
+
+    SoapySDR::ArgInfo schedArg;
+    schedArg.key = "sched";
+    schedArg.value = "default";
+    schedArg.name = "Reader Scheduling";
+    schedArg.description = "Reader thread scheduling policy (fifo / rr need CAP_SYS_NICE)";
+    schedArg.type = SoapySDR::ArgInfo::STRING;
+    schedArg.options = {"default", "fifo", "rr"};
+    streamArgs.push_back(schedArg);
+
+    SoapySDR::ArgInfo prioArg;
+    prioArg.key = "priority";
+    prioArg.value = "50";
+    prioArg.name = "Reader Priority";
+    prioArg.description = "Reader thread real-time priority (fifo / rr)";
+    prioArg.type = SoapySDR::ArgInfo::INT;
+    prioArg.range = SoapySDR::Range(1, 99);
+    streamArgs.push_back(prioArg);
+
+    SoapySDR::ArgInfo cpusArg;
+    cpusArg.key = "cpus";
+    cpusArg.value = "";
+    cpusArg.name = "Reader CPUs";
+    cpusArg.description = "Comma separated cores the reader thread may run on (empty = any)";
+    cpusArg.type = SoapySDR::ArgInfo::STRING;
+    streamArgs.push_back(cpusArg);
+
+    SoapySDR::ArgInfo mlockArg;
+    mlockArg.key = "mlock";
+    mlockArg.value = "false";
+    mlockArg.name = "Lock Memory";
+    mlockArg.description = "Lock the process memory (mlockall)";
+    mlockArg.type = SoapySDR::ArgInfo::BOOL;
+    streamArgs.push_back(mlockArg);
+
+    SoapySDR::ArgInfo prefaultArg;
+    prefaultArg.key = "prefault";
+    prefaultArg.value = "false";
+    prefaultArg.name = "Pre-fault Buffers";
+    prefaultArg.description = "Touch the rx buffers up front";
+    prefaultArg.type = SoapySDR::ArgInfo::BOOL;
+    streamArgs.push_back(prefaultArg);
+
 	return streamArgs;
 }
 
+//========================================================
+static bool argIsTrue(const SoapySDR::Kwargs &args, const std::string &key)
+{
+    if (!args.count(key)) return false;
+    const std::string &v = args.at(key);
+    return v == "true" || v == "1" || v == "yes";
+}
+
+//========================================================
+cariboulite_thread_config_st Cariboulite::parseThreadConfig(const SoapySDR::Kwargs &args)
+{
+    cariboulite_thread_config_st cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    
+    if (args.count("sched"))
+    {
+        const std::string &sched = args.at("sched");
+        if (sched == "fifo") cfg.sched_policy = cariboulite_sched_fifo;
+        else if (sched == "rr") cfg.sched_policy = cariboulite_sched_rr;
+        else if (sched != "default")
+        {
+            throw std::runtime_error( "setupStream invalid sched " + sched + " - default, fifo or rr" );
+        }
+    }
+    cfg.sched_priority = args.count("priority") ? std::stoi(args.at("priority")) : 50;
+    
+    if (args.count("cpus"))
+    {
+        std::stringstream ss(args.at("cpus"));
+        std::string cpu;
+        while (std::getline(ss, cpu, ','))
+        {
+            int c = std::stoi(cpu);
+            if (c < 0 || c >= CPU_SETSIZE) throw std::runtime_error( "setupStream invalid cpus" );
+            CPU_SET(c, &cfg.cpus);
+        }
+    }
+    
+    cfg.lock_memory = argIsTrue(args, "mlock");
+    cfg.prefault_buffers = argIsTrue(args, "prefault");
+    return cfg;
+}
+
 //========================================================
 /*!
 * Initialize a stream given a list of channels and stream arguments.
@@ -84,11 +195,24 @@ SoapySDR::ArgInfoList Cariboulite::getStreamArgsInfo(const int direction, const
 *
 * \endparblock
 * \param channels a list of channels or empty for automatic.
+* Cariboulite RX: {0} (default) - this device's radio, or {0, 1} - both radios
+* received simultaneously, channel 1 being the other radio (requires the dual rx
+* firmware). readStream() then fills buffs[0] and buffs[1] with the same count.
 * \param args stream args or empty for defaults.
 * \parblock
 *
 *   Recommended keys to use in the args dictionary:
 *    - "WIRE" - format of the samples between device and host
+*
+*   Cariboulite RX keys:
+*    - "buffers" - number of reader buffers queued for readStream()
+*    - "buffer_len" - number of samples per reader buffer
+*    - "sched" - reader thread scheduling: "default", "fifo" or "rr"
+*    - "priority" - reader thread priority for "fifo" / "rr" (1..99)
+*    - "cpus" - comma separated cores the reader thread may run on (e.g. "2,3")
+*    - "mlock" - "true" to lock the process memory (mlockall)
+*    - "prefault" - "true" to touch the rx buffers up front
+*   Privileges missing for any of these are reported as warnings and skipped.
 * \endparblock
 * \return an opaque pointer to a stream handle.
 * \parblock
@@ -116,6 +240,40 @@ SoapySDR::Stream *Cariboulite::setupStream(const int direction,
 
     stream->setInnerStreamType(direction == SOAPY_SDR_TX ? cariboulite_channel_dir_tx : cariboulite_channel_dir_rx);
     
+    if (direction == SOAPY_SDR_RX)
+    {
+        // the reader thread configuration goes first - the queues are pre-faulted
+        // when they are created
+        stream->setThreadConfig(parseThreadConfig(args));
+        
+        size_t num_buffers = NUM_NATIVE_MTUS_PER_QUEUE;
+        size_t buffer_len = stream->getMTUSizeElements();
+        if (args.count("buffers")) num_buffers = std::stoul(args.at("buffers"));
+        if (args.count("buffer_len")) buffer_len = std::stoul(args.at("buffer_len"));
+        
+        if (stream->setRxQueueSize(num_buffers, buffer_len) != 0)
+        {
+            throw std::runtime_error( "setupStream invalid buffers / buffer_len" );
+        }
+        
+        // channels {0, 1} - both radios received together by one dual stream
+        bool dual = channels.size() == 2;
+        if (channels.size() > 2 || (dual && (channels[0] != 0 || channels[1] != 1)) || 
+            (channels.size() == 1 && channels[0] != 0))
+        {
+            throw std::runtime_error( "setupStream invalid channels - either {0} or {0, 1}" );
+        }
+        
+        if (stream->setRxDual(dual ? getRadio(1) : NULL) != 0)
+        {
+            throw std::runtime_error( "setupStream dual channel RX is not supported" );
+        }
+    }
+    else if (channels.size() > 1 || (channels.size() == 1 && channels[0] != 0))
+    {
+        throw std::runtime_error( "setupStream invalid TX channels" );
+    }
+
     // Default: CW Output -> OFF
 	cariboulite_radio_set_cw_outputs(radio, false, false);
 
@@ -146,7 +304,8 @@ SoapySDR::Stream *Cariboulite::setupStream(const int direction,
      */
 void Cariboulite::closeStream(SoapySDR::Stream *stream)
 {
-    cariboulite_radio_activate_channel(radio, stream->getInnerStreamType(), false);
+    deactivateStream(stream);
+    stream->setRxDual(NULL);
 }
 
 //========================================================
@@ -188,8 +347,17 @@ int Cariboulite::activateStream(SoapySDR::Stream *stream,
                                     const long long timeNs,
                                     const size_t numElems)
 {
+    stream->resetRxQueue();
     stream->activateStream(1);
-    int ret = cariboulite_radio_activate_channel(radio, stream->getInnerStreamType(), true);
+    int ret = 0;
+    if (stream->getInnerStreamType() == cariboulite_channel_dir_rx && stream->isRxDual())
+    {
+        ret = cariboulite_radio_activate_rx_dual(&sess.sys.radio_low, &sess.sys.radio_high, true);
+    }
+    else
+    {
+        ret = cariboulite_radio_activate_channel(radio, stream->getInnerStreamType(), true);
+    }
     std::this_thread::sleep_for(std::chrono::milliseconds(20));
     return ret;
 }
@@ -212,6 +380,10 @@ int Cariboulite::activateStream(SoapySDR::Stream *stream,
 int Cariboulite::deactivateStream(SoapySDR::Stream *stream, const int flags, const long long timeNs)
 {
     stream->activateStream(0);
+    if (stream->getInnerStreamType() == cariboulite_channel_dir_rx && stream->isRxDual())
+    {
+        return cariboulite_radio_activate_rx_dual(&sess.sys.radio_low, &sess.sys.radio_high, false);
+    }
 	return cariboulite_radio_activate_channel(radio, stream->getInnerStreamType(), false);
 }
 
@@ -234,7 +406,10 @@ int Cariboulite::deactivateStream(SoapySDR::Stream *stream, const int flags, con
      * \param flags optional flag indicators about the result
      * \param timeNs the buffer's timestamp in nanoseconds
      * \param timeoutUs the timeout in microseconds
-     * \return the number of elements read per buffer or error code
+     * \return the number of elements read per buffer or error code.
+     *          timeNs holds the hardware time of the first sample when SOAPY_SDR_HAS_TIME is set.
+     *          SOAPY_SDR_OVERFLOW is returned once after the reader thread had to
+     *          drop samples - the count is logged and kept in the "RX_DROPPED" sensor
      */
 int Cariboulite::readStream(
             SoapySDR::Stream *stream,
@@ -250,7 +425,14 @@ int Cariboulite::readStream(
         return SOAPY_SDR_NOT_SUPPORTED;
     }
 
-    return stream->ReadSamplesGen((void*)buffs[0], numElems, timeoutUs);
+    flags = 0;
+    int ret = stream->isRxDual() ? stream->ReadSamplesDual(buffs, numElems, timeoutUs) :
+                                   stream->ReadSamplesGen((void*)buffs[0], numElems, timeoutUs);
+    if (ret > 0 && stream->getRxReadTime(timeNs))
+    {
+        flags |= SOAPY_SDR_HAS_TIME;
+    }
+    return ret;
 }
 
 //========================================================
@@ -287,5 +469,214 @@ int Cariboulite::writeStream(
         return SOAPY_SDR_NOT_SUPPORTED;
     }
 
+    int error = stream->takeTxError();
+    if (error != 0)
+    {
+        return error;
+    }
     return stream->WriteSamplesGen((void*)buffs[0], numElems, timeoutUs);
-}
\ No newline at end of file
+}
+//========================================================
+/*!
+     * How many direct access buffers can the stream provide?
+     * This is the number of times the user can call acquire()
+     * on a stream without making subsequent calls to release().
+     * The buffers hold samples in the native format (CS16), one MTU
+     * each, so they are only offered to CS16 streams (0 otherwise).
+     * \param stream the opaque pointer to a stream handle
+     * \return the number of direct access buffers or 0
+     */
+size_t Cariboulite::getNumDirectAccessBuffers(SoapySDR::Stream *stream)
+{
+    return stream->getNumDirectAccessBuffers();
+}
+
+//========================================================
+/*!
+     * Get the buffer addresses for a scatter/gather table entry.
+     * TX buffers have fixed addresses. RX buffers are spans of the
+     * stream's queue, so an RX handle only has an address while it
+     * is acquired.
+     * \param stream the opaque pointer to a stream handle
+     * \param handle an index value between 0 and num direct buffers - 1
+     * \param buffs an array of void* buffers num chans in size
+     * \return 0 for success or error code when not supported
+     */
+int Cariboulite::getDirectAccessBufferAddrs(SoapySDR::Stream *stream, const size_t handle, void **buffs)
+{
+    if (!stream->isDirectAccessSupported())
+    {
+        return SOAPY_SDR_NOT_SUPPORTED;
+    }
+
+    if (stream->getInnerStreamType() == cariboulite_channel_dir_rx)
+    {
+        const void* span = stream->getReadBufferAddr(handle);
+        if (span == NULL)
+        {
+            return SOAPY_SDR_NOT_SUPPORTED;
+        }
+        buffs[0] = (void*)span;
+        return 0;
+    }
+
+    cariboulite_sample_complex_int16* buffer = stream->getDirectAccessBuffer(handle);
+    if (buffer == NULL)
+    {
+        return SOAPY_SDR_NOT_SUPPORTED;
+    }
+    buffs[0] = buffer;
+    return 0;
+}
+
+//========================================================
+/*!
+     * Acquire direct buffers from a receive stream.
+     * This call is part of the direct buffer access API.
+     * The buffer holds native CS16 samples and stays valid until
+     * releaseReadBuffer() is called with the same handle.
+     * Zero-copy - the buffer is the reader thread's queue itself, the
+     * samples stay queued until released. Buffers are released back to
+     * the queue in the order they were acquired, and readStream() fails
+     * while any is held. With a digital filter active the filtered
+     * samples are copied into a buffer of the stream's own instead.
+     *
+     * \param stream the opaque pointer to a stream handle
+     * \param handle an index value used in the release() call
+     * \param buffs an array of void* buffers num chans in size
+     * \param flags optional flag indicators about the result
+     * \param timeNs the buffer's timestamp in nanoseconds
+     * \param timeoutUs the timeout in microseconds
+     * \return the number of elements read per buffer or error code
+     */
+int Cariboulite::acquireReadBuffer(SoapySDR::Stream *stream,
+                                    size_t &handle,
+                                    const void **buffs,
+                                    int &flags,
+                                    long long &timeNs,
+                                    const long timeoutUs)
+{
+    // Verify that it is a single channel CS16 RX stream
+    if (stream->getInnerStreamType() != cariboulite_channel_dir_rx || stream->isRxDual() ||
+        !stream->isDirectAccessSupported())
+    {
+        return SOAPY_SDR_NOT_SUPPORTED;
+    }
+
+    flags = 0;
+    int ret = stream->AcquireReadBuffer(handle, buffs, timeoutUs);
+    if (ret > 0 && stream->getRxReadTime(timeNs))
+    {
+        flags |= SOAPY_SDR_HAS_TIME;
+    }
+    return ret;
+}
+
+//========================================================
+/*!
+     * Release an acquired buffer back to the receive stream.
+     * This call is part of the direct buffer access API.
+     *
+     * \param stream the opaque pointer to a stream handle
+     * \param handle the opaque handle from the acquire() call
+     */
+void Cariboulite::releaseReadBuffer(SoapySDR::Stream *stream, const size_t handle)
+{
+    stream->ReleaseReadBuffer(handle);
+}
+
+//========================================================
+/*!
+     * Acquire direct buffers from a transmit stream.
+     * This call is part of the direct buffer access API.
+     * The buffer should be filled with native CS16 samples and
+     * handed back with releaseWriteBuffer() to be transmitted.
+     *
+     * \param stream the opaque pointer to a stream handle
+     * \param handle an index value used in the release() call
+     * \param buffs an array of void* buffers num chans in size
+     * \param timeoutUs the timeout in microseconds
+     * \return the number of available elements per buffer or error
+     */
+int Cariboulite::acquireWriteBuffer(SoapySDR::Stream *stream,
+                                    size_t &handle,
+                                    void **buffs,
+                                    const long timeoutUs)
+{
+    // Verify that it is a CS16 TX stream
+    if (stream->getInnerStreamType() != cariboulite_channel_dir_tx || !stream->isDirectAccessSupported())
+    {
+        return SOAPY_SDR_NOT_SUPPORTED;
+    }
+
+    return stream->AcquireWriteBuffer(handle, buffs, timeoutUs);
+}
+
+//========================================================
+/*!
+     * Release an acquired buffer back to the transmit stream.
+     * This call is part of the direct buffer access API.
+     * The first numElems samples of the buffer are transmitted, within
+     * the timeout given to acquireWriteBuffer(). A failure is returned
+     * by the next writeStream() or acquireWriteBuffer() call.
+     *
+     * \param stream the opaque pointer to a stream handle
+     * \param handle the opaque handle from the acquire() call
+     * \param numElems the number of elements written to each buffer
+     * \param flags optional input flags and output flags
+     * \param timeNs the buffer's timestamp in nanoseconds
+     */
+void Cariboulite::releaseWriteBuffer(SoapySDR::Stream *stream,
+                                    const size_t handle,
+                                    const size_t numElems,
+                                    int &flags,
+                                    const long long timeNs)
+{
+    stream->ReleaseWriteBuffer(handle, numElems);
+    flags = 0;
+}
+
+//========================================================
+/*!
+     * Does this device have a hardware clock?
+     * The Cariboulite clock counts RX samples (lost samples included) from the
+     * capture time of the first chunk the driver stamps after activation, so
+     * timestamps of consecutive reads differ exactly by the samples between them.
+     * \param what optional argument
+     * \return true if the hardware clock exists
+     */
+bool Cariboulite::hasHardwareTime(const std::string &what) const
+{
+    return what.empty();
+}
+
+//========================================================
+/*!
+     * Read the time from the hardware clock on the device.
+     * The clock is based on CLOCK_MONOTONIC unless moved with setHardwareTime().
+     * \param what optional argument
+     * \return the time in nanoseconds
+     */
+long long Cariboulite::getHardwareTime(const std::string &what) const
+{
+    if (!what.empty())
+    {
+        throw std::runtime_error( "getHardwareTime: unknown clock " + what );
+    }
+    return stream->getHardwareTime();
+}
+
+//========================================================
+/*!
+     * Write the time to the hardware clock on the device.
+     * \param timeNs time in nanoseconds
+     * \param what optional argument
+     */
+void Cariboulite::setHardwareTime(const long long timeNs, const std::string &what)
+{
+    if (!what.empty())
+    {
+        throw std::runtime_error( "setHardwareTime: unknown clock " + what );
+    }
+    stream->setHardwareTime(timeNs);
+}